@@ -0,0 +1,500 @@
+#include "Benchmark.h"
+#include "GLBackend.h"
+#include "ShadowCascades.h"
+#include "ShadowAtlas.h"
+
+#include <glad/glad.h>
+#include <glfw/glfw3.h>
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+#include <cmath>
+
+#if defined(__linux__)
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+RenderStats renderStats;
+
+bool ParseBenchmarkArgs(int argc, char **argv, BenchmarkConfig &config)
+{
+	for (int i = 1; i < argc; i++)
+	{
+		if (!strcmp(argv[i], "--benchmark"))
+		{
+			config.enabled = true;
+		}
+		else if (!strcmp(argv[i], "--frames") && i + 1 < argc)
+		{
+			config.frames = (unsigned int)atoi(argv[++i]);
+		}
+		else if (!strcmp(argv[i], "--warmup") && i + 1 < argc)
+		{
+			config.warmupFrames = (unsigned int)atoi(argv[++i]);
+		}
+		else if (!strcmp(argv[i], "--out") && i + 1 < argc)
+		{
+			config.outputPath = argv[++i];
+		}
+		else if (!strcmp(argv[i], "--per-light-shadows"))
+		{
+			config.layeredShadows = false;
+		}
+		else if (!strcmp(argv[i], "--cascades") && i + 1 < argc)
+		{
+			config.shadowCascades = std::min(std::max(atoi(argv[++i]), 1), (int)MAX_SHADOW_CASCADES);
+		}
+		else if (!strcmp(argv[i], "--cascade-size") && i + 1 < argc)
+		{
+			//tiles are nodes of the atlas quadtree, so they are powers of two as well
+			unsigned int size = (unsigned int)std::max(atoi(argv[++i]), (int)MIN_SHADOW_TILE_SIZE);
+			config.shadowMapSize = MIN_SHADOW_TILE_SIZE;
+			while (config.shadowMapSize * 2 <= size) { config.shadowMapSize *= 2; }
+		}
+		else if (!strcmp(argv[i], "--shadow-atlas") && i + 1 < argc)
+		{
+			//tiles are placed on a quadtree, which needs a power of two side
+			unsigned int size = (unsigned int)std::max(atoi(argv[++i]), (int)MIN_SHADOW_TILE_SIZE);
+			config.shadowAtlasSize = MIN_SHADOW_TILE_SIZE;
+			while (config.shadowAtlasSize * 2 <= size) { config.shadowAtlasSize *= 2; }
+		}
+		else if (!strcmp(argv[i], "--no-shadows"))
+		{
+			config.shadows = false;
+		}
+		else if (!strcmp(argv[i], "--pcf") && i + 1 < argc)
+		{
+			//kernel is centered on the sample, even widths round up
+			config.pcfKernelSize = (unsigned int)atoi(argv[++i]) | 1u;
+		}
+		else if (!strcmp(argv[i], "--shadow-filter") && i + 1 < argc)
+		{
+			const char *name = argv[++i];
+			if (!strcmp(name, "pcf")) { config.shadowFilter = SHADOW_FILTER_PCF; }
+			else if (!strcmp(name, "hardware")) { config.shadowFilter = SHADOW_FILTER_HARDWARE; }
+			else if (!strcmp(name, "poisson")) { config.shadowFilter = SHADOW_FILTER_POISSON; }
+			else if (!strcmp(name, "vsm")) { config.shadowFilter = SHADOW_FILTER_VSM; }
+			else
+			{
+				std::cout << "ERROR: UNKNOWN SHADOW FILTER: " << name << std::endl;
+				return false;
+			}
+		}
+		else if (!strcmp(argv[i], "--phong"))
+		{
+			config.blinnPhong = false;
+		}
+		else if (!strcmp(argv[i], "--props") && i + 1 < argc)
+		{
+			config.props = (unsigned int)atoi(argv[++i]);
+		}
+		else if (!strcmp(argv[i], "--lights") && i + 1 < argc)
+		{
+			config.pointLights = (unsigned int)atoi(argv[++i]);
+		}
+		else if (!strcmp(argv[i], "--model") && i + 1 < argc)
+		{
+			config.modelPath = argv[++i];
+		}
+		else if (!strcmp(argv[i], "--no-render-thread"))
+		{
+			config.renderThread = false;
+		}
+		else if (!strcmp(argv[i], "--no-occlusion"))
+		{
+			config.occlusionCulling = false;
+		}
+		else if (!strcmp(argv[i], "--profile"))
+		{
+			config.profile = true;
+		}
+		else if (!strcmp(argv[i], "--trace") && i + 1 < argc)
+		{
+			config.profile = true;
+			config.tracePath = argv[++i];
+		}
+		else if (!strcmp(argv[i], "--null-gl"))
+		{
+			config.enabled = true;
+			config.nullGL = true;
+		}
+		else if (!strcmp(argv[i], "--record-gl") && i + 1 < argc)
+		{
+			config.enabled = true;
+			config.recordGLPath = argv[++i];
+		}
+		else if (!strcmp(argv[i], "--replay-gl") && i + 1 < argc)
+		{
+			config.replayGLPath = argv[++i];
+		}
+		else if (!strcmp(argv[i], "--cook-textures"))
+		{
+			config.cookTextures = true;
+		}
+		else if (!strcmp(argv[i], "--test-cooker"))
+		{
+			config.testCooker = true;
+		}
+		else if (!strcmp(argv[i], "--compress-textures"))
+		{
+			config.compressTextures = true;
+		}
+		else if (!strcmp(argv[i], "--bench-transforms") && i + 1 < argc)
+		{
+			config.transformBenchmark = (unsigned int)atoi(argv[++i]);
+		}
+		else if (!strcmp(argv[i], "--bench-clusters") && i + 1 < argc)
+		{
+			config.clusterBenchmark = (unsigned int)atoi(argv[++i]);
+		}
+		else if (!strcmp(argv[i], "--bench-occlusion") && i + 1 < argc)
+		{
+			config.occlusionBenchmark = (unsigned int)atoi(argv[++i]);
+		}
+		else
+		{
+			std::cout << "ERROR: UNKNOWN COMMAND LINE ARGUMENT: " << argv[i] << std::endl;
+			return false;
+		}
+	}
+	return true;
+}
+
+#if defined(__linux__)
+static EGLDisplay eglDisplay = EGL_NO_DISPLAY;
+static EGLContext eglContext = EGL_NO_CONTEXT;
+#else
+static GLFWwindow *hiddenWindow = nullptr;
+#endif
+static unsigned int offscreenFBO = 0, offscreenColor = 0, offscreenDepth = 0;
+
+bool CreateHeadlessContext(unsigned int width, unsigned int height, unsigned int &framebuffer)
+{
+#if defined(__linux__)
+	//prefer surfaceless platform so neither X11 nor a GPU is required (mesa llvmpipe works)
+	PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+	if (getPlatformDisplay) { eglDisplay = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL); }
+	if (eglDisplay == EGL_NO_DISPLAY) { eglDisplay = eglGetDisplay(EGL_DEFAULT_DISPLAY); }
+	if (eglDisplay == EGL_NO_DISPLAY || !eglInitialize(eglDisplay, NULL, NULL))
+	{
+		std::cout << "ERROR: EGL DISPLAY FAILED TO INITIALIZE." << std::endl;
+		return false;
+	}
+
+	const EGLint configAttribs[] =
+	{
+		EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+		EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+		EGL_NONE
+	};
+	EGLConfig config;
+	EGLint numConfigs = 0;
+	if (!eglChooseConfig(eglDisplay, configAttribs, &config, 1, &numConfigs) || numConfigs == 0 || !eglBindAPI(EGL_OPENGL_API))
+	{
+		std::cout << "ERROR: EGL CONFIG FAILED TO CHOOSE." << std::endl;
+		return false;
+	}
+
+	const EGLint contextAttribs[] =
+	{
+		EGL_CONTEXT_MAJOR_VERSION, 3,
+		EGL_CONTEXT_MINOR_VERSION, 3,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+		EGL_NONE
+	};
+	eglContext = eglCreateContext(eglDisplay, config, EGL_NO_CONTEXT, contextAttribs);
+	if (eglContext == EGL_NO_CONTEXT || !eglMakeCurrent(eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, eglContext))
+	{
+		std::cout << "ERROR: EGL CONTEXT FAILED TO CREATE." << std::endl;
+		return false;
+	}
+
+	if (!gladLoadGLLoader(GLADloadproc(eglGetProcAddress)))
+	{
+		return false;
+	}
+#else
+	if (!glfwInit()) { return false; }
+
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+	hiddenWindow = glfwCreateWindow(width, height, "Opengl benchmark", NULL, NULL);
+	if (!hiddenWindow)
+	{
+		glfwTerminate();
+		return false;
+	}
+	glfwMakeContextCurrent(hiddenWindow);
+
+	if (!gladLoadGLLoader(GLADloadproc(glfwGetProcAddress)))
+	{
+		glfwTerminate();
+		return false;
+	}
+#endif
+
+	//offscreen color and depth targets which stand in for the window frame buffer
+	glGenRenderbuffers(1, &offscreenColor);
+	glBindRenderbuffer(GL_RENDERBUFFER, offscreenColor);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+
+	glGenRenderbuffers(1, &offscreenDepth);
+	glBindRenderbuffer(GL_RENDERBUFFER, offscreenDepth);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+
+	glGenFramebuffers(1, &offscreenFBO);
+	glBindFramebuffer(GL_FRAMEBUFFER, offscreenFBO);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, offscreenColor);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, offscreenDepth);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+	{
+		std::cout << "ERROR: OFFSCREEN FRAMEBUFFER IS NOT COMPLETE." << std::endl;
+		return false;
+	}
+
+	framebuffer = offscreenFBO;
+	return true;
+}
+
+void DestroyHeadlessContext()
+{
+	glDeleteFramebuffers(1, &offscreenFBO);
+	glDeleteRenderbuffers(1, &offscreenColor);
+	glDeleteRenderbuffers(1, &offscreenDepth);
+
+#if defined(__linux__)
+	eglMakeCurrent(eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+	eglDestroyContext(eglDisplay, eglContext);
+	eglTerminate(eglDisplay);
+#else
+	glfwDestroyWindow(hiddenWindow);
+	glfwTerminate();
+#endif
+}
+
+void MakeHeadlessContextCurrent(bool current)
+{
+#if defined(__linux__)
+	eglMakeCurrent(eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, current ? eglContext : EGL_NO_CONTEXT);
+#else
+	glfwMakeContextCurrent(current ? hiddenWindow : NULL);
+#endif
+}
+
+//glad exposes every GL entry point as a function pointer, so wrappers are installed by swapping them
+#define COUNTED_GL_CALL(name, counter, params, args) \
+	static decltype(glad_##name) real_##name = nullptr; \
+	static void APIENTRY counted_##name params { renderStats.counter++; real_##name args; }
+
+COUNTED_GL_CALL(glDrawArrays, drawCalls, (GLenum mode, GLint first, GLsizei count), (mode, first, count))
+COUNTED_GL_CALL(glDrawElements, drawCalls, (GLenum mode, GLsizei count, GLenum type, const void *indices), (mode, count, type, indices))
+COUNTED_GL_CALL(glDrawArraysInstanced, drawCalls, (GLenum mode, GLint first, GLsizei count, GLsizei instances), (mode, first, count, instances))
+COUNTED_GL_CALL(glDrawElementsInstanced, drawCalls, (GLenum mode, GLsizei count, GLenum type, const void *indices, GLsizei instances), (mode, count, type, indices, instances))
+COUNTED_GL_CALL(glUseProgram, stateChanges, (GLuint program), (program))
+COUNTED_GL_CALL(glBindTexture, stateChanges, (GLenum target, GLuint texture), (target, texture))
+COUNTED_GL_CALL(glActiveTexture, stateChanges, (GLenum texture), (texture))
+COUNTED_GL_CALL(glBindVertexArray, stateChanges, (GLuint array), (array))
+COUNTED_GL_CALL(glBindBuffer, stateChanges, (GLenum target, GLuint buffer), (target, buffer))
+COUNTED_GL_CALL(glBindFramebuffer, stateChanges, (GLenum target, GLuint framebuffer), (target, framebuffer))
+COUNTED_GL_CALL(glViewport, stateChanges, (GLint x, GLint y, GLsizei width, GLsizei height), (x, y, width, height))
+COUNTED_GL_CALL(glDepthFunc, stateChanges, (GLenum func), (func))
+
+#define INSTALL_GL_CALL(name) real_##name = glad_##name; glad_##name = counted_##name
+
+void InstallCallCounters()
+{
+	INSTALL_GL_CALL(glDrawArrays);
+	INSTALL_GL_CALL(glDrawElements);
+	INSTALL_GL_CALL(glDrawArraysInstanced);
+	INSTALL_GL_CALL(glDrawElementsInstanced);
+	INSTALL_GL_CALL(glUseProgram);
+	INSTALL_GL_CALL(glBindTexture);
+	INSTALL_GL_CALL(glActiveTexture);
+	INSTALL_GL_CALL(glBindVertexArray);
+	INSTALL_GL_CALL(glBindBuffer);
+	INSTALL_GL_CALL(glBindFramebuffer);
+	INSTALL_GL_CALL(glViewport);
+	INSTALL_GL_CALL(glDepthFunc);
+}
+
+void ScriptedCameraPath(unsigned int frame, unsigned int frameCount, glm::vec3 &position, glm::vec3 &front)
+{
+	//one full orbit around the scene origin with slow vertical bobbing
+	float t = 2.0f * 3.14159265f * (float)frame / (float)std::max(frameCount, 1u);
+	position = glm::vec3(5.0f * sin(t), 1.5f + 0.5f * sin(2.0f * t), 5.0f * cos(t));
+	front = glm::normalize(glm::vec3(0.0f, 0.5f, 0.0f) - position);
+}
+
+void FrameRecorder::Init()
+{
+	glGenQueries(QUERY_RING_SIZE, queries);
+	for (unsigned int i = 0; i < QUERY_RING_SIZE; i++) { querySample[i] = -1; }
+	currentSlot = 0;
+	samples.clear();
+}
+
+void FrameRecorder::BeginFrame(unsigned int frame)
+{
+	MarkGLFrameBegin();
+	//reuse oldest query of the ring, its result is normally available a few frames later without stall
+	CollectQuery(currentSlot);
+
+	FrameSample sample = { frame, 0.0, 0.0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+	samples.push_back(sample);
+	querySample[currentSlot] = (int)samples.size() - 1;
+
+	renderStats = RenderStats();
+	frameStart = std::chrono::high_resolution_clock::now();
+	if (samples.size() == 1) { firstFrameStart = frameStart; }
+	glBeginQuery(GL_TIME_ELAPSED, queries[currentSlot]);
+}
+
+void FrameRecorder::EndFrame()
+{
+	glEndQuery(GL_TIME_ELAPSED);
+	glFlush();
+
+	FrameSample &sample = samples.back();
+	lastFrameEnd = std::chrono::high_resolution_clock::now();
+	sample.cpuMs = std::chrono::duration<double, std::milli>(lastFrameEnd - frameStart).count();
+	sample.drawCalls = renderStats.drawCalls;
+	sample.stateChanges = renderStats.stateChanges;
+	sample.redundantBindsDropped = renderStats.redundantBindsDropped;
+	sample.shadowPassesRendered = renderStats.shadowPassesRendered;
+	sample.shadowPassesSkipped = renderStats.shadowPassesSkipped;
+	sample.objectsTested = renderStats.objectsTested;
+	sample.objectsCulled = renderStats.objectsCulled;
+	sample.objectsOccluded = renderStats.objectsOccluded;
+	sample.objectsDrawn = renderStats.objectsDrawn;
+
+	currentSlot = (currentSlot + 1) % QUERY_RING_SIZE;
+	MarkGLFrameEnd();
+}
+
+void FrameRecorder::Finish()
+{
+	for (unsigned int i = 0; i < QUERY_RING_SIZE; i++) { CollectQuery(i); }
+	glDeleteQueries(QUERY_RING_SIZE, queries);
+}
+
+void FrameRecorder::CollectQuery(unsigned int slot)
+{
+	if (querySample[slot] < 0) { return; }
+
+	GLuint64 elapsed = 0;
+	glGetQueryObjectui64v(queries[slot], GL_QUERY_RESULT, &elapsed);
+	samples[querySample[slot]].gpuMs = (double)elapsed / 1000000.0;
+	querySample[slot] = -1;
+}
+
+struct Percentiles
+{
+	double mean, p50, p95, p99, max;
+};
+
+static Percentiles ComputePercentiles(std::vector<double> values)
+{
+	Percentiles result = { 0.0, 0.0, 0.0, 0.0, 0.0 };
+	if (values.empty()) { return result; }
+
+	std::sort(values.begin(), values.end());
+	double sum = 0.0;
+	for (double v : values) { sum += v; }
+
+	//nearest rank percentile
+	auto rank = [&values](double p) { return values[std::min(values.size() - 1, (size_t)ceil(p * values.size()) - 1)]; };
+	result.mean = sum / values.size();
+	result.p50 = rank(0.50);
+	result.p95 = rank(0.95);
+	result.p99 = rank(0.99);
+	result.max = values.back();
+	return result;
+}
+
+static void WritePercentilesJson(std::ofstream &file, const char *name, const Percentiles &p, bool last)
+{
+	file << "    \"" << name << "\": { \"mean\": " << p.mean << ", \"p50\": " << p.p50 << ", \"p95\": " << p.p95
+		<< ", \"p99\": " << p.p99 << ", \"max\": " << p.max << " }" << (last ? "" : ",") << "\n";
+}
+
+bool FrameRecorder::WriteResults(const std::string &path) const
+{
+	std::vector<double> cpu, gpu, draws, states, dropped;
+	unsigned int shadowRendered = 0, shadowSkipped = 0;
+	unsigned long long objectsTested = 0, objectsCulled = 0, objectsOccluded = 0, objectsDrawn = 0;
+	for (const FrameSample &s : samples)
+	{
+		cpu.push_back(s.cpuMs);
+		gpu.push_back(s.gpuMs);
+		draws.push_back(s.drawCalls);
+		states.push_back(s.stateChanges);
+		dropped.push_back(s.redundantBindsDropped);
+		shadowRendered += s.shadowPassesRendered;
+		shadowSkipped += s.shadowPassesSkipped;
+		objectsTested += s.objectsTested;
+		objectsCulled += s.objectsCulled;
+		objectsOccluded += s.objectsOccluded;
+		objectsDrawn += s.objectsDrawn;
+	}
+	Percentiles cpuSummary = ComputePercentiles(cpu);
+	Percentiles gpuSummary = ComputePercentiles(gpu);
+	Percentiles drawSummary = ComputePercentiles(draws);
+	Percentiles stateSummary = ComputePercentiles(states);
+	Percentiles droppedSummary = ComputePercentiles(dropped);
+	double wallMsPerFrame = samples.empty() ? 0.0 : std::chrono::duration<double, std::milli>(lastFrameEnd - firstFrameStart).count() / samples.size();
+
+	std::ofstream csv(path + ".csv");
+	if (!csv)
+	{
+		std::cout << "ERROR: BENCHMARK RESULT FAILED TO WRITE: " << path << ".csv" << std::endl;
+		return false;
+	}
+	csv << "frame,cpu_ms,gpu_ms,draw_calls,state_changes,redundant_binds_dropped,shadow_passes_rendered,shadow_passes_skipped,objects_tested,objects_culled,objects_occluded,objects_drawn\n";
+	for (const FrameSample &s : samples)
+	{
+		csv << s.frame << "," << s.cpuMs << "," << s.gpuMs << "," << s.drawCalls << "," << s.stateChanges << "," << s.redundantBindsDropped
+			<< "," << s.shadowPassesRendered << "," << s.shadowPassesSkipped << "," << s.objectsTested << "," << s.objectsCulled << "," << s.objectsOccluded << "," << s.objectsDrawn << "\n";
+	}
+
+	std::ofstream json(path + ".json");
+	if (!json)
+	{
+		std::cout << "ERROR: BENCHMARK RESULT FAILED TO WRITE: " << path << ".json" << std::endl;
+		return false;
+	}
+	json << "{\n  \"frames\": " << samples.size() << ",\n  \"wall_ms_per_frame\": " << wallMsPerFrame << ",\n  \"shadow_passes_rendered\": " << shadowRendered
+		<< ",\n  \"shadow_passes_skipped\": " << shadowSkipped << ",\n  \"objects_tested\": " << objectsTested
+		<< ",\n  \"objects_culled\": " << objectsCulled << ",\n  \"objects_occluded\": " << objectsOccluded << ",\n  \"objects_drawn\": " << objectsDrawn << ",\n  \"summary\": {\n";
+	WritePercentilesJson(json, "cpu_ms", cpuSummary, false);
+	WritePercentilesJson(json, "gpu_ms", gpuSummary, false);
+	WritePercentilesJson(json, "draw_calls", drawSummary, false);
+	WritePercentilesJson(json, "state_changes", stateSummary, false);
+	WritePercentilesJson(json, "redundant_binds_dropped", droppedSummary, true);
+	json << "  },\n  \"samples\": [\n";
+	for (size_t i = 0; i < samples.size(); i++)
+	{
+		const FrameSample &s = samples[i];
+		json << "    { \"frame\": " << s.frame << ", \"cpu_ms\": " << s.cpuMs << ", \"gpu_ms\": " << s.gpuMs
+			<< ", \"draw_calls\": " << s.drawCalls << ", \"state_changes\": " << s.stateChanges
+			<< ", \"redundant_binds_dropped\": " << s.redundantBindsDropped
+			<< ", \"shadow_passes_rendered\": " << s.shadowPassesRendered << ", \"shadow_passes_skipped\": " << s.shadowPassesSkipped
+			<< ", \"objects_tested\": " << s.objectsTested << ", \"objects_culled\": " << s.objectsCulled << ", \"objects_occluded\": " << s.objectsOccluded << ", \"objects_drawn\": " << s.objectsDrawn << " }"
+			<< (i + 1 < samples.size() ? "," : "") << "\n";
+	}
+	json << "  ]\n}\n";
+
+	std::cout << "benchmark: " << samples.size() << " frames" << std::endl;
+	std::cout << "  wall ms per frame " << wallMsPerFrame << std::endl;
+	std::cout << "  cpu ms  p50 " << cpuSummary.p50 << "  p95 " << cpuSummary.p95 << "  p99 " << cpuSummary.p99 << std::endl;
+	std::cout << "  gpu ms  p50 " << gpuSummary.p50 << "  p95 " << gpuSummary.p95 << "  p99 " << gpuSummary.p99 << std::endl;
+	std::cout << "  draw calls " << drawSummary.p50 << "  state changes " << stateSummary.p50 << "  redundant binds dropped " << droppedSummary.p50 << std::endl;
+	std::cout << "  shadow passes rendered " << shadowRendered << "  skipped " << shadowSkipped << std::endl;
+	std::cout << "  objects tested " << objectsTested << "  culled " << objectsCulled << "  occluded " << objectsOccluded << "  drawn " << objectsDrawn << std::endl;
+	return true;
+}
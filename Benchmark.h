@@ -0,0 +1,166 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+//filters of shadow lookups, values are passed to the object shader as SHADOW_FILTER
+enum ShadowFilter
+{
+	//PCF_KERNEL_SIZE^2 depth fetches compared one by one
+	SHADOW_FILTER_PCF,
+	//depth comparison sampler with bilinear filtering, (PCF_KERNEL_SIZE - 1)^2 taps
+	SHADOW_FILTER_HARDWARE,
+	//Poisson disk rotated per pixel
+	SHADOW_FILTER_POISSON,
+	//variance shadow maps, depth moments blurred after the shadow pass, one filtered fetch
+	SHADOW_FILTER_VSM
+};
+
+//options of headless benchmark mode, filled from command line
+//usage: Opengl_demo [--benchmark] [--frames N] [--warmup N] [--out path] [--per-light-shadows]
+//                   [--cascades N] [--cascade-size N] [--shadow-atlas N] [--no-shadows] [--pcf N]
+//                   [--shadow-filter pcf|hardware|poisson|vsm] [--phong] [--props N] [--lights N] [--model path] [--no-render-thread]
+//                   [--no-occlusion] [--profile] [--trace path] [--null-gl] [--record-gl path] [--replay-gl path]
+//                   [--cook-textures [--compress-textures]] [--test-cooker] [--bench-transforms N] [--bench-clusters N] [--bench-occlusion N]
+struct BenchmarkConfig
+{
+	bool enabled = false;
+	unsigned int frames = 600;
+	unsigned int warmupFrames = 30;
+	std::string outputPath = "benchmark";
+
+	//render options which benchmark runs compare, also honored in windowed mode
+	//--per-light-shadows renders every lamp in its own shadow pass instead of one layered pass
+	bool layeredShadows = true;
+	//--cascades N splits the shadowed part of the camera frustum into N (1 to 4) cascades per lamp,
+	//--cascade-size N sets width and height of the largest atlas tile a cascade gets,
+	//--shadow-atlas N sets width and height of the shadow atlas shared by all of them, both rounded down to a power of two
+	unsigned int shadowCascades = 3;
+	unsigned int shadowMapSize = 512;
+	unsigned int shadowAtlasSize = 2048;
+	//shader permutations: --no-shadows drops shadow passes and lookups, --pcf N sets the odd PCF kernel width,
+	//--phong uses Phong instead of Blinn-Phong specular, --shadow-filter name selects how shadow maps are filtered
+	//over the PCF square
+	bool shadows = true;
+	unsigned int pcfKernelSize = 3;
+	ShadowFilter shadowFilter = SHADOW_FILTER_PCF;
+	bool blinnPhong = true;
+	//--props N scatters N small cubes over the floor, drawn instanced together with the center cube
+	unsigned int props = 0;
+	//--lights N adds N moving point lights without shadows, shaded through clustered light lists
+	unsigned int pointLights = 0;
+	//--model path imports a model (any format assimp reads) and places it beside the center cube
+	std::string modelPath;
+	//GL submission runs on its own thread while the next frame is recorded, --no-render-thread records
+	//and submits every frame on the main thread one after another
+	bool renderThread = true;
+	//instances hidden behind the center cube and the floor are culled with a CPU depth buffer,
+	//--no-occlusion culls against the camera frustum only
+	bool occlusionCulling = true;
+	//--profile times scopes of every frame on CPU and GPU and shows the breakdown on screen,
+	//--trace path also writes every scope as Chrome trace event JSON on exit
+	bool profile = false;
+	std::string tracePath;
+	//--null-gl benchmarks without a GL context, every call goes to a backend which does nothing,
+	//--record-gl path logs every GL call of the run to path and the call counts per frame to path.csv,
+	//both imply --benchmark
+	bool nullGL = false;
+	std::string recordGLPath;
+
+	//offline tools which run instead of the scene
+	//--cook-textures writes containers of the scene textures to Textures/cooked and exits,
+	//--compress-textures stores images without alpha as BC1
+	bool cookTextures = false;
+	bool compressTextures = false;
+	//--test-cooker checks how the cooker widens sources of every channel count
+	bool testCooker = false;
+	//--bench-transforms N times world matrix updates of N entities, per-object glm against the entity store
+	unsigned int transformBenchmark = 0;
+	//--bench-clusters N times binning N point lights into clusters on one and on every hardware thread
+	unsigned int clusterBenchmark = 0;
+	//--bench-occlusion N times rasterizing occluders on one and on every hardware thread and testing N spheres against them
+	unsigned int occlusionBenchmark = 0;
+	//--replay-gl path issues a recorded GL call log on a headless context and writes the frame times to the --out files
+	std::string replayGLPath;
+};
+
+//fixed simulation step of benchmark mode so every run renders identical frames
+const float BENCHMARK_TIMESTEP = 1.0f / 60.0f;
+
+//counters of GL calls issued since the last reset
+struct RenderStats
+{
+	unsigned int drawCalls = 0;
+	unsigned int stateChanges = 0;
+	//program, texture and vertex array binds the GL state cache dropped as redundant
+	unsigned int redundantBindsDropped = 0;
+	unsigned int shadowPassesRendered = 0;
+	unsigned int shadowPassesSkipped = 0;
+	//instances tested against view frusta, rejected and left to draw, occluded ones are part of culled
+	unsigned int objectsTested = 0;
+	unsigned int objectsCulled = 0;
+	unsigned int objectsOccluded = 0;
+	unsigned int objectsDrawn = 0;
+};
+extern RenderStats renderStats;
+
+struct FrameSample
+{
+	unsigned int frame;
+	double cpuMs;
+	double gpuMs;
+	unsigned int drawCalls;
+	unsigned int stateChanges;
+	unsigned int redundantBindsDropped;
+	unsigned int shadowPassesRendered;
+	unsigned int shadowPassesSkipped;
+	unsigned int objectsTested;
+	unsigned int objectsCulled;
+	unsigned int objectsOccluded;
+	unsigned int objectsDrawn;
+};
+
+bool ParseBenchmarkArgs(int argc, char **argv, BenchmarkConfig &config);
+
+//create an OpenGL 3.3 core context without window (surfaceless EGL on linux, hidden window elsewhere)
+//and an offscreen frame buffer object which replaces the default frame buffer
+bool CreateHeadlessContext(unsigned int width, unsigned int height, unsigned int &framebuffer);
+void DestroyHeadlessContext();
+//attach the headless context to the calling thread or detach it, so another thread can take it over
+void MakeHeadlessContextCurrent(bool current);
+
+//route draw and bind calls through counting wrappers which update renderStats
+void InstallCallCounters();
+
+//camera path of benchmark mode, replaces keyboard and cursor callbacks
+void ScriptedCameraPath(unsigned int frame, unsigned int frameCount, glm::vec3 &position, glm::vec3 &front);
+
+//collects CPU time, GPU time and call counters of every frame
+class FrameRecorder
+{
+public:
+	void Init();
+	void BeginFrame(unsigned int frame);
+	void EndFrame();
+	//wait for outstanding timer queries
+	void Finish();
+	//write <path>.csv and <path>.json
+	bool WriteResults(const std::string &path) const;
+
+private:
+	void CollectQuery(unsigned int slot);
+
+	static const unsigned int QUERY_RING_SIZE = 4;
+	unsigned int queries[QUERY_RING_SIZE];
+	int querySample[QUERY_RING_SIZE];
+	unsigned int currentSlot = 0;
+
+	std::vector<FrameSample> samples;
+	std::chrono::high_resolution_clock::time_point frameStart;
+	//span of all recorded frames, frames overlap with the render thread so it is shorter than the sum of cpu times
+	std::chrono::high_resolution_clock::time_point firstFrameStart;
+	std::chrono::high_resolution_clock::time_point lastFrameEnd;
+};
@@ -0,0 +1,290 @@
+#include "EntityStore.h"
+#include "Random.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+
+Entity EntityStore::Create(const glm::vec3 &position, const glm::quat &rotation, const glm::vec3 &scale, Entity parent)
+{
+	Entity entity = Count();
+	if (parent != NO_ENTITY && parent >= entity)
+	{
+		std::cout << "ERROR: ENTITY PARENT MUST BE CREATED BEFORE ITS CHILDREN" << std::endl;
+		parent = NO_ENTITY;
+	}
+
+	positionX.push_back(position.x);
+	positionY.push_back(position.y);
+	positionZ.push_back(position.z);
+	rotationX.push_back(rotation.x);
+	rotationY.push_back(rotation.y);
+	rotationZ.push_back(rotation.z);
+	rotationW.push_back(rotation.w);
+	scaleX.push_back(scale.x);
+	scaleY.push_back(scale.y);
+	scaleZ.push_back(scale.z);
+	this->parent.push_back(parent);
+	dirty.push_back(1);
+	world.push_back(glm::mat4());
+	anyDirty = true;
+	return entity;
+}
+
+void EntityStore::Clear()
+{
+	positionX.clear(); positionY.clear(); positionZ.clear();
+	rotationX.clear(); rotationY.clear(); rotationZ.clear(); rotationW.clear();
+	scaleX.clear(); scaleY.clear(); scaleZ.clear();
+	parent.clear();
+	dirty.clear();
+	world.clear();
+	anyDirty = false;
+	version++;
+}
+
+void EntityStore::SetPosition(Entity entity, const glm::vec3 &position)
+{
+	positionX[entity] = position.x;
+	positionY[entity] = position.y;
+	positionZ[entity] = position.z;
+	dirty[entity] = 1;
+	anyDirty = true;
+}
+
+void EntityStore::SetRotation(Entity entity, const glm::quat &rotation)
+{
+	rotationX[entity] = rotation.x;
+	rotationY[entity] = rotation.y;
+	rotationZ[entity] = rotation.z;
+	rotationW[entity] = rotation.w;
+	dirty[entity] = 1;
+	anyDirty = true;
+}
+
+void EntityStore::SetScale(Entity entity, const glm::vec3 &scale)
+{
+	scaleX[entity] = scale.x;
+	scaleY[entity] = scale.y;
+	scaleZ[entity] = scale.z;
+	dirty[entity] = 1;
+	anyDirty = true;
+}
+
+#if USE_SSE
+//lanes of entities e[0..3], a single load when they are consecutive
+static inline __m128 Gather(const std::vector<float> &values, const Entity *e)
+{
+	if (e[3] == e[0] + 3) { return _mm_loadu_ps(&values[e[0]]); }
+	return _mm_setr_ps(values[e[0]], values[e[1]], values[e[2]], values[e[3]]);
+}
+
+//out = a * b of column major matrices, out may alias b
+static inline void MultiplyMatrix(const float *a, const float *b, float *out)
+{
+	__m128 a0 = _mm_loadu_ps(a), a1 = _mm_loadu_ps(a + 4), a2 = _mm_loadu_ps(a + 8), a3 = _mm_loadu_ps(a + 12);
+	for (int column = 0; column < 4; column++)
+	{
+		__m128 bColumn = _mm_loadu_ps(b + column * 4);
+		__m128 result = _mm_mul_ps(a0, _mm_shuffle_ps(bColumn, bColumn, _MM_SHUFFLE(0, 0, 0, 0)));
+		result = _mm_add_ps(result, _mm_mul_ps(a1, _mm_shuffle_ps(bColumn, bColumn, _MM_SHUFFLE(1, 1, 1, 1))));
+		result = _mm_add_ps(result, _mm_mul_ps(a2, _mm_shuffle_ps(bColumn, bColumn, _MM_SHUFFLE(2, 2, 2, 2))));
+		result = _mm_add_ps(result, _mm_mul_ps(a3, _mm_shuffle_ps(bColumn, bColumn, _MM_SHUFFLE(3, 3, 3, 3))));
+		_mm_storeu_ps(out + column * 4, result);
+	}
+}
+#endif
+
+//translation * rotation * scale of the listed entities into world, parents are applied afterwards
+void EntityStore::ComposeLocal(const Entity *entities, unsigned int count)
+{
+#if USE_SSE
+	const __m128 one = _mm_set1_ps(1.0f), two = _mm_set1_ps(2.0f), zero = _mm_setzero_ps();
+	for (unsigned int i = 0; i < count; i += 4)
+	{
+		//lanes past the end repeat the last entity, it is simply written again
+		Entity e[4];
+		for (unsigned int lane = 0; lane < 4; lane++) { e[lane] = entities[std::min(i + lane, count - 1)]; }
+
+		__m128 qx = Gather(rotationX, e), qy = Gather(rotationY, e), qz = Gather(rotationZ, e), qw = Gather(rotationW, e);
+		__m128 sx = Gather(scaleX, e), sy = Gather(scaleY, e), sz = Gather(scaleZ, e);
+
+		__m128 xx = _mm_mul_ps(qx, qx), yy = _mm_mul_ps(qy, qy), zz = _mm_mul_ps(qz, qz);
+		__m128 xy = _mm_mul_ps(qx, qy), xz = _mm_mul_ps(qx, qz), yz = _mm_mul_ps(qy, qz);
+		__m128 wx = _mm_mul_ps(qw, qx), wy = _mm_mul_ps(qw, qy), wz = _mm_mul_ps(qw, qz);
+
+		//every register holds one matrix element of four entities
+		__m128 columns[4][4];
+		columns[0][0] = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz))), sx);
+		columns[0][1] = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xy, wz)), sx);
+		columns[0][2] = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xz, wy)), sx);
+		columns[0][3] = zero;
+		columns[1][0] = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xy, wz)), sy);
+		columns[1][1] = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz))), sy);
+		columns[1][2] = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(yz, wx)), sy);
+		columns[1][3] = zero;
+		columns[2][0] = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xz, wy)), sz);
+		columns[2][1] = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(yz, wx)), sz);
+		columns[2][2] = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy))), sz);
+		columns[2][3] = zero;
+		columns[3][0] = Gather(positionX, e);
+		columns[3][1] = Gather(positionY, e);
+		columns[3][2] = Gather(positionZ, e);
+		columns[3][3] = one;
+
+		//transpose turns element registers into one column per entity
+		for (int column = 0; column < 4; column++)
+		{
+			__m128 r0 = columns[column][0], r1 = columns[column][1], r2 = columns[column][2], r3 = columns[column][3];
+			_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+			_mm_storeu_ps(&world[e[0]][column][0], r0);
+			_mm_storeu_ps(&world[e[1]][column][0], r1);
+			_mm_storeu_ps(&world[e[2]][column][0], r2);
+			_mm_storeu_ps(&world[e[3]][column][0], r3);
+		}
+	}
+#else
+	for (unsigned int i = 0; i < count; i++)
+	{
+		Entity e = entities[i];
+		float x = rotationX[e], y = rotationY[e], z = rotationZ[e], w = rotationW[e];
+		glm::mat4 &m = world[e];
+		m[0] = glm::vec4(1.0f - 2.0f * (y * y + z * z), 2.0f * (x * y + w * z), 2.0f * (x * z - w * y), 0.0f) * scaleX[e];
+		m[1] = glm::vec4(2.0f * (x * y - w * z), 1.0f - 2.0f * (x * x + z * z), 2.0f * (y * z + w * x), 0.0f) * scaleY[e];
+		m[2] = glm::vec4(2.0f * (x * z + w * y), 2.0f * (y * z - w * x), 1.0f - 2.0f * (x * x + y * y), 0.0f) * scaleZ[e];
+		m[3] = glm::vec4(positionX[e], positionY[e], positionZ[e], 1.0f);
+	}
+#endif
+}
+
+unsigned int EntityStore::Update()
+{
+	if (!anyDirty) { return 0; }
+
+	//children of dirty entities are dirty too, parents come first so one pass covers every depth
+	updateList.clear();
+	for (Entity e = 0; e < Count(); e++)
+	{
+		if (!dirty[e] && parent[e] != NO_ENTITY && dirty[parent[e]]) { dirty[e] = 1; }
+		if (dirty[e]) { updateList.push_back(e); }
+	}
+
+	ComposeLocal(updateList.data(), (unsigned int)updateList.size());
+
+	for (Entity e : updateList)
+	{
+		if (parent[e] != NO_ENTITY)
+		{
+#if USE_SSE
+			MultiplyMatrix(&world[parent[e]][0][0], &world[e][0][0], &world[e][0][0]);
+#else
+			world[e] = world[parent[e]] * world[e];
+#endif
+		}
+	}
+
+	for (Entity e : updateList) { dirty[e] = 0; }
+	anyDirty = false;
+	version++;
+	return (unsigned int)updateList.size();
+}
+
+bool RunTransformBenchmark(unsigned int count)
+{
+	if (count == 0) { count = 1; }
+	const unsigned int ITERATIONS = 100;
+
+	//random transforms, every fourth entity is the child of an earlier one
+	Random random(1234);
+	std::vector<glm::vec3> positions(count), scales(count), axes(count);
+	std::vector<float> angles(count);
+	std::vector<Entity> parents(count, NO_ENTITY);
+	for (unsigned int i = 0; i < count; i++)
+	{
+		positions[i] = glm::vec3(random.Unit() * 20.0f - 10.0f, random.Unit() * 2.0f, random.Unit() * 20.0f - 10.0f);
+		scales[i] = glm::vec3(0.1f + random.Unit());
+		axes[i] = glm::normalize(glm::vec3(random.Unit() - 0.5f, random.Unit() - 0.5f, random.Unit() - 0.5f) + glm::vec3(0.0f, 0.01f, 0.0f));
+		angles[i] = random.Unit() * 6.2831853f;
+		if (i > 0 && i % 4 == 0) { parents[i] = (Entity)random.Below(i); }
+	}
+
+	EntityStore store;
+	for (unsigned int i = 0; i < count; i++) { store.Create(positions[i], glm::angleAxis(angles[i], axes[i]), scales[i], parents[i]); }
+	store.Update();
+
+	//checksums keep the compiler from dropping the work
+	float checksum = 0.0f;
+	auto time = [](std::chrono::high_resolution_clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count() / ITERATIONS;
+	};
+
+	//per object glm calls, every object rotates every frame
+	std::vector<glm::mat4> models(count);
+	auto start = std::chrono::high_resolution_clock::now();
+	for (unsigned int iteration = 0; iteration < ITERATIONS; iteration++)
+	{
+		for (unsigned int i = 0; i < count; i++)
+		{
+			glm::mat4 model = glm::translate(glm::mat4(), positions[i]);
+			model = model * glm::mat4_cast(glm::angleAxis(angles[i] + iteration * 0.01f, axes[i]));
+			model = glm::scale(model, scales[i]);
+			models[i] = parents[i] != NO_ENTITY ? models[parents[i]] * model : model;
+		}
+		checksum += models[iteration % count][3][0];
+	}
+	double glmMs = time(start);
+
+	//same work through the store, rotation quaternions are built outside of the matrix update in both
+	start = std::chrono::high_resolution_clock::now();
+	for (unsigned int iteration = 0; iteration < ITERATIONS; iteration++)
+	{
+		for (unsigned int i = 0; i < count; i++) { store.SetRotation(i, glm::angleAxis(angles[i] + iteration * 0.01f, axes[i])); }
+		store.Update();
+		checksum += store.World(iteration % count)[3][0];
+	}
+	double storeMs = time(start);
+
+	//both ran the same last iteration, so every world matrix must match the glm one up to rounding
+	unsigned int mismatched = 0;
+	for (unsigned int i = 0; i < count; i++)
+	{
+		const glm::mat4 &world = store.World(i);
+		bool match = true;
+		for (int column = 0; column < 4; column++)
+		{
+			for (int row = 0; row < 4; row++)
+			{
+				float expected = models[i][column][row];
+				if (std::abs(world[column][row] - expected) > 1e-4f * std::max(1.0f, std::abs(expected))) { match = false; }
+			}
+		}
+		if (!match) { mismatched++; }
+	}
+
+	//typical frame where only a few objects move
+	unsigned int moving = std::max(1u, count / 10);
+	start = std::chrono::high_resolution_clock::now();
+	for (unsigned int iteration = 0; iteration < ITERATIONS; iteration++)
+	{
+		for (unsigned int i = 0; i < moving; i++)
+		{
+			Entity e = (i * 10 + iteration) % count;
+			store.SetRotation(e, glm::angleAxis(angles[e] + iteration * 0.01f, axes[e]));
+		}
+		store.Update();
+		checksum += store.World(iteration % count)[3][0];
+	}
+	double partialMs = time(start);
+
+	std::cout << "transform update of " << count << " entities, " << ITERATIONS << " iterations (" << (USE_SSE ? "SSE" : "scalar") << ")" << std::endl;
+	std::cout << "  per-object glm         " << glmMs << " ms" << std::endl;
+	std::cout << "  entity store, all      " << storeMs << " ms" << std::endl;
+	std::cout << "  entity store, 10% moving " << partialMs << " ms" << std::endl;
+	std::cout << "  checksum " << checksum << std::endl;
+	if (mismatched == 0) { std::cout << "  entity store matches per-object glm" << std::endl; }
+	else { std::cout << "  entity store DIFFERS FROM per-object glm for " << mismatched << " of " << count << " entities" << std::endl; }
+	return mismatched == 0;
+}
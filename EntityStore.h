@@ -0,0 +1,53 @@
+#pragma once
+
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include "Simd.h"
+
+typedef unsigned int Entity;
+const Entity NO_ENTITY = 0xFFFFFFFF;
+
+//transforms of scene objects as structure of arrays, world matrices are rebuilt only for entities
+//whose transform or parent changed since the last Update, four at a time with SSE
+//parents must be created before their children, so one pass in creation order resolves every hierarchy
+class EntityStore
+{
+public:
+	Entity Create(const glm::vec3 &position, const glm::quat &rotation = glm::quat(), const glm::vec3 &scale = glm::vec3(1.0f), Entity parent = NO_ENTITY);
+	void Clear();
+
+	void SetPosition(Entity entity, const glm::vec3 &position);
+	void SetRotation(Entity entity, const glm::quat &rotation);
+	void SetScale(Entity entity, const glm::vec3 &scale);
+	glm::vec3 GetPosition(Entity entity) const { return glm::vec3(positionX[entity], positionY[entity], positionZ[entity]); }
+	Entity GetParent(Entity entity) const { return parent[entity]; }
+
+	//rebuild world matrices of dirty entities and their descendants, returns number of rebuilt matrices
+	unsigned int Update();
+	//world matrix as of the last Update
+	const glm::mat4 &World(Entity entity) const { return world[entity]; }
+	unsigned int Count() const { return (unsigned int)parent.size(); }
+
+	//increased by every Update which rebuilt a matrix, lets users skip copying unchanged matrices
+	unsigned int version = 0;
+
+private:
+	void ComposeLocal(const Entity *entities, unsigned int count);
+
+	std::vector<float> positionX, positionY, positionZ;
+	std::vector<float> rotationX, rotationY, rotationZ, rotationW;
+	std::vector<float> scaleX, scaleY, scaleZ;
+	std::vector<Entity> parent;
+	std::vector<unsigned char> dirty;
+	std::vector<glm::mat4> world;
+	//entities rebuilt by the running Update, in creation order
+	std::vector<Entity> updateList;
+	bool anyDirty = false;
+};
+
+//time per-object glm matrix building against EntityStore::Update for count entities and print both,
+//returns whether the store built the same world matrices as glm
+bool RunTransformBenchmark(unsigned int count);
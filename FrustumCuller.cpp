@@ -0,0 +1,87 @@
+#include "FrustumCuller.h"
+
+Frustum FrustumFromMatrix(const glm::mat4 &viewProjection)
+{
+	//planes are sums and differences of the fourth row with the other rows
+	glm::vec4 rows[4];
+	for (int i = 0; i < 4; i++) { rows[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]); }
+
+	Frustum frustum;
+	for (int i = 0; i < 3; i++)
+	{
+		frustum.planes[i * 2] = rows[3] + rows[i];
+		frustum.planes[i * 2 + 1] = rows[3] - rows[i];
+	}
+	for (glm::vec4 &plane : frustum.planes) { plane /= glm::length(glm::vec3(plane)); }
+	return frustum;
+}
+
+void BoundingSpheres::Clear()
+{
+	centerX.clear();
+	centerY.clear();
+	centerZ.clear();
+	radius.clear();
+}
+
+void BoundingSpheres::Add(const glm::vec3 &center, float sphereRadius)
+{
+	centerX.push_back(center.x);
+	centerY.push_back(center.y);
+	centerZ.push_back(center.z);
+	radius.push_back(sphereRadius);
+}
+
+unsigned int CullSpheres(const Frustum *frusta, unsigned int frustumCount, const BoundingSpheres &spheres, std::vector<unsigned int> &visible)
+{
+	size_t first = visible.size();
+	unsigned int count = spheres.Count();
+	unsigned int i = 0;
+
+#if USE_SSE
+	//sphere is outside when its signed distance to any plane is below -radius
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128 x = _mm_loadu_ps(&spheres.centerX[i]), y = _mm_loadu_ps(&spheres.centerY[i]), z = _mm_loadu_ps(&spheres.centerZ[i]);
+		__m128 negativeRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(&spheres.radius[i]));
+
+		__m128 anyInside = _mm_setzero_ps(), allSet = _mm_cmpeq_ps(anyInside, anyInside);
+		for (unsigned int f = 0; f < frustumCount; f++)
+		{
+			__m128 inside = allSet;
+			for (const glm::vec4 &plane : frusta[f].planes)
+			{
+				__m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(plane.x)), _mm_mul_ps(y, _mm_set1_ps(plane.y))),
+					_mm_add_ps(_mm_mul_ps(z, _mm_set1_ps(plane.z)), _mm_set1_ps(plane.w)));
+				inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negativeRadius));
+			}
+			anyInside = _mm_or_ps(anyInside, inside);
+		}
+
+		int mask = _mm_movemask_ps(anyInside);
+		for (unsigned int lane = 0; lane < 4; lane++)
+		{
+			if (mask & (1 << lane)) { visible.push_back(i + lane); }
+		}
+	}
+#endif
+
+	for (; i < count; i++)
+	{
+		for (unsigned int f = 0; f < frustumCount; f++)
+		{
+			bool inside = true;
+			for (const glm::vec4 &plane : frusta[f].planes)
+			{
+				float distance = plane.x * spheres.centerX[i] + plane.y * spheres.centerY[i] + plane.z * spheres.centerZ[i] + plane.w;
+				if (distance < -spheres.radius[i]) { inside = false; break; }
+			}
+			if (inside)
+			{
+				visible.push_back(i);
+				break;
+			}
+		}
+	}
+	return (unsigned int)(visible.size() - first);
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Simd.h"
+
+//six planes (left, right, bottom, top, near, far) with normals pointing inside, xyz normalized
+struct Frustum
+{
+	glm::vec4 planes[6];
+};
+
+//planes of the clip volume of a projection * view matrix
+Frustum FrustumFromMatrix(const glm::mat4 &viewProjection);
+
+//world space bounding spheres as structure of arrays so four are tested per SSE instruction
+struct BoundingSpheres
+{
+	std::vector<float> centerX, centerY, centerZ, radius;
+
+	void Clear();
+	void Add(const glm::vec3 &center, float sphereRadius);
+	unsigned int Count() const { return (unsigned int)radius.size(); }
+};
+
+//objects of the views culled during a frame, occluded are the culled ones hidden behind occluders
+//and drawn the ones left, tested - culled
+struct CullingStats
+{
+	unsigned int tested = 0;
+	unsigned int culled = 0;
+	unsigned int occluded = 0;
+	unsigned int drawn = 0;
+};
+
+//append indices of spheres touching at least one of the frusta to visible, returns number appended
+//several frusta are tested in one pass for draws which feed more than one view, e.g. the layered shadow pass
+unsigned int CullSpheres(const Frustum *frusta, unsigned int frustumCount, const BoundingSpheres &spheres, std::vector<unsigned int> &visible);
@@ -0,0 +1,763 @@
+#include "GLBackend.h"
+#include "Benchmark.h"
+
+#include <glad/glad.h>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <unordered_map>
+#include <utility>
+
+//KHR_parallel_shader_compile is only declared by glad loaders generated with it
+#ifdef GL_KHR_parallel_shader_compile
+#define GL_KHR_PARALLEL_SHADER_COMPILE_FUNCTIONS(X) X(glMaxShaderCompilerThreadsKHR)
+#else
+#define GL_KHR_PARALLEL_SHADER_COMPILE_FUNCTIONS(X)
+#endif
+
+//every GL function the demo calls
+#define GL_FUNCTIONS(X) \
+	X(glActiveTexture) X(glAttachShader) X(glBeginQuery) X(glBindBuffer) X(glBindBufferBase) X(glBindFramebuffer) \
+	X(glBindRenderbuffer) X(glBindTexture) X(glBindVertexArray) X(glBlendFunc) X(glBufferData) X(glBufferSubData) \
+	X(glCheckFramebufferStatus) X(glClear) X(glClearColor) X(glCompileShader) X(glCompressedTexImage2D) X(glCreateProgram) \
+	X(glCreateShader) X(glCullFace) X(glDeleteBuffers) X(glDeleteFramebuffers) X(glDeleteProgram) X(glDeleteQueries) \
+	X(glDeleteRenderbuffers) X(glDeleteShader) X(glDepthFunc) X(glDisable) X(glDrawArrays) X(glDrawArraysInstanced) \
+	X(glDrawBuffer) X(glDrawElements) X(glDrawElementsInstanced) X(glEnable) X(glEnableVertexAttribArray) X(glEndQuery) \
+	X(glFlush) X(glFramebufferRenderbuffer) X(glFramebufferTexture) X(glGenBuffers) \
+	X(glGenFramebuffers) X(glGenQueries) X(glGenRenderbuffers) X(glGenTextures) X(glGenVertexArrays) X(glGenerateMipmap) \
+	X(glGetActiveUniform) X(glGetActiveUniformBlockName) X(glGetInteger64v) X(glGetIntegerv) X(glGetProgramBinary) \
+	X(glGetProgramInfoLog) X(glGetProgramiv) X(glGetQueryObjectiv) X(glGetQueryObjectui64v) X(glGetShaderInfoLog) \
+	X(glGetShaderiv) X(glGetString) X(glGetUniformLocation) X(glLinkProgram) X(glMapBufferRange) \
+	GL_KHR_PARALLEL_SHADER_COMPILE_FUNCTIONS(X) X(glPixelStorei) X(glProgramBinary) X(glProgramParameteri) X(glQueryCounter) \
+	X(glReadBuffer) X(glRenderbufferStorage) X(glScissor) X(glShaderSource) X(glTexBuffer) X(glTexImage2D) X(glTexImage3D) \
+	X(glTexParameterfv) X(glTexParameteri) X(glTexSubImage3D) X(glUniform1f) X(glUniform1i) X(glUniform1iv) \
+	X(glUniform2fv) X(glUniform3fv) X(glUniform4fv) X(glUniformBlockBinding) X(glUniformMatrix4fv) X(glUnmapBuffer) \
+	X(glUseProgram) X(glVertexAttribDivisor) X(glVertexAttribPointer) X(glViewport)
+
+#define GL_FUNCTION_ENUM(name) GL_FUNCTION_##name,
+enum GLFunction
+{
+	GL_FUNCTIONS(GL_FUNCTION_ENUM)
+	GL_FUNCTION_COUNT
+};
+
+#define GL_FUNCTION_NAME(name) #name,
+static const char *const GL_FUNCTION_NAMES[] = { GL_FUNCTIONS(GL_FUNCTION_NAME) };
+
+//arguments and results to and from the integers of a GLCall
+inline uint64_t PackGLArgument(float value)
+{
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	return bits;
+}
+template<typename T>
+uint64_t PackGLArgument(T *value) { return (uint64_t)(uintptr_t)value; }
+template<typename T>
+uint64_t PackGLArgument(T value) { return (uint64_t)value; }
+
+template<typename T>
+struct GLArgument
+{
+	static T Unpack(uint64_t value) { return (T)value; }
+};
+template<typename T>
+struct GLArgument<T *>
+{
+	static T *Unpack(uint64_t value) { return (T *)(uintptr_t)value; }
+};
+template<>
+struct GLArgument<float>
+{
+	static float Unpack(uint64_t value)
+	{
+		uint32_t bits = (uint32_t)value;
+		float result;
+		memcpy(&result, &bits, sizeof(result));
+		return result;
+	}
+};
+
+//calls a GL function and packs what it returns, 0 for void functions
+template<typename R>
+struct GLReturn
+{
+	template<typename F, typename... A>
+	static uint64_t Call(F function, A... args) { return PackGLArgument(function(args...)); }
+	static R Unpack(uint64_t value) { return GLArgument<R>::Unpack(value); }
+};
+template<>
+struct GLReturn<void>
+{
+	template<typename F, typename... A>
+	static uint64_t Call(F function, A... args)
+	{
+		function(args...);
+		return 0;
+	}
+	static void Unpack(uint64_t) {}
+};
+
+template<typename... A>
+static GLCall PackGLCall(GLFunction function, A... args)
+{
+	//leading 0 keeps the array valid for functions without arguments
+	const uint64_t packed[] = { 0, PackGLArgument(args)... };
+	GLCall call;
+	memset(&call, 0, sizeof(call));
+	call.function = function;
+	call.dataOffset = GL_CALL_NO_DATA;
+	for (size_t i = 1; i < sizeof(packed) / sizeof(packed[0]); i++) { call.args[i - 1] = packed[i]; }
+	return call;
+}
+
+//the null backend
+
+static unsigned int nullNames = 0;
+static std::vector<unsigned char> nullMapping;
+
+static uint64_t NullGLCall(const GLCall &call)
+{
+	const uint64_t *args = call.args;
+	switch (call.function)
+	{
+	case GL_FUNCTION_glGenBuffers:
+	case GL_FUNCTION_glGenFramebuffers:
+	case GL_FUNCTION_glGenQueries:
+	case GL_FUNCTION_glGenRenderbuffers:
+	case GL_FUNCTION_glGenTextures:
+	case GL_FUNCTION_glGenVertexArrays:
+		for (GLsizei i = 0; i < (GLsizei)args[0]; i++) { ((GLuint *)(uintptr_t)args[1])[i] = ++nullNames; }
+		return 0;
+	case GL_FUNCTION_glCreateProgram:
+	case GL_FUNCTION_glCreateShader:
+		return ++nullNames;
+	case GL_FUNCTION_glGetShaderiv:
+	case GL_FUNCTION_glGetProgramiv:
+		*(GLint *)(uintptr_t)args[2] = (args[1] == GL_COMPILE_STATUS || args[1] == GL_LINK_STATUS) ? GL_TRUE : 0;
+		return 0;
+	case GL_FUNCTION_glGetIntegerv:
+		*(GLint *)(uintptr_t)args[1] = 0;
+		return 0;
+	case GL_FUNCTION_glGetInteger64v:
+		*(GLint64 *)(uintptr_t)args[1] = 0;
+		return 0;
+	case GL_FUNCTION_glGetQueryObjectiv:
+		*(GLint *)(uintptr_t)args[2] = args[1] == GL_QUERY_RESULT_AVAILABLE ? GL_TRUE : 0;
+		return 0;
+	case GL_FUNCTION_glGetQueryObjectui64v:
+		*(GLuint64 *)(uintptr_t)args[2] = 0;
+		return 0;
+	case GL_FUNCTION_glGetProgramInfoLog:
+	case GL_FUNCTION_glGetShaderInfoLog:
+		if (args[2]) { *(GLsizei *)(uintptr_t)args[2] = 0; }
+		if ((GLsizei)args[1] > 0) { *(GLchar *)(uintptr_t)args[3] = 0; }
+		return 0;
+	case GL_FUNCTION_glGetActiveUniform:
+		if (args[3]) { *(GLsizei *)(uintptr_t)args[3] = 0; }
+		*(GLint *)(uintptr_t)args[4] = 0;
+		*(GLenum *)(uintptr_t)args[5] = 0;
+		if ((GLsizei)args[2] > 0) { *(GLchar *)(uintptr_t)args[6] = 0; }
+		return 0;
+	case GL_FUNCTION_glGetActiveUniformBlockName:
+		if (args[3]) { *(GLsizei *)(uintptr_t)args[3] = 0; }
+		if ((GLsizei)args[2] > 0) { *(GLchar *)(uintptr_t)args[4] = 0; }
+		return 0;
+	case GL_FUNCTION_glGetProgramBinary:
+		if (args[2]) { *(GLsizei *)(uintptr_t)args[2] = 0; }
+		return 0;
+	case GL_FUNCTION_glGetString:
+		return PackGLArgument("Null GL backend");
+	case GL_FUNCTION_glGetUniformLocation:
+		return (uint64_t)-1;
+	case GL_FUNCTION_glCheckFramebufferStatus:
+		return GL_FRAMEBUFFER_COMPLETE;
+	case GL_FUNCTION_glMapBufferRange:
+		//writes into the mapping go to scratch memory
+		nullMapping.resize((size_t)args[2]);
+		return PackGLArgument(nullMapping.data());
+	case GL_FUNCTION_glUnmapBuffer:
+		return GL_TRUE;
+	default:
+		return 0;
+	}
+}
+
+template<GLFunction Function, typename F>
+struct GLNull;
+template<GLFunction Function, typename R, typename... A>
+struct GLNull<Function, R (APIENTRYP)(A...)>
+{
+	static R APIENTRY Call(A... args) { return GLReturn<R>::Unpack(NullGLCall(PackGLCall(Function, args...))); }
+};
+
+#define INSTALL_NULL_GL_FUNCTION(name) glad_##name = &GLNull<GL_FUNCTION_##name, decltype(glad_##name)>::Call;
+
+void InstallNullGLBackend()
+{
+	GL_FUNCTIONS(INSTALL_NULL_GL_FUNCTION)
+}
+
+//the recording backend
+
+static GLCallLog recordedCalls;
+static bool recording = false;
+//pixel unpack state of the recorded calls, it decides how many bytes an image upload reads
+static GLint unpackAlignment = 4, unpackRowLength = 0;
+static GLuint unpackBuffer = 0;
+//range mapped by the last glMapBufferRange, copied into the log when it is unmapped
+static void *mappedData = nullptr;
+static size_t mappedSize = 0;
+
+static void RecordGLData(GLCall &call, const void *data, size_t size)
+{
+	call.dataOffset = recordedCalls.data.size();
+	call.dataSize = (uint32_t)size;
+	recordedCalls.data.insert(recordedCalls.data.end(), (const unsigned char *)data, (const unsigned char *)data + size);
+}
+
+static size_t PixelBytes(GLenum format, GLenum type)
+{
+	size_t components = 4;
+	switch (format)
+	{
+	case GL_RED: case GL_DEPTH_COMPONENT: components = 1; break;
+	case GL_RG: components = 2; break;
+	case GL_RGB: case GL_BGR: components = 3; break;
+	}
+	switch (type)
+	{
+	case GL_UNSIGNED_BYTE: case GL_BYTE: return components;
+	case GL_UNSIGNED_SHORT: case GL_SHORT: case GL_HALF_FLOAT: return components * 2;
+	default: return components * 4;
+	}
+}
+
+//bytes an upload reads from client memory, rows padded to the unpack alignment but not the last one
+static size_t ImageBytes(uint64_t width, uint64_t height, uint64_t depth, GLenum format, GLenum type)
+{
+	if (width == 0 || height == 0 || depth == 0) { return 0; }
+	size_t pixel = PixelBytes(format, type);
+	size_t rowPixels = unpackRowLength > 0 ? (size_t)unpackRowLength : (size_t)width;
+	size_t rowBytes = (rowPixels * pixel + unpackAlignment - 1) / unpackAlignment * unpackAlignment;
+	return rowBytes * (size_t)(height * depth - 1) + (size_t)width * pixel;
+}
+
+//copies data a call reads before it is forwarded
+static void RecordGLInput(GLCall &call)
+{
+	const uint64_t *args = call.args;
+	switch (call.function)
+	{
+	case GL_FUNCTION_glPixelStorei:
+		if (args[0] == GL_UNPACK_ALIGNMENT) { unpackAlignment = (GLint)args[1]; }
+		if (args[0] == GL_UNPACK_ROW_LENGTH) { unpackRowLength = (GLint)args[1]; }
+		break;
+	case GL_FUNCTION_glBindBuffer:
+		if (args[0] == GL_PIXEL_UNPACK_BUFFER) { unpackBuffer = (GLuint)args[1]; }
+		break;
+	case GL_FUNCTION_glBufferData:
+		if (args[2]) { RecordGLData(call, (const void *)(uintptr_t)args[2], (size_t)args[1]); }
+		break;
+	case GL_FUNCTION_glBufferSubData:
+		if (args[3]) { RecordGLData(call, (const void *)(uintptr_t)args[3], (size_t)args[2]); }
+		break;
+	//with a pixel unpack buffer bound the pointer is an offset into it
+	case GL_FUNCTION_glTexImage2D:
+		if (args[8] && !unpackBuffer) { RecordGLData(call, (const void *)(uintptr_t)args[8], ImageBytes(args[3], args[4], 1, (GLenum)args[6], (GLenum)args[7])); }
+		break;
+	case GL_FUNCTION_glTexImage3D:
+		if (args[9] && !unpackBuffer) { RecordGLData(call, (const void *)(uintptr_t)args[9], ImageBytes(args[3], args[4], args[5], (GLenum)args[7], (GLenum)args[8])); }
+		break;
+	case GL_FUNCTION_glTexSubImage3D:
+		if (args[10] && !unpackBuffer) { RecordGLData(call, (const void *)(uintptr_t)args[10], ImageBytes(args[5], args[6], args[7], (GLenum)args[8], (GLenum)args[9])); }
+		break;
+	case GL_FUNCTION_glCompressedTexImage2D:
+		if (args[7] && !unpackBuffer) { RecordGLData(call, (const void *)(uintptr_t)args[7], (size_t)args[6]); }
+		break;
+	case GL_FUNCTION_glTexParameterfv:
+		RecordGLData(call, (const void *)(uintptr_t)args[2], (args[1] == GL_TEXTURE_BORDER_COLOR ? 4 : 1) * sizeof(GLfloat));
+		break;
+	case GL_FUNCTION_glUniform1iv:
+		RecordGLData(call, (const void *)(uintptr_t)args[2], (size_t)args[1] * sizeof(GLint));
+		break;
+	case GL_FUNCTION_glUniform2fv:
+		RecordGLData(call, (const void *)(uintptr_t)args[2], (size_t)args[1] * 2 * sizeof(GLfloat));
+		break;
+	case GL_FUNCTION_glUniform3fv:
+		RecordGLData(call, (const void *)(uintptr_t)args[2], (size_t)args[1] * 3 * sizeof(GLfloat));
+		break;
+	case GL_FUNCTION_glUniform4fv:
+		RecordGLData(call, (const void *)(uintptr_t)args[2], (size_t)args[1] * 4 * sizeof(GLfloat));
+		break;
+	case GL_FUNCTION_glUniformMatrix4fv:
+		RecordGLData(call, (const void *)(uintptr_t)args[3], (size_t)args[1] * 16 * sizeof(GLfloat));
+		break;
+	case GL_FUNCTION_glProgramBinary:
+		RecordGLData(call, (const void *)(uintptr_t)args[2], (size_t)args[3]);
+		break;
+	case GL_FUNCTION_glDeleteBuffers:
+	case GL_FUNCTION_glDeleteFramebuffers:
+	case GL_FUNCTION_glDeleteQueries:
+	case GL_FUNCTION_glDeleteRenderbuffers:
+		RecordGLData(call, (const void *)(uintptr_t)args[1], (size_t)args[0] * sizeof(GLuint));
+		break;
+	case GL_FUNCTION_glShaderSource:
+	{
+		//strings are joined and issued again as one
+		std::string source;
+		const GLchar *const *strings = (const GLchar *const *)(uintptr_t)args[2];
+		const GLint *lengths = (const GLint *)(uintptr_t)args[3];
+		for (GLsizei i = 0; i < (GLsizei)args[1]; i++)
+		{
+			if (lengths && lengths[i] >= 0) { source.append(strings[i], lengths[i]); }
+			else { source.append(strings[i]); }
+		}
+		RecordGLData(call, source.data(), source.size());
+		break;
+	}
+	case GL_FUNCTION_glUnmapBuffer:
+		if (mappedData) { RecordGLData(call, mappedData, mappedSize); }
+		mappedData = nullptr;
+		break;
+	}
+}
+
+//copies data a call wrote after it returned, then logs the call
+static void RecordGLOutput(GLCall &call)
+{
+	const uint64_t *args = call.args;
+	switch (call.function)
+	{
+	case GL_FUNCTION_glGenBuffers:
+	case GL_FUNCTION_glGenFramebuffers:
+	case GL_FUNCTION_glGenQueries:
+	case GL_FUNCTION_glGenRenderbuffers:
+	case GL_FUNCTION_glGenTextures:
+	case GL_FUNCTION_glGenVertexArrays:
+		RecordGLData(call, (const void *)(uintptr_t)args[1], (size_t)args[0] * sizeof(GLuint));
+		break;
+	case GL_FUNCTION_glMapBufferRange:
+		mappedData = (void *)(uintptr_t)call.result;
+		mappedSize = (size_t)args[2];
+		break;
+	}
+	recordedCalls.calls.push_back(call);
+}
+
+template<GLFunction Function, typename F>
+struct GLRecorder;
+template<GLFunction Function, typename R, typename... A>
+struct GLRecorder<Function, R (APIENTRYP)(A...)>
+{
+	typedef R (APIENTRYP Pointer)(A...);
+	static Pointer forward;
+
+	static R APIENTRY Call(A... args)
+	{
+		if (!recording) { return forward(args...); }
+		GLCall call = PackGLCall(Function, args...);
+		RecordGLInput(call);
+		call.result = GLReturn<R>::Call(forward, args...);
+		RecordGLOutput(call);
+		return GLReturn<R>::Unpack(call.result);
+	}
+};
+template<GLFunction Function, typename R, typename... A>
+typename GLRecorder<Function, R (APIENTRYP)(A...)>::Pointer GLRecorder<Function, R (APIENTRYP)(A...)>::forward = nullptr;
+
+//functions the driver does not provide stay null
+#define INSTALL_GL_RECORDER(name) \
+	if (glad_##name) \
+	{ \
+		GLRecorder<GL_FUNCTION_##name, decltype(glad_##name)>::forward = glad_##name; \
+		glad_##name = &GLRecorder<GL_FUNCTION_##name, decltype(glad_##name)>::Call; \
+	}
+
+void StartGLRecording(unsigned int defaultFramebuffer, unsigned int width, unsigned int height)
+{
+	recordedCalls = GLCallLog();
+	recordedCalls.defaultFramebuffer = defaultFramebuffer;
+	recordedCalls.width = width;
+	recordedCalls.height = height;
+	GL_FUNCTIONS(INSTALL_GL_RECORDER)
+	recording = true;
+}
+
+void StopGLRecording()
+{
+	recording = false;
+}
+
+void MarkGLFrameBegin()
+{
+	if (!recording) { return; }
+	GLFrameRange frame = { recordedCalls.calls.size(), recordedCalls.calls.size() };
+	recordedCalls.frames.push_back(frame);
+}
+
+void MarkGLFrameEnd()
+{
+	if (!recording || recordedCalls.frames.empty()) { return; }
+	recordedCalls.frames.back().end = recordedCalls.calls.size();
+}
+
+const GLCallLog &RecordedGLCalls()
+{
+	return recordedCalls;
+}
+
+//log files
+
+struct GLCallLogHeader
+{
+	char magic[4];
+	uint32_t version;
+	//logs of another function table do not replay
+	uint32_t functionCount;
+	uint32_t defaultFramebuffer;
+	uint32_t width, height;
+	uint64_t callCount;
+	uint64_t dataSize;
+	uint64_t frameCount;
+};
+static const char GL_CALL_LOG_MAGIC[4] = { 'G', 'L', 'C', 'L' };
+static const uint32_t GL_CALL_LOG_VERSION = 1;
+
+bool WriteGLCallLog(const GLCallLog &log, const std::string &path)
+{
+	std::ofstream file(path, std::ios::binary);
+	if (!file)
+	{
+		std::cout << "ERROR: GL CALL LOG FAILED TO WRITE: " << path << std::endl;
+		return false;
+	}
+
+	GLCallLogHeader header;
+	memcpy(header.magic, GL_CALL_LOG_MAGIC, sizeof(header.magic));
+	header.version = GL_CALL_LOG_VERSION;
+	header.functionCount = GL_FUNCTION_COUNT;
+	header.defaultFramebuffer = log.defaultFramebuffer;
+	header.width = log.width;
+	header.height = log.height;
+	header.callCount = log.calls.size();
+	header.dataSize = log.data.size();
+	header.frameCount = log.frames.size();
+	file.write((const char *)&header, sizeof(header));
+	file.write((const char *)log.calls.data(), log.calls.size() * sizeof(GLCall));
+	file.write((const char *)log.data.data(), log.data.size());
+	file.write((const char *)log.frames.data(), log.frames.size() * sizeof(GLFrameRange));
+	std::cout << "GL call log of " << log.calls.size() << " calls written to " << path << std::endl;
+	return true;
+}
+
+bool ReadGLCallLog(const std::string &path, GLCallLog &log)
+{
+	std::ifstream file(path, std::ios::binary);
+	GLCallLogHeader header;
+	if (!file || !file.read((char *)&header, sizeof(header)) || memcmp(header.magic, GL_CALL_LOG_MAGIC, sizeof(header.magic)) != 0
+		|| header.version != GL_CALL_LOG_VERSION || header.functionCount != GL_FUNCTION_COUNT)
+	{
+		std::cout << "ERROR: GL CALL LOG FAILED TO READ: " << path << std::endl;
+		return false;
+	}
+
+	log.defaultFramebuffer = header.defaultFramebuffer;
+	log.width = header.width;
+	log.height = header.height;
+	log.calls.resize((size_t)header.callCount);
+	log.data.resize((size_t)header.dataSize);
+	log.frames.resize((size_t)header.frameCount);
+	file.read((char *)log.calls.data(), log.calls.size() * sizeof(GLCall));
+	file.read((char *)log.data.data(), log.data.size());
+	file.read((char *)log.frames.data(), log.frames.size() * sizeof(GLFrameRange));
+	if (!file)
+	{
+		std::cout << "ERROR: GL CALL LOG TRUNCATED: " << path << std::endl;
+		return false;
+	}
+	return true;
+}
+
+bool WriteGLCallCounts(const GLCallLog &log, const std::string &path)
+{
+	std::ofstream csv(path);
+	if (!csv)
+	{
+		std::cout << "ERROR: GL CALL COUNTS FAILED TO WRITE: " << path << std::endl;
+		return false;
+	}
+
+	//one row per frame, one column per function called in any of them
+	std::vector<std::vector<uint32_t>> counts(log.frames.size(), std::vector<uint32_t>(GL_FUNCTION_COUNT, 0));
+	std::vector<bool> called(GL_FUNCTION_COUNT, false);
+	for (size_t frame = 0; frame < log.frames.size(); frame++)
+	{
+		for (uint64_t i = log.frames[frame].begin; i < log.frames[frame].end; i++)
+		{
+			uint32_t function = log.calls[(size_t)i].function;
+			counts[frame][function]++;
+			called[function] = true;
+		}
+	}
+
+	csv << "frame";
+	for (unsigned int function = 0; function < GL_FUNCTION_COUNT; function++)
+	{
+		if (called[function]) { csv << "," << GL_FUNCTION_NAMES[function]; }
+	}
+	csv << "\n";
+	for (size_t frame = 0; frame < log.frames.size(); frame++)
+	{
+		csv << frame;
+		for (unsigned int function = 0; function < GL_FUNCTION_COUNT; function++)
+		{
+			if (called[function]) { csv << "," << counts[frame][function]; }
+		}
+		csv << "\n";
+	}
+	return true;
+}
+
+//replay
+
+#define GL_FUNCTION_INVOKER(name) [](const uint64_t *args) -> uint64_t { return glad_##name ? InvokeGL(glad_##name, args) : 0; },
+
+template<typename R, typename... A, size_t... I>
+static uint64_t InvokeGL(R (APIENTRYP function)(A...), const uint64_t *args, std::index_sequence<I...>)
+{
+	return GLReturn<R>::Call(function, GLArgument<A>::Unpack(args[I])...);
+}
+template<typename R, typename... A>
+static uint64_t InvokeGL(R (APIENTRYP function)(A...), const uint64_t *args)
+{
+	return InvokeGL(function, args, std::index_sequence_for<A...>());
+}
+
+//calls whatever the glad pointer of the function is at the time of the call
+static uint64_t (*const GL_INVOKERS[])(const uint64_t *) = { GL_FUNCTIONS(GL_FUNCTION_INVOKER) };
+
+//kinds of object names, programs and shaders share one namespace in GL
+enum GLNameKind
+{
+	GL_NAMES_BUFFER,
+	GL_NAMES_TEXTURE,
+	GL_NAMES_VERTEX_ARRAY,
+	GL_NAMES_FRAMEBUFFER,
+	GL_NAMES_RENDERBUFFER,
+	GL_NAMES_PROGRAM,
+	GL_NAMES_NONE
+};
+
+struct GLReplay
+{
+	//recorded name to the name of the replay context, names not in the map are used as they are
+	std::unordered_map<uint64_t, uint64_t> names[GL_NAMES_NONE];
+	void *mapped = nullptr;
+
+	uint64_t Name(GLNameKind kind, uint64_t name) const
+	{
+		auto it = names[kind].find(name);
+		return it == names[kind].end() ? name : it->second;
+	}
+};
+
+//kind of the names a function generates or deletes
+static GLNameKind ObjectNameKind(uint32_t function)
+{
+	switch (function)
+	{
+	case GL_FUNCTION_glGenBuffers: case GL_FUNCTION_glDeleteBuffers: return GL_NAMES_BUFFER;
+	case GL_FUNCTION_glGenTextures: return GL_NAMES_TEXTURE;
+	case GL_FUNCTION_glGenVertexArrays: return GL_NAMES_VERTEX_ARRAY;
+	case GL_FUNCTION_glGenFramebuffers: case GL_FUNCTION_glDeleteFramebuffers: return GL_NAMES_FRAMEBUFFER;
+	case GL_FUNCTION_glGenRenderbuffers: case GL_FUNCTION_glDeleteRenderbuffers: return GL_NAMES_RENDERBUFFER;
+	case GL_FUNCTION_glCreateProgram: case GL_FUNCTION_glCreateShader: return GL_NAMES_PROGRAM;
+	default: return GL_NAMES_NONE;
+	}
+}
+
+//argument holding an object name, -1 when the function takes none
+static int NameArgument(uint32_t function, GLNameKind &kind)
+{
+	switch (function)
+	{
+	case GL_FUNCTION_glBindBuffer: kind = GL_NAMES_BUFFER; return 1;
+	case GL_FUNCTION_glBindBufferBase: kind = GL_NAMES_BUFFER; return 2;
+	case GL_FUNCTION_glTexBuffer: kind = GL_NAMES_BUFFER; return 2;
+	case GL_FUNCTION_glBindTexture: kind = GL_NAMES_TEXTURE; return 1;
+	case GL_FUNCTION_glFramebufferTexture: kind = GL_NAMES_TEXTURE; return 2;
+	case GL_FUNCTION_glBindVertexArray: kind = GL_NAMES_VERTEX_ARRAY; return 0;
+	case GL_FUNCTION_glBindFramebuffer: kind = GL_NAMES_FRAMEBUFFER; return 1;
+	case GL_FUNCTION_glBindRenderbuffer: kind = GL_NAMES_RENDERBUFFER; return 1;
+	case GL_FUNCTION_glFramebufferRenderbuffer: kind = GL_NAMES_RENDERBUFFER; return 3;
+	case GL_FUNCTION_glUseProgram:
+	case GL_FUNCTION_glAttachShader:
+	case GL_FUNCTION_glLinkProgram:
+	case GL_FUNCTION_glProgramParameteri:
+	case GL_FUNCTION_glProgramBinary:
+	case GL_FUNCTION_glUniformBlockBinding:
+	case GL_FUNCTION_glDeleteProgram:
+	case GL_FUNCTION_glShaderSource:
+	case GL_FUNCTION_glCompileShader:
+	case GL_FUNCTION_glDeleteShader:
+		kind = GL_NAMES_PROGRAM;
+		return 0;
+	default:
+		return -1;
+	}
+}
+
+//argument the recorded data is passed in
+static int DataArgument(uint32_t function)
+{
+	switch (function)
+	{
+	case GL_FUNCTION_glBufferData: return 2;
+	case GL_FUNCTION_glBufferSubData: return 3;
+	case GL_FUNCTION_glTexImage2D: return 8;
+	case GL_FUNCTION_glTexImage3D: return 9;
+	case GL_FUNCTION_glTexSubImage3D: return 10;
+	case GL_FUNCTION_glCompressedTexImage2D: return 7;
+	case GL_FUNCTION_glUniformMatrix4fv: return 3;
+	case GL_FUNCTION_glTexParameterfv:
+	case GL_FUNCTION_glUniform1iv:
+	case GL_FUNCTION_glUniform2fv:
+	case GL_FUNCTION_glUniform3fv:
+	case GL_FUNCTION_glUniform4fv:
+	case GL_FUNCTION_glProgramBinary:
+		return 2;
+	default:
+		return -1;
+	}
+}
+
+//read backs, queries and timers only observe, the replay times frames itself
+static bool Replayed(uint32_t function)
+{
+	switch (function)
+	{
+	case GL_FUNCTION_glBeginQuery:
+	case GL_FUNCTION_glEndQuery:
+	case GL_FUNCTION_glQueryCounter:
+	case GL_FUNCTION_glGenQueries:
+	case GL_FUNCTION_glDeleteQueries:
+	case GL_FUNCTION_glCheckFramebufferStatus:
+	case GL_FUNCTION_glGetActiveUniform:
+	case GL_FUNCTION_glGetActiveUniformBlockName:
+	case GL_FUNCTION_glGetInteger64v:
+	case GL_FUNCTION_glGetIntegerv:
+	case GL_FUNCTION_glGetProgramBinary:
+	case GL_FUNCTION_glGetProgramInfoLog:
+	case GL_FUNCTION_glGetProgramiv:
+	case GL_FUNCTION_glGetQueryObjectiv:
+	case GL_FUNCTION_glGetQueryObjectui64v:
+	case GL_FUNCTION_glGetShaderInfoLog:
+	case GL_FUNCTION_glGetShaderiv:
+	case GL_FUNCTION_glGetString:
+	case GL_FUNCTION_glGetUniformLocation:
+		return false;
+	default:
+		return true;
+	}
+}
+
+static void ReplayGLCall(const GLCallLog &log, const GLCall &call, GLReplay &replay)
+{
+	if (!Replayed(call.function)) { return; }
+
+	uint64_t args[GL_CALL_MAX_ARGS];
+	memcpy(args, call.args, sizeof(args));
+	const unsigned char *data = call.dataOffset == GL_CALL_NO_DATA ? nullptr : log.data.data() + call.dataOffset;
+	GLNameKind kind = ObjectNameKind(call.function);
+
+	switch (call.function)
+	{
+	case GL_FUNCTION_glGenBuffers:
+	case GL_FUNCTION_glGenFramebuffers:
+	case GL_FUNCTION_glGenRenderbuffers:
+	case GL_FUNCTION_glGenTextures:
+	case GL_FUNCTION_glGenVertexArrays:
+	{
+		std::vector<GLuint> generated((size_t)args[0]);
+		args[1] = PackGLArgument(generated.data());
+		GL_INVOKERS[call.function](args);
+		for (size_t i = 0; i < generated.size(); i++) { replay.names[kind][((const GLuint *)data)[i]] = generated[i]; }
+		return;
+	}
+	case GL_FUNCTION_glCreateProgram:
+	case GL_FUNCTION_glCreateShader:
+		replay.names[kind][call.result] = GL_INVOKERS[call.function](args);
+		return;
+	case GL_FUNCTION_glDeleteBuffers:
+	case GL_FUNCTION_glDeleteFramebuffers:
+	case GL_FUNCTION_glDeleteRenderbuffers:
+	{
+		std::vector<GLuint> deleted((size_t)args[0]);
+		for (size_t i = 0; i < deleted.size(); i++) { deleted[i] = (GLuint)replay.Name(kind, ((const GLuint *)data)[i]); }
+		args[1] = PackGLArgument(deleted.data());
+		GL_INVOKERS[call.function](args);
+		return;
+	}
+	case GL_FUNCTION_glShaderSource:
+	{
+		const GLchar *source = (const GLchar *)data;
+		GLint length = (GLint)call.dataSize;
+		args[0] = replay.Name(GL_NAMES_PROGRAM, args[0]);
+		args[1] = 1;
+		args[2] = PackGLArgument(&source);
+		args[3] = PackGLArgument(&length);
+		GL_INVOKERS[call.function](args);
+		return;
+	}
+	case GL_FUNCTION_glMapBufferRange:
+		replay.mapped = (void *)(uintptr_t)GL_INVOKERS[call.function](args);
+		return;
+	case GL_FUNCTION_glUnmapBuffer:
+		if (replay.mapped && data) { memcpy(replay.mapped, data, call.dataSize); }
+		replay.mapped = nullptr;
+		GL_INVOKERS[call.function](args);
+		return;
+	}
+
+	GLNameKind nameKind = GL_NAMES_NONE;
+	int nameArgument = NameArgument(call.function, nameKind);
+	if (nameArgument >= 0) { args[nameArgument] = replay.Name(nameKind, args[nameArgument]); }
+	if (call.function == GL_FUNCTION_glAttachShader) { args[1] = replay.Name(GL_NAMES_PROGRAM, args[1]); }
+
+	int dataArgument = DataArgument(call.function);
+	if (dataArgument >= 0 && data) { args[dataArgument] = PackGLArgument(data); }
+	GL_INVOKERS[call.function](args);
+}
+
+bool ReplayGLCallLog(const std::string &path, const std::string &outputPath)
+{
+	GLCallLog log;
+	if (!ReadGLCallLog(path, log)) { return false; }
+
+	unsigned int framebuffer = 0;
+	if (!CreateHeadlessContext(log.width, log.height, framebuffer)) { return false; }
+	InstallCallCounters();
+
+	GLReplay replay;
+	replay.names[GL_NAMES_FRAMEBUFFER][log.defaultFramebuffer] = framebuffer;
+
+	//calls between frames (setup, texture uploads of loaders, cleanup) are issued untimed
+	FrameRecorder recorder;
+	recorder.Init();
+	size_t next = 0;
+	for (size_t frame = 0; frame < log.frames.size(); frame++)
+	{
+		for (; next < log.frames[frame].begin; next++) { ReplayGLCall(log, log.calls[next], replay); }
+		recorder.BeginFrame((unsigned int)frame);
+		for (; next < log.frames[frame].end; next++) { ReplayGLCall(log, log.calls[next], replay); }
+		recorder.EndFrame();
+	}
+	for (; next < log.calls.size(); next++) { ReplayGLCall(log, log.calls[next], replay); }
+	recorder.Finish();
+
+	std::cout << "replayed " << log.calls.size() << " GL calls in " << log.frames.size() << " frames" << std::endl;
+	bool written = recorder.WriteResults(outputPath);
+	DestroyHeadlessContext();
+	return written;
+}
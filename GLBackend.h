@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//arguments of the GL call with the most of them, glTexSubImage3D
+const unsigned int GL_CALL_MAX_ARGS = 11;
+//dataOffset of a call without data copied into the log
+const uint64_t GL_CALL_NO_DATA = ~0ull;
+
+//one recorded call, arguments are stored as integers (floats bitwise, pointers as addresses)
+//data behind a pointer argument is copied into the log, so the call can be issued again
+struct GLCall
+{
+	uint32_t function;
+	uint32_t dataSize;
+	uint64_t dataOffset;
+	uint64_t args[GL_CALL_MAX_ARGS];
+	uint64_t result;
+};
+
+//calls of a benchmark frame, from FrameRecorder::BeginFrame to EndFrame
+struct GLFrameRange
+{
+	uint64_t begin, end;
+};
+
+struct GLCallLog
+{
+	//frame buffer the recording drew into in place of the default one, and its size
+	uint32_t defaultFramebuffer = 0;
+	uint32_t width = 0, height = 0;
+	std::vector<GLCall> calls;
+	std::vector<unsigned char> data;
+	std::vector<GLFrameRange> frames;
+};
+
+//backends are installed by swapping the function pointers glad exposes, for the GL functions the demo calls
+//a GL function the demo starts to call has to be added to GL_FUNCTIONS in GLBackend.cpp too
+
+//accept every call without doing anything and without a context, generated names count up from 1,
+//compile and link status is success, queries and counters read 0
+void InstallNullGLBackend();
+//log every call from here on and forward it to the backend installed before, driver or null
+void StartGLRecording(unsigned int defaultFramebuffer, unsigned int width, unsigned int height);
+//calls from here on are forwarded without logging, the log stays until the next StartGLRecording
+void StopGLRecording();
+//frame boundaries of the recording, ignored while not recording
+void MarkGLFrameBegin();
+void MarkGLFrameEnd();
+const GLCallLog &RecordedGLCalls();
+
+bool WriteGLCallLog(const GLCallLog &log, const std::string &path);
+bool ReadGLCallLog(const std::string &path, GLCallLog &log);
+//calls of every function in every recorded frame, a row per frame and a column per function called at all,
+//calls outside frames not counted
+bool WriteGLCallCounts(const GLCallLog &log, const std::string &path);
+
+//issue a recorded log on a headless context of the recorded size, every frame timed by FrameRecorder
+//and written to <outputPath>.csv and .json; object names are mapped to the ones the driver hands out now,
+//uniform locations are used as recorded and calls which only read back or time are skipped
+bool ReplayGLCallLog(const std::string &path, const std::string &outputPath);
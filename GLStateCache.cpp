@@ -0,0 +1,76 @@
+#include "GLStateCache.h"
+
+GLStateCache glState;
+
+int GLStateCache::TargetSlot(GLenum target)
+{
+	switch (target)
+	{
+	case GL_TEXTURE_2D: return 0;
+	case GL_TEXTURE_2D_ARRAY: return 1;
+	case GL_TEXTURE_CUBE_MAP: return 2;
+	case GL_TEXTURE_BUFFER: return 3;
+	default: return -1;
+	}
+}
+
+bool GLStateCache::Changed(bool changed)
+{
+	if (changed) { issuedCalls++; }
+	else { droppedCalls++; }
+	return changed;
+}
+
+void GLStateCache::UseProgram(unsigned int id)
+{
+	if (!Changed(program != id)) { return; }
+	glUseProgram(id);
+	program = id;
+}
+
+void GLStateCache::BindTexture(unsigned int unit, GLenum target, unsigned int texture)
+{
+	int slot = TargetSlot(target);
+	if (unit >= STATE_CACHE_TEXTURE_UNITS || slot < 0)
+	{
+		//not shadowed, only the unit selection is still known
+		issuedCalls++;
+		if (activeUnit != unit) { glActiveTexture(GL_TEXTURE0 + unit); }
+		activeUnit = unit;
+		glBindTexture(target, texture);
+		return;
+	}
+
+	if (!Changed(textures[unit][slot] != texture)) { return; }
+	if (activeUnit != unit)
+	{
+		glActiveTexture(GL_TEXTURE0 + unit);
+		activeUnit = unit;
+	}
+	glBindTexture(target, texture);
+	textures[unit][slot] = texture;
+}
+
+void GLStateCache::BindVertexArray(unsigned int id)
+{
+	if (!Changed(vao != id)) { return; }
+	glBindVertexArray(id);
+	vao = id;
+}
+
+void GLStateCache::Invalidate()
+{
+	program = ~0u;
+	vao = ~0u;
+	activeUnit = ~0u;
+	for (unsigned int unit = 0; unit < STATE_CACHE_TEXTURE_UNITS; unit++)
+	{
+		for (unsigned int slot = 0; slot < STATE_CACHE_TEXTURE_TARGETS; slot++) { textures[unit][slot] = ~0u; }
+	}
+}
+
+void GLStateCache::ResetCounters()
+{
+	issuedCalls = 0;
+	droppedCalls = 0;
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <glad/glad.h>
+
+//texture units and targets whose bindings are shadowed, binds outside them go straight to GL
+const unsigned int STATE_CACHE_TEXTURE_UNITS = 16;
+const unsigned int STATE_CACHE_TEXTURE_TARGETS = 4;
+
+//shadow copy of the bindings the renderer switches most, calls which would not change GL state are dropped
+//every program, texture and vertex array bind of the renderer must go through it or the copy goes stale,
+//code binding behind its back calls Invalidate afterwards
+class GLStateCache
+{
+public:
+	GLStateCache() { Invalidate(); }
+
+	void UseProgram(unsigned int program);
+	//selects unit first when it is not the active one
+	void BindTexture(unsigned int unit, GLenum target, unsigned int texture);
+	void BindVertexArray(unsigned int vao);
+
+	//forget every binding, the next call of each kind reaches GL again
+	void Invalidate();
+	void ResetCounters();
+
+	//calls forwarded to GL and calls dropped as redundant since ResetCounters
+	unsigned int issuedCalls = 0;
+	unsigned int droppedCalls = 0;
+
+private:
+	//slot of the target in the per unit binding table, -1 when it is not shadowed
+	static int TargetSlot(GLenum target);
+	bool Changed(bool changed);
+
+	//~0u marks a binding which is not known
+	unsigned int program;
+	unsigned int vao;
+	unsigned int activeUnit;
+	unsigned int textures[STATE_CACHE_TEXTURE_UNITS][STATE_CACHE_TEXTURE_TARGETS];
+};
+
+extern GLStateCache glState;
@@ -0,0 +1,82 @@
+#include "InstanceBuffer.h"
+#include "GLStateCache.h"
+
+#include <glad/glad.h>
+#include <algorithm>
+#include <cfloat>
+#include <cstddef>
+#include <cstring>
+
+void InstanceSet::Create(const glm::vec3 &meshMin, const glm::vec3 &meshMax)
+{
+	this->meshMin = meshMin;
+	this->meshMax = meshMax;
+	boundsMin = boundsMax = glm::vec3(0.0f);
+}
+
+bool InstanceSet::Assign(const InstanceData *instances, unsigned int count)
+{
+	if (count == Count() && version > 0 && !memcmp(this->instances.data(), instances, count * sizeof(InstanceData))) { return false; }
+
+	this->instances.assign(instances, instances + count);
+	version++;
+
+	//sphere of the mesh box, radius grows with the largest axis scale of each instance
+	glm::vec3 meshCenter = (meshMin + meshMax) * 0.5f;
+	float meshRadius = glm::length(meshMax - meshMin) * 0.5f;
+	spheres.Clear();
+	boundsMin = glm::vec3(FLT_MAX);
+	boundsMax = glm::vec3(-FLT_MAX);
+	for (unsigned int i = 0; i < count; i++)
+	{
+		const glm::mat4 &model = instances[i].model;
+		float scale = std::max(glm::length(glm::vec3(model[0])), std::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+		glm::vec3 center = glm::vec3(model * glm::vec4(meshCenter, 1.0f));
+		spheres.Add(center, meshRadius * scale);
+
+		//box of the mesh box corners moved by the instance transform
+		for (int c = 0; c < 8; c++)
+		{
+			glm::vec4 corner((c & 1) ? meshMax.x : meshMin.x, (c & 2) ? meshMax.y : meshMin.y, (c & 4) ? meshMax.z : meshMin.z, 1.0f);
+			glm::vec3 world = glm::vec3(model * corner);
+			boundsMin = glm::min(boundsMin, world);
+			boundsMax = glm::max(boundsMax, world);
+		}
+	}
+	if (count == 0) { boundsMin = boundsMax = glm::vec3(0.0f); }
+	return true;
+}
+
+void InstanceBuffer::Create()
+{
+	glGenBuffers(1, &id);
+}
+
+void InstanceBuffer::Update(const InstanceData *instances, unsigned int count)
+{
+	this->count = count;
+	if (count == 0) { return; }
+
+	//grow with headroom so adding a few instances does not reallocate every frame
+	if (count > capacity) { capacity = std::max(count, capacity * 2); }
+	glBindBuffer(GL_ARRAY_BUFFER, id);
+	glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(InstanceData), NULL, GL_STREAM_DRAW);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, count * sizeof(InstanceData), instances);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void InstanceBuffer::Attach(unsigned int vao) const
+{
+	glState.BindVertexArray(vao);
+	glBindBuffer(GL_ARRAY_BUFFER, id);
+	for (unsigned int column = 0; column < 4; column++)
+	{
+		glVertexAttribPointer(INSTANCE_MODEL_LOCATION + column, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void*)(offsetof(InstanceData, model) + column * sizeof(glm::vec4)));
+		glEnableVertexAttribArray(INSTANCE_MODEL_LOCATION + column);
+		glVertexAttribDivisor(INSTANCE_MODEL_LOCATION + column, 1);
+	}
+	glVertexAttribPointer(INSTANCE_TINT_LOCATION, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void*)offsetof(InstanceData, tint));
+	glEnableVertexAttribArray(INSTANCE_TINT_LOCATION);
+	glVertexAttribDivisor(INSTANCE_TINT_LOCATION, 1);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "FrustumCuller.h"
+
+//vertex attribute locations of per-instance data, mat4 takes four consecutive locations
+const unsigned int INSTANCE_MODEL_LOCATION = 3;
+const unsigned int INSTANCE_TINT_LOCATION = 7;
+
+//per-instance vertex data, must match aModel/aTint in the instanced shaders
+struct InstanceData
+{
+	glm::mat4 model;
+	glm::vec4 tint;
+};
+
+//every instance of a mesh with the world space bounds used for culling and shadow caching
+class InstanceSet
+{
+public:
+	//bounding box of the mesh in model space, instance bounds are derived from it
+	void Create(const glm::vec3 &meshMin, const glm::vec3 &meshMax);
+	//returns false when instances equal the current ones and nothing changed
+	bool Assign(const InstanceData *instances, unsigned int count);
+	bool Assign(const std::vector<InstanceData> &instances) { return Assign(instances.data(), (unsigned int)instances.size()); }
+	unsigned int Count() const { return (unsigned int)instances.size(); }
+
+	std::vector<InstanceData> instances;
+	//sphere around every instance, same order as instances
+	BoundingSpheres spheres;
+	//increased on every change, tells caches that transforms changed
+	unsigned int version = 0;
+	//world space box around every instance
+	glm::vec3 boundsMin;
+	glm::vec3 boundsMax;
+
+private:
+	glm::vec3 meshMin;
+	glm::vec3 meshMax;
+};
+
+//vertex buffer with the instances of one view, attached to the mesh's vertex array
+//so every visible copy goes out in a single glDrawArraysInstanced call
+class InstanceBuffer
+{
+public:
+	void Create();
+	//every upload orphans the buffer, so views can refill it between draws of one frame without waiting
+	void Update(const InstanceData *instances, unsigned int count);
+	//add per-instance attributes to vertex array, its own attributes are left as they are
+	void Attach(unsigned int vao) const;
+
+	unsigned int id = 0;
+	unsigned int count = 0;
+
+private:
+	unsigned int capacity = 0;
+};
@@ -0,0 +1,284 @@
+#include "LightClusters.h"
+#include "GLStateCache.h"
+#include "Random.h"
+
+#include <glad/glad.h>
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+
+void LightClusterer::Start(unsigned int threadCount)
+{
+	sliceIndices.resize(CLUSTER_SLICES);
+	sliceCandidates.resize(CLUSTER_SLICES);
+	workers.Start(threadCount);
+}
+
+void LightClusterer::Stop()
+{
+	workers.Stop();
+}
+
+void LightClusterer::SetProjection(float fovY, float aspect, float nearPlane, float farPlane)
+{
+	//called every frame, bounds are only rebuilt when the projection changed
+	if (!bounds.empty() && tanHalfY == tanf(fovY * 0.5f) && tanHalfX == tanHalfY * aspect && this->nearPlane == nearPlane && this->farPlane == farPlane) { return; }
+
+	tanHalfY = tanf(fovY * 0.5f);
+	tanHalfX = tanHalfY * aspect;
+	this->nearPlane = nearPlane;
+	this->farPlane = farPlane;
+
+	//slices are exponential in depth so clusters stay roughly cube shaped
+	sliceDepths.resize(CLUSTER_SLICES + 1);
+	for (unsigned int s = 0; s <= CLUSTER_SLICES; s++) { sliceDepths[s] = nearPlane * powf(farPlane / nearPlane, (float)s / CLUSTER_SLICES); }
+
+	bounds.resize(CLUSTER_COUNT);
+	for (unsigned int s = 0; s < CLUSTER_SLICES; s++)
+	{
+		float depths[2] = { sliceDepths[s], sliceDepths[s + 1] };
+		for (unsigned int y = 0; y < CLUSTER_TILES_Y; y++)
+		{
+			for (unsigned int x = 0; x < CLUSTER_TILES_X; x++)
+			{
+				float ndcX[2] = { -1.0f + 2.0f * x / CLUSTER_TILES_X, -1.0f + 2.0f * (x + 1) / CLUSTER_TILES_X };
+				float ndcY[2] = { -1.0f + 2.0f * y / CLUSTER_TILES_Y, -1.0f + 2.0f * (y + 1) / CLUSTER_TILES_Y };
+
+				//box around the tile's corners on both slice planes
+				Bounds &box = bounds[(s * CLUSTER_TILES_Y + y) * CLUSTER_TILES_X + x];
+				box.min = glm::vec3(FLT_MAX);
+				box.max = glm::vec3(-FLT_MAX);
+				for (int c = 0; c < 8; c++)
+				{
+					float depth = depths[c >> 2];
+					glm::vec3 corner(ndcX[c & 1] * depth * tanHalfX, ndcY[(c >> 1) & 1] * depth * tanHalfY, -depth);
+					box.min = glm::min(box.min, corner);
+					box.max = glm::max(box.max, corner);
+				}
+			}
+		}
+	}
+}
+
+void LightClusterer::Build(const glm::mat4 &view, const PointLight *lights, unsigned int count)
+{
+	count = std::min(count, MAX_POINT_LIGHTS);
+	viewLights.resize(count);
+	for (unsigned int i = 0; i < count; i++)
+	{
+		viewLights[i] = glm::vec4(glm::vec3(view * glm::vec4(lights[i].position, 1.0f)), lights[i].radius);
+	}
+	clusters.resize(CLUSTER_COUNT);
+
+	//workers and the calling thread take slices until none is left
+	workers.Run(CLUSTER_SLICES, [this](unsigned int slice) { BinSlice(slice); });
+
+	//slice lists are concatenated in slice order, their ranges move by the size of the slices before them
+	lightIndices.clear();
+	maxLightsPerCluster = 0;
+	unsigned int clustersPerSlice = CLUSTER_TILES_X * CLUSTER_TILES_Y;
+	for (unsigned int s = 0; s < CLUSTER_SLICES; s++)
+	{
+		uint32_t base = (uint32_t)lightIndices.size();
+		for (unsigned int c = s * clustersPerSlice; c < (s + 1) * clustersPerSlice; c++)
+		{
+			clusters[c].offset += base;
+			maxLightsPerCluster = std::max(maxLightsPerCluster, clusters[c].count);
+		}
+		lightIndices.insert(lightIndices.end(), sliceIndices[s].begin(), sliceIndices[s].end());
+	}
+}
+
+unsigned int LightClusterer::ClusterOf(const glm::vec3 &viewPosition) const
+{
+	float depth = std::max(-viewPosition.z, nearPlane);
+	glm::vec2 scaleBias = SliceScaleBias();
+	int slice = (int)floorf(logf(depth) * scaleBias.x + scaleBias.y);
+	int x = (int)floorf((viewPosition.x / (depth * tanHalfX) * 0.5f + 0.5f) * CLUSTER_TILES_X);
+	int y = (int)floorf((viewPosition.y / (depth * tanHalfY) * 0.5f + 0.5f) * CLUSTER_TILES_Y);
+	slice = std::min(std::max(slice, 0), (int)CLUSTER_SLICES - 1);
+	x = std::min(std::max(x, 0), (int)CLUSTER_TILES_X - 1);
+	y = std::min(std::max(y, 0), (int)CLUSTER_TILES_Y - 1);
+	return (slice * CLUSTER_TILES_Y + y) * CLUSTER_TILES_X + x;
+}
+
+glm::vec2 LightClusterer::SliceScaleBias() const
+{
+	float range = logf(farPlane / nearPlane);
+	return glm::vec2((float)CLUSTER_SLICES / range, -(float)CLUSTER_SLICES * logf(nearPlane) / range);
+}
+
+//tile range covered by [low, high] of a view space axis over depths [nearDepth, farDepth]
+static void TileRange(float low, float high, float nearDepth, float farDepth, float tanHalf, unsigned int tiles, unsigned int &first, unsigned int &last)
+{
+	//a negative coordinate projects furthest out at the nearest depth, a positive one at the farthest
+	float ndcLow = low / ((low < 0.0f ? nearDepth : farDepth) * tanHalf);
+	float ndcHigh = high / ((high > 0.0f ? nearDepth : farDepth) * tanHalf);
+	int tileLow = (int)floorf((ndcLow * 0.5f + 0.5f) * tiles);
+	int tileHigh = (int)floorf((ndcHigh * 0.5f + 0.5f) * tiles);
+	first = (unsigned int)std::min(std::max(tileLow, 0), (int)tiles - 1);
+	last = (unsigned int)std::min(std::max(tileHigh, 0), (int)tiles - 1);
+}
+
+void LightClusterer::BinSlice(unsigned int slice)
+{
+	float sliceNear = sliceDepths[slice], sliceFar = sliceDepths[slice + 1];
+
+	//lights reaching the slice, with the tiles their sphere can cover inside it
+	std::vector<Candidate> &candidates = sliceCandidates[slice];
+	candidates.clear();
+	for (unsigned int i = 0; i < (unsigned int)viewLights.size(); i++)
+	{
+		const glm::vec4 &light = viewLights[i];
+		float depth = -light.z, radius = light.w;
+		if (depth + radius < sliceNear || depth - radius > sliceFar) { continue; }
+
+		float nearDepth = std::max(sliceNear, depth - radius), farDepth = std::min(sliceFar, depth + radius);
+		//fully outside the side planes
+		if (light.x - radius > farDepth * tanHalfX || light.x + radius < -farDepth * tanHalfX) { continue; }
+		if (light.y - radius > farDepth * tanHalfY || light.y + radius < -farDepth * tanHalfY) { continue; }
+
+		Candidate candidate;
+		candidate.light = i;
+		TileRange(light.x - radius, light.x + radius, nearDepth, farDepth, tanHalfX, CLUSTER_TILES_X, candidate.x0, candidate.x1);
+		TileRange(light.y - radius, light.y + radius, nearDepth, farDepth, tanHalfY, CLUSTER_TILES_Y, candidate.y0, candidate.y1);
+		candidates.push_back(candidate);
+	}
+
+	//cluster lists in tile order, light indices ascending inside each
+	std::vector<uint16_t> &indices = sliceIndices[slice];
+	indices.clear();
+	for (unsigned int y = 0; y < CLUSTER_TILES_Y; y++)
+	{
+		for (unsigned int x = 0; x < CLUSTER_TILES_X; x++)
+		{
+			unsigned int cluster = (slice * CLUSTER_TILES_Y + y) * CLUSTER_TILES_X + x;
+			const Bounds &box = bounds[cluster];
+			uint32_t offset = (uint32_t)indices.size();
+			for (const Candidate &candidate : candidates)
+			{
+				if (x < candidate.x0 || x > candidate.x1 || y < candidate.y0 || y > candidate.y1) { continue; }
+
+				//sphere against the cluster box
+				const glm::vec4 &light = viewLights[candidate.light];
+				glm::vec3 center(light);
+				glm::vec3 closest = glm::clamp(center, box.min, box.max);
+				glm::vec3 offsetToBox = closest - center;
+				if (glm::dot(offsetToBox, offsetToBox) <= light.w * light.w) { indices.push_back((uint16_t)candidate.light); }
+			}
+			clusters[cluster].offset = offset;
+			clusters[cluster].count = (uint32_t)indices.size() - offset;
+		}
+	}
+}
+
+void ClusterBuffers::Create()
+{
+	//lights as two RGBA32F texels each, cluster ranges as RG32UI and light indices as R16UI
+	const GLenum formats[3] = { GL_RGBA32F, GL_RG32UI, GL_R16UI };
+	glGenBuffers(3, buffers);
+	glGenTextures(3, textures);
+	for (int i = 0; i < 3; i++)
+	{
+		glBindBuffer(GL_TEXTURE_BUFFER, buffers[i]);
+		glBufferData(GL_TEXTURE_BUFFER, 16, NULL, GL_STREAM_DRAW);
+		capacities[i] = 16;
+		glState.BindTexture(0, GL_TEXTURE_BUFFER, textures[i]);
+		glTexBuffer(GL_TEXTURE_BUFFER, formats[i], buffers[i]);
+	}
+	glState.BindTexture(0, GL_TEXTURE_BUFFER, 0);
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+void ClusterBuffers::Update(const std::vector<ClusterRange> &clusters, const std::vector<uint16_t> &lightIndices, const PointLight *lights, unsigned int count)
+{
+	const void *data[3] = { lights, clusters.data(), lightIndices.data() };
+	size_t sizes[3] = { count * sizeof(PointLight), clusters.size() * sizeof(ClusterRange), lightIndices.size() * sizeof(uint16_t) };
+	for (int i = 0; i < 3; i++)
+	{
+		glBindBuffer(GL_TEXTURE_BUFFER, buffers[i]);
+		//orphaned every frame like the instance buffers, grown with headroom
+		if (sizes[i] > capacities[i]) { capacities[i] = std::max(sizes[i], capacities[i] * 2); }
+		glBufferData(GL_TEXTURE_BUFFER, capacities[i], NULL, GL_STREAM_DRAW);
+		if (sizes[i] > 0) { glBufferSubData(GL_TEXTURE_BUFFER, 0, sizes[i], data[i]); }
+	}
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+void ClusterBuffers::Bind(unsigned int firstUnit) const
+{
+	for (unsigned int i = 0; i < 3; i++) { glState.BindTexture(firstUnit + i, GL_TEXTURE_BUFFER, textures[i]); }
+}
+
+bool RunClusterBenchmark(unsigned int count)
+{
+	count = std::max(1u, std::min(count, MAX_POINT_LIGHTS));
+	const unsigned int ITERATIONS = 100;
+
+	//lights spread through the view of a camera at the origin looking down -Z
+	Random random(1234);
+	std::vector<PointLight> lights(count);
+	for (PointLight &light : lights)
+	{
+		light.position = glm::vec3(random.Unit() * 60.0f - 30.0f, random.Unit() * 20.0f - 10.0f, -random.Unit() * 60.0f);
+		light.radius = 1.0f + random.Unit() * 3.0f;
+		light.color = glm::vec3(1.0f);
+		light.padding = 0.0f;
+	}
+
+	const float FOV = 1.0471976f, ASPECT = 16.0f / 9.0f, NEAR_PLANE = 0.1f, FAR_PLANE = 100.0f;
+	unsigned int threadCount = std::max(1u, std::thread::hardware_concurrency());
+	LightClusterer single, parallel;
+	single.Start(1);
+	parallel.Start(threadCount);
+	single.SetProjection(FOV, ASPECT, NEAR_PLANE, FAR_PLANE);
+	parallel.SetProjection(FOV, ASPECT, NEAR_PLANE, FAR_PLANE);
+
+	auto time = [&lights, count, ITERATIONS](LightClusterer &clusterer)
+	{
+		clusterer.Build(glm::mat4(), lights.data(), count);
+		auto start = std::chrono::high_resolution_clock::now();
+		for (unsigned int iteration = 0; iteration < ITERATIONS; iteration++) { clusterer.Build(glm::mat4(), lights.data(), count); }
+		return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count() / ITERATIONS;
+	};
+	double singleMs = time(single);
+	double parallelMs = time(parallel);
+
+	bool identical = single.lightIndices == parallel.lightIndices;
+	for (unsigned int c = 0; c < CLUSTER_COUNT && identical; c++)
+	{
+		identical = single.clusters[c].offset == parallel.clusters[c].offset && single.clusters[c].count == parallel.clusters[c].count;
+	}
+
+	//points inside every light must find it in their cluster, as the shader would look it up
+	unsigned int samples = 0, missed = 0;
+	float tanHalfY = tanf(FOV * 0.5f), tanHalfX = tanHalfY * ASPECT;
+	for (unsigned int i = 0; i < count; i++)
+	{
+		for (int s = 0; s < 16; s++)
+		{
+			glm::vec3 direction(random.Unit() - 0.5f, random.Unit() - 0.5f, random.Unit() - 0.5f);
+			if (glm::dot(direction, direction) < 1e-6f) { continue; }
+			glm::vec3 point = lights[i].position + glm::normalize(direction) * lights[i].radius * random.Unit();
+			float depth = -point.z;
+			if (depth < NEAR_PLANE || depth > FAR_PLANE || fabsf(point.x) > depth * tanHalfX || fabsf(point.y) > depth * tanHalfY) { continue; }
+
+			samples++;
+			const ClusterRange &range = parallel.clusters[parallel.ClusterOf(point)];
+			const uint16_t *first = parallel.lightIndices.data() + range.offset;
+			if (std::find(first, first + range.count, (uint16_t)i) == first + range.count) { missed++; }
+		}
+	}
+
+	unsigned int litClusters = 0;
+	for (const ClusterRange &range : parallel.clusters) { litClusters += range.count > 0 ? 1 : 0; }
+
+	std::cout << "light clustering of " << count << " lights into " << CLUSTER_TILES_X << "x" << CLUSTER_TILES_Y << "x" << CLUSTER_SLICES << " clusters, " << ITERATIONS << " iterations" << std::endl;
+	std::cout << "  1 thread     " << singleMs << " ms" << std::endl;
+	std::cout << "  " << threadCount << " threads    " << parallelMs << " ms" << std::endl;
+	std::cout << "  light indices " << parallel.lightIndices.size() << ", lit clusters " << litClusters << ", max per cluster " << parallel.maxLightsPerCluster << std::endl;
+	std::cout << "  threaded result " << (identical ? "matches" : "DIFFERS FROM") << " single thread, " << missed << " of " << samples << " sample points missed their light" << std::endl;
+	return identical && missed == 0;
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "WorkerPool.h"
+
+//cluster grid over the view frustum: screen tiles times exponential depth slices
+//the object shader is built with the same values through the CLUSTER_* defines
+const unsigned int CLUSTER_TILES_X = 16;
+const unsigned int CLUSTER_TILES_Y = 9;
+const unsigned int CLUSTER_SLICES = 24;
+const unsigned int CLUSTER_COUNT = CLUSTER_TILES_X * CLUSTER_TILES_Y * CLUSTER_SLICES;
+//light indices are stored as 16 bit
+const unsigned int MAX_POINT_LIGHTS = 0xFFFF;
+
+//unshadowed light whose contribution fades to zero at radius
+struct PointLight
+{
+	glm::vec3 position;
+	float radius;
+	glm::vec3 color;
+	float padding;
+};
+
+//range of a cluster in the light index list
+struct ClusterRange
+{
+	uint32_t offset;
+	uint32_t count;
+};
+
+//assigns point lights to the clusters their sphere touches, slices are binned in parallel
+//pure CPU, the GL side lives in ClusterBuffers
+class LightClusterer
+{
+public:
+	//threadCount includes the thread calling Build, 1 bins everything on the caller
+	void Start(unsigned int threadCount);
+	void Stop();
+
+	//view space bounds of every cluster, call whenever the projection changes
+	void SetProjection(float fovY, float aspect, float nearPlane, float farPlane);
+	void Build(const glm::mat4 &view, const PointLight *lights, unsigned int count);
+
+	//cluster containing a view space point, the same mapping the shader uses
+	unsigned int ClusterOf(const glm::vec3 &viewPosition) const;
+	//scale and bias turning log(view depth) into a slice index
+	glm::vec2 SliceScaleBias() const;
+
+	//indexed by (slice * CLUSTER_TILES_Y + y) * CLUSTER_TILES_X + x
+	std::vector<ClusterRange> clusters;
+	std::vector<uint16_t> lightIndices;
+	unsigned int maxLightsPerCluster = 0;
+
+private:
+	struct Bounds
+	{
+		glm::vec3 min, max;
+	};
+	//lights overlapping a slice and the tile rectangle they cover there
+	struct Candidate
+	{
+		unsigned int light;
+		unsigned int x0, y0, x1, y1;
+	};
+
+	void BinSlice(unsigned int slice);
+
+	float tanHalfX = 1.0f, tanHalfY = 1.0f;
+	float nearPlane = 0.1f, farPlane = 100.0f;
+	std::vector<float> sliceDepths;
+	std::vector<Bounds> bounds;
+
+	//view space center and radius of the lights being binned
+	std::vector<glm::vec4> viewLights;
+	//per slice output, concatenated once every slice is done
+	std::vector<std::vector<uint16_t>> sliceIndices;
+	std::vector<std::vector<Candidate>> sliceCandidates;
+
+	WorkerPool workers;
+};
+
+//texture buffers read by the clustered object shader: lights, cluster ranges and light indices
+class ClusterBuffers
+{
+public:
+	void Create();
+	//takes copies of the clusterer output, so the next frame can be binned while this one is uploaded
+	void Update(const std::vector<ClusterRange> &clusters, const std::vector<uint16_t> &lightIndices, const PointLight *lights, unsigned int count);
+	//bind the three buffers to consecutive texture units starting at firstUnit
+	void Bind(unsigned int firstUnit) const;
+
+private:
+	unsigned int buffers[3] = {};
+	unsigned int textures[3] = {};
+	size_t capacities[3] = {};
+};
+
+//time binning of count random lights on one thread and on every hardware thread,
+//check both agree and that no light misses a cluster it reaches, print the results and return whether both checks passed
+bool RunClusterBenchmark(unsigned int count);
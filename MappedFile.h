@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+//read only memory mapping of a whole file, unmapped when the object is destroyed
+class MappedFile
+{
+public:
+	MappedFile() {}
+	~MappedFile() { Close(); }
+	MappedFile(const MappedFile &) = delete;
+	MappedFile &operator=(const MappedFile &) = delete;
+
+	bool Open(const std::string &path);
+	void Close();
+
+	const unsigned char *Data() const { return data; }
+	size_t Size() const { return size; }
+
+private:
+	const unsigned char *data = nullptr;
+	size_t size = 0;
+#ifdef _WIN32
+	void *file = nullptr;
+	void *mapping = nullptr;
+#else
+	int file = -1;
+#endif
+};
+
+//create directory if missing, true when it exists afterwards
+bool MakeDirectory(const std::string &path);
+
+//64 bit FNV-1a, pass previous result as hash to continue over several buffers
+const uint64_t FNV_OFFSET_BASIS = 14695981039346656037ull;
+uint64_t HashBytes(const void *data, size_t size, uint64_t hash = FNV_OFFSET_BASIS);
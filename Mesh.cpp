@@ -0,0 +1,341 @@
+#include "Mesh.h"
+#include "GLStateCache.h"
+#include "MappedFile.h"
+
+#include <glad/glad.h>
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <unordered_map>
+
+MeshData BuildIndexedMesh(const float *vertices, unsigned int vertexCount, unsigned int attributes)
+{
+	unsigned int stride = 3 + ((attributes & MESH_NORMALS) ? 3 : 0) + ((attributes & MESH_TEXCOORDS) ? 2 : 0);
+
+	MeshData mesh;
+	mesh.attributes = attributes;
+	mesh.indices.reserve(vertexCount);
+
+	//vertices by hash of their floats, equal hashes are compared in full
+	std::unordered_map<uint64_t, std::vector<uint32_t>> unique;
+	std::vector<const float *> sources;
+	for (unsigned int i = 0; i < vertexCount; i++)
+	{
+		const float *vertex = vertices + i * stride;
+		std::vector<uint32_t> &candidates = unique[HashBytes(vertex, stride * sizeof(float))];
+
+		uint32_t index = (uint32_t)sources.size();
+		for (uint32_t candidate : candidates)
+		{
+			if (!memcmp(sources[candidate], vertex, stride * sizeof(float))) { index = candidate; break; }
+		}
+		if (index == sources.size())
+		{
+			candidates.push_back(index);
+			sources.push_back(vertex);
+
+			const float *attribute = vertex + 3;
+			mesh.positions.push_back(glm::vec3(vertex[0], vertex[1], vertex[2]));
+			if (attributes & MESH_NORMALS)
+			{
+				mesh.normals.push_back(glm::vec3(attribute[0], attribute[1], attribute[2]));
+				attribute += 3;
+			}
+			if (attributes & MESH_TEXCOORDS) { mesh.texCoords.push_back(glm::vec2(attribute[0], attribute[1])); }
+		}
+		mesh.indices.push_back(index);
+	}
+	return mesh;
+}
+
+//score of a vertex by its cache position and the number of triangles still using it
+static float VertexScore(int cachePosition, unsigned int remainingTriangles)
+{
+	if (remainingTriangles == 0) { return -1.0f; }
+
+	float score = 0.0f;
+	if (cachePosition >= 0)
+	{
+		//the last triangle's vertices get a fixed score so the next one does not simply repeat them
+		if (cachePosition < 3) { score = 0.75f; }
+		else { score = powf(1.0f - (float)(cachePosition - 3) / (float)(VERTEX_CACHE_SIZE - 3), 1.5f); }
+	}
+	//vertices with few triangles left are finished first so they do not linger
+	return score + 2.0f * powf((float)remainingTriangles, -0.5f);
+}
+
+static void OptimizeTriangleOrder(std::vector<uint32_t> &indices, unsigned int vertexCount)
+{
+	unsigned int triangleCount = (unsigned int)indices.size() / 3;
+	if (triangleCount == 0) { return; }
+
+	//triangles of every vertex, remaining ones are kept at the front of each range
+	std::vector<unsigned int> remaining(vertexCount, 0), offsets(vertexCount + 1, 0);
+	for (uint32_t index : indices) { remaining[index]++; }
+	for (unsigned int v = 0; v < vertexCount; v++) { offsets[v + 1] = offsets[v] + remaining[v]; }
+	std::vector<unsigned int> adjacency(indices.size()), fill(offsets.begin(), offsets.end() - 1);
+	for (unsigned int t = 0; t < triangleCount; t++)
+	{
+		for (int k = 0; k < 3; k++) { adjacency[fill[indices[t * 3 + k]]++] = t; }
+	}
+
+	std::vector<int> cachePosition(vertexCount, -1);
+	std::vector<float> vertexScore(vertexCount);
+	for (unsigned int v = 0; v < vertexCount; v++) { vertexScore[v] = VertexScore(-1, remaining[v]); }
+
+	std::vector<float> triangleScore(triangleCount);
+	std::vector<char> emitted(triangleCount, 0);
+	int best = 0;
+	for (unsigned int t = 0; t < triangleCount; t++)
+	{
+		triangleScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+		if (triangleScore[t] > triangleScore[best]) { best = t; }
+	}
+
+	std::vector<uint32_t> output;
+	output.reserve(indices.size());
+	std::vector<uint32_t> cache, nextCache;
+	unsigned int scanCursor = 0;
+	while (best >= 0)
+	{
+		const uint32_t *triangle = &indices[best * 3];
+		emitted[best] = 1;
+		output.insert(output.end(), triangle, triangle + 3);
+
+		for (int k = 0; k < 3; k++)
+		{
+			uint32_t v = triangle[k];
+			unsigned int *first = &adjacency[offsets[v]];
+			unsigned int *position = std::find(first, first + remaining[v], (unsigned int)best);
+			std::swap(*position, first[remaining[v] - 1]);
+			remaining[v]--;
+		}
+
+		//triangle's vertices move to the front of the cache, the oldest ones fall out
+		nextCache.assign(triangle, triangle + 3);
+		for (uint32_t v : cache)
+		{
+			if (v != triangle[0] && v != triangle[1] && v != triangle[2]) { nextCache.push_back(v); }
+		}
+		for (size_t i = 0; i < nextCache.size(); i++)
+		{
+			uint32_t v = nextCache[i];
+			cachePosition[v] = i < VERTEX_CACHE_SIZE ? (int)i : -1;
+			vertexScore[v] = VertexScore(cachePosition[v], remaining[v]);
+		}
+
+		//only triangles touching the cache changed score, the best of them goes next
+		best = -1;
+		float bestScore = -FLT_MAX;
+		for (uint32_t v : nextCache)
+		{
+			for (unsigned int i = 0; i < remaining[v]; i++)
+			{
+				unsigned int t = adjacency[offsets[v] + i];
+				triangleScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+				if (triangleScore[t] > bestScore) { best = t; bestScore = triangleScore[t]; }
+			}
+		}
+		if (nextCache.size() > VERTEX_CACHE_SIZE) { nextCache.resize(VERTEX_CACHE_SIZE); }
+		cache.swap(nextCache);
+
+		//cache holds nothing useful, continue with any triangle left
+		if (best < 0)
+		{
+			while (scanCursor < triangleCount && emitted[scanCursor]) { scanCursor++; }
+			if (scanCursor < triangleCount) { best = scanCursor; }
+		}
+	}
+	indices.swap(output);
+}
+
+void OptimizeMesh(MeshData &mesh)
+{
+	unsigned int vertexCount = (unsigned int)mesh.positions.size();
+	OptimizeTriangleOrder(mesh.indices, vertexCount);
+
+	//renumber vertices in order of first use
+	std::vector<uint32_t> remap(vertexCount, 0xFFFFFFFF);
+	uint32_t next = 0;
+	for (uint32_t &index : mesh.indices)
+	{
+		if (remap[index] == 0xFFFFFFFF) { remap[index] = next++; }
+		index = remap[index];
+	}
+
+	MeshData reordered;
+	reordered.attributes = mesh.attributes;
+	reordered.positions.resize(next);
+	if (!mesh.normals.empty()) { reordered.normals.resize(next); }
+	if (!mesh.texCoords.empty()) { reordered.texCoords.resize(next); }
+	for (unsigned int v = 0; v < vertexCount; v++)
+	{
+		//vertices no triangle uses are dropped
+		if (remap[v] == 0xFFFFFFFF) { continue; }
+		reordered.positions[remap[v]] = mesh.positions[v];
+		if (!mesh.normals.empty()) { reordered.normals[remap[v]] = mesh.normals[v]; }
+		if (!mesh.texCoords.empty()) { reordered.texCoords[remap[v]] = mesh.texCoords[v]; }
+	}
+	mesh.positions.swap(reordered.positions);
+	mesh.normals.swap(reordered.normals);
+	mesh.texCoords.swap(reordered.texCoords);
+}
+
+float AverageCacheMissRatio(const std::vector<uint32_t> &indices, unsigned int cacheSize)
+{
+	if (indices.size() < 3) { return 0.0f; }
+
+	std::vector<uint32_t> fifo;
+	unsigned int misses = 0;
+	for (uint32_t index : indices)
+	{
+		if (std::find(fifo.begin(), fifo.end(), index) != fifo.end()) { continue; }
+		misses++;
+		fifo.push_back(index);
+		if (fifo.size() > cacheSize) { fifo.erase(fifo.begin()); }
+	}
+	return (float)misses / (float)(indices.size() / 3);
+}
+
+//round to nearest half float, texture coordinates never need NaN
+static uint16_t FloatToHalf(float value)
+{
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	uint32_t sign = (bits >> 16) & 0x8000;
+	int exponent = (int)((bits >> 23) & 0xFF) - 127 + 15;
+	uint32_t mantissa = bits & 0x7FFFFF;
+
+	if (exponent >= 31) { return (uint16_t)(sign | 0x7C00); }
+	if (exponent <= 0)
+	{
+		//denormal half, or zero when too small
+		if (exponent < -10) { return (uint16_t)sign; }
+		mantissa |= 0x800000;
+		unsigned int shift = 14 - exponent;
+		uint32_t half = mantissa >> shift;
+		if ((mantissa >> (shift - 1)) & 1) { half++; }
+		return (uint16_t)(sign | half);
+	}
+	//rounding may carry into the exponent, which is still the correctly rounded value
+	uint32_t half = sign | ((uint32_t)exponent << 10) | (mantissa >> 13);
+	if (mantissa & 0x1000) { half++; }
+	return (uint16_t)half;
+}
+
+//signed normalized 10 bit components, w stays 0
+static uint32_t PackNormal(const glm::vec3 &normal)
+{
+	auto component = [](float value) { return (uint32_t)((int)roundf(std::min(std::max(value, -1.0f), 1.0f) * 511.0f) & 0x3FF); };
+	return component(normal.x) | component(normal.y) << 10 | component(normal.z) << 20;
+}
+
+void PackMesh(const MeshData &data, PackedMesh &mesh)
+{
+	MeshBuffers &buffers = mesh.buffers;
+	buffers.attributes = data.attributes;
+	buffers.vertexCount = (unsigned int)data.positions.size();
+	buffers.indexCount = (unsigned int)data.indices.size();
+	buffers.positions = data.positions.data();
+
+	buffers.boundsMin = glm::vec3(FLT_MAX);
+	buffers.boundsMax = glm::vec3(-FLT_MAX);
+	for (const glm::vec3 &position : data.positions)
+	{
+		buffers.boundsMin = glm::min(buffers.boundsMin, position);
+		buffers.boundsMax = glm::max(buffers.boundsMax, position);
+	}
+
+	mesh.packed.clear();
+	if (data.attributes != 0)
+	{
+		mesh.packed.resize(buffers.vertexCount);
+		for (unsigned int v = 0; v < buffers.vertexCount; v++)
+		{
+			mesh.packed[v].normal = data.normals.empty() ? 0 : PackNormal(data.normals[v]);
+			mesh.packed[v].texCoord[0] = data.texCoords.empty() ? 0 : FloatToHalf(data.texCoords[v].x);
+			mesh.packed[v].texCoord[1] = data.texCoords.empty() ? 0 : FloatToHalf(data.texCoords[v].y);
+		}
+	}
+	buffers.packed = mesh.packed.empty() ? nullptr : mesh.packed.data();
+
+	//16 bit indices halve index bandwidth for every mesh below 65536 vertices
+	buffers.indexType = buffers.vertexCount <= 0xFFFF ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+	mesh.indices.resize(buffers.indexCount * IndexSize(buffers.indexType));
+	if (buffers.indexType == GL_UNSIGNED_SHORT)
+	{
+		uint16_t *indices = (uint16_t *)mesh.indices.data();
+		for (unsigned int i = 0; i < buffers.indexCount; i++) { indices[i] = (uint16_t)data.indices[i]; }
+	}
+	else if (buffers.indexCount > 0)
+	{
+		memcpy(mesh.indices.data(), data.indices.data(), mesh.indices.size());
+	}
+	buffers.indices = mesh.indices.data();
+}
+
+unsigned int IndexSize(unsigned int indexType)
+{
+	return indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+}
+
+void Mesh::Create(const MeshData &data)
+{
+	PackedMesh packed;
+	PackMesh(data, packed);
+	Create(packed.buffers);
+}
+
+void Mesh::Create(const MeshBuffers &buffers)
+{
+	vertexCount = buffers.vertexCount;
+	indexCount = buffers.indexCount;
+	indexType = buffers.indexType;
+	boundsMin = buffers.boundsMin;
+	boundsMax = buffers.boundsMax;
+
+	glGenVertexArrays(1, &vao);
+	glGenVertexArrays(1, &shadowVao);
+
+	glGenBuffers(1, &positionBuffer);
+	glBindBuffer(GL_ARRAY_BUFFER, positionBuffer);
+	glBufferData(GL_ARRAY_BUFFER, vertexCount * sizeof(glm::vec3), buffers.positions, GL_STATIC_DRAW);
+
+	if (buffers.packed)
+	{
+		glGenBuffers(1, &attributeBuffer);
+		glBindBuffer(GL_ARRAY_BUFFER, attributeBuffer);
+		glBufferData(GL_ARRAY_BUFFER, vertexCount * sizeof(PackedAttributes), buffers.packed, GL_STATIC_DRAW);
+	}
+
+	glGenBuffers(1, &indexBuffer);
+	for (unsigned int pass = 0; pass < 2; pass++)
+	{
+		bool shadow = pass == 1;
+		glState.BindVertexArray(shadow ? shadowVao : vao);
+		//element buffer binding is part of the vertex array, the data is uploaded once
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+		if (!shadow) { glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCount * IndexSize(indexType), buffers.indices, GL_STATIC_DRAW); }
+
+		glBindBuffer(GL_ARRAY_BUFFER, positionBuffer);
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)0);
+		glEnableVertexAttribArray(0);
+
+		if (shadow || attributeBuffer == 0) { continue; }
+		glBindBuffer(GL_ARRAY_BUFFER, attributeBuffer);
+		if (buffers.attributes & MESH_NORMALS)
+		{
+			glVertexAttribPointer(1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, sizeof(PackedAttributes), (void*)offsetof(PackedAttributes, normal));
+			glEnableVertexAttribArray(1);
+		}
+		if (buffers.attributes & MESH_TEXCOORDS)
+		{
+			glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(PackedAttributes), (void*)offsetof(PackedAttributes, texCoord));
+			glEnableVertexAttribArray(2);
+		}
+	}
+	glState.BindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+//attributes of source vertices besides position, interleaved in this order after it
+const unsigned int MESH_NORMALS = 1;
+const unsigned int MESH_TEXCOORDS = 2;
+
+//post-transform cache size the triangle order is optimized for, common GPUs keep 16 to 32 entries
+const unsigned int VERTEX_CACHE_SIZE = 32;
+
+//indexed triangle list with unique vertices, attribute arrays are empty when absent
+struct MeshData
+{
+	unsigned int attributes = 0;
+	std::vector<glm::vec3> positions;
+	std::vector<glm::vec3> normals;
+	std::vector<glm::vec2> texCoords;
+	std::vector<uint32_t> indices;
+};
+
+//weld identical vertices of an unindexed triangle list of interleaved floats (position, [normal], [texCoord])
+MeshData BuildIndexedMesh(const float *vertices, unsigned int vertexCount, unsigned int attributes);
+//reorder triangles for post-transform cache reuse (Forsyth's linear-speed algorithm),
+//then vertices by first use so fetches walk the buffers forward
+void OptimizeMesh(MeshData &mesh);
+//transformed vertices per triangle with a FIFO cache, 0.5 is ideal for large grids, 3 means no reuse
+float AverageCacheMissRatio(const std::vector<uint32_t> &indices, unsigned int cacheSize = VERTEX_CACHE_SIZE);
+
+//normal as GL_INT_2_10_10_10_REV and texture coordinates as half floats, 8 bytes instead of 20
+struct PackedAttributes
+{
+	uint32_t normal;
+	uint16_t texCoord[2];
+};
+
+//vertex and index data in upload layout, pointing into a PackedMesh or a mapped model cache
+struct MeshBuffers
+{
+	unsigned int attributes = 0;
+	unsigned int vertexCount = 0;
+	unsigned int indexCount = 0;
+	//GL_UNSIGNED_SHORT when every index fits, GL_UNSIGNED_INT otherwise
+	unsigned int indexType = 0;
+	const glm::vec3 *positions = nullptr;
+	//null when attributes is 0
+	const PackedAttributes *packed = nullptr;
+	const void *indices = nullptr;
+	glm::vec3 boundsMin;
+	glm::vec3 boundsMax;
+};
+
+//storage of packed attributes and narrowed indices, buffers point into it and into the source positions
+struct PackedMesh
+{
+	std::vector<PackedAttributes> packed;
+	std::vector<unsigned char> indices;
+	MeshBuffers buffers;
+};
+
+void PackMesh(const MeshData &data, PackedMesh &mesh);
+//bytes per index of indexType
+unsigned int IndexSize(unsigned int indexType);
+
+//indexed mesh in GL buffers, positions live in their own buffer so depth-only passes fetch 12 bytes per vertex
+class Mesh
+{
+public:
+	void Create(const MeshData &data);
+	//upload as is, without an intermediate copy
+	void Create(const MeshBuffers &buffers);
+
+	//positions and packed attributes at locations 0, 1 and 2
+	unsigned int vao = 0;
+	//positions only, for shadow passes
+	unsigned int shadowVao = 0;
+	unsigned int vertexCount = 0;
+	unsigned int indexCount = 0;
+	unsigned int indexType = 0;
+	//model space bounding box
+	glm::vec3 boundsMin;
+	glm::vec3 boundsMax;
+
+private:
+	unsigned int positionBuffer = 0;
+	unsigned int attributeBuffer = 0;
+	unsigned int indexBuffer = 0;
+};
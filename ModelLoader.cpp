@@ -0,0 +1,291 @@
+#include "ModelLoader.h"
+
+#include <glad/glad.h>
+#include <assimp/Importer.hpp>
+#include <assimp/scene.h>
+#include <assimp/postprocess.h>
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+std::string CookedModelPath(const std::string &source)
+{
+	//models of the same name in different directories share the cache directory, the hash of the whole path tells them apart
+	std::string normalized = source;
+	std::replace(normalized.begin(), normalized.end(), '\\', '/');
+	char hash[17];
+	snprintf(hash, sizeof(hash), "%016llx", (unsigned long long)HashBytes(normalized.data(), normalized.size()));
+
+	size_t slash = normalized.find_last_of('/');
+	return std::string(COOKED_MODEL_DIRECTORY) + (slash == std::string::npos ? normalized : normalized.substr(slash + 1)) + "." + hash + ".gmdl";
+}
+
+//64 bit FNV-1a of file content mixed with the cache version, 0 when file cannot be read
+static uint64_t HashModelSource(const std::string &path)
+{
+	MappedFile file;
+	if (!file.Open(path)) { return 0; }
+	return HashBytes(file.Data(), file.Size(), FNV_OFFSET_BASIS ^ COOKED_MODEL_VERSION);
+}
+
+//pad file to the next 16 byte boundary, returns the new size
+static uint64_t AlignFile(std::ofstream &file, uint64_t written)
+{
+	const char zeros[16] = {};
+	uint64_t padding = (16 - written % 16) % 16;
+	file.write(zeros, padding);
+	return written + padding;
+}
+
+bool CookModel(const std::string &source, uint64_t sourceHash, const std::string &output)
+{
+	//node transforms are baked into the vertices, so the whole model is one list of meshes in model space
+	//V is flipped because textures are uploaded with their first row at t = 0
+	Assimp::Importer importer;
+	const aiScene *scene = importer.ReadFile(source, aiProcess_Triangulate | aiProcess_JoinIdenticalVertices | aiProcess_GenSmoothNormals
+		| aiProcess_PreTransformVertices | aiProcess_SortByPType | aiProcess_FlipUVs);
+	if (!scene || (scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE))
+	{
+		std::cout << "ERROR: MODEL IMPORT FAILED: " << source << "\n" << importer.GetErrorString() << std::endl;
+		return false;
+	}
+
+	//every mesh is optimized on its own, then appended to the shared vertex and index data
+	MeshData combined;
+	combined.attributes = MESH_NORMALS | MESH_TEXCOORDS;
+	std::vector<CookedSubmesh> submeshes;
+	float missesBefore = 0.0f, missesAfter = 0.0f;
+	for (unsigned int m = 0; m < scene->mNumMeshes; m++)
+	{
+		const aiMesh *sourceMesh = scene->mMeshes[m];
+		//points and lines are split off by SortByPType
+		if (!(sourceMesh->mPrimitiveTypes & aiPrimitiveType_TRIANGLE) || sourceMesh->mNumVertices == 0) { continue; }
+
+		MeshData data;
+		data.attributes = combined.attributes;
+		data.positions.resize(sourceMesh->mNumVertices);
+		data.normals.resize(sourceMesh->mNumVertices, glm::vec3(0.0f, 1.0f, 0.0f));
+		data.texCoords.resize(sourceMesh->mNumVertices, glm::vec2(0.0f));
+		for (unsigned int v = 0; v < sourceMesh->mNumVertices; v++)
+		{
+			data.positions[v] = glm::vec3(sourceMesh->mVertices[v].x, sourceMesh->mVertices[v].y, sourceMesh->mVertices[v].z);
+			if (sourceMesh->HasNormals()) { data.normals[v] = glm::vec3(sourceMesh->mNormals[v].x, sourceMesh->mNormals[v].y, sourceMesh->mNormals[v].z); }
+			if (sourceMesh->HasTextureCoords(0)) { data.texCoords[v] = glm::vec2(sourceMesh->mTextureCoords[0][v].x, sourceMesh->mTextureCoords[0][v].y); }
+		}
+		for (unsigned int f = 0; f < sourceMesh->mNumFaces; f++)
+		{
+			if (sourceMesh->mFaces[f].mNumIndices != 3) { continue; }
+			data.indices.insert(data.indices.end(), sourceMesh->mFaces[f].mIndices, sourceMesh->mFaces[f].mIndices + 3);
+		}
+		if (data.indices.empty()) { continue; }
+
+		unsigned int triangles = (unsigned int)data.indices.size() / 3;
+		missesBefore += AverageCacheMissRatio(data.indices) * triangles;
+		OptimizeMesh(data);
+		missesAfter += AverageCacheMissRatio(data.indices) * triangles;
+
+		CookedSubmesh submesh = {};
+		submesh.firstIndex = (uint32_t)combined.indices.size();
+		submesh.indexCount = (uint32_t)data.indices.size();
+		submesh.material = sourceMesh->mMaterialIndex;
+		glm::vec3 boundsMin(FLT_MAX), boundsMax(-FLT_MAX);
+		for (const glm::vec3 &position : data.positions)
+		{
+			boundsMin = glm::min(boundsMin, position);
+			boundsMax = glm::max(boundsMax, position);
+		}
+		memcpy(submesh.boundsMin, &boundsMin.x, sizeof(submesh.boundsMin));
+		memcpy(submesh.boundsMax, &boundsMax.x, sizeof(submesh.boundsMax));
+		submeshes.push_back(submesh);
+
+		uint32_t baseVertex = (uint32_t)combined.positions.size();
+		for (uint32_t index : data.indices) { combined.indices.push_back(baseVertex + index); }
+		combined.positions.insert(combined.positions.end(), data.positions.begin(), data.positions.end());
+		combined.normals.insert(combined.normals.end(), data.normals.begin(), data.normals.end());
+		combined.texCoords.insert(combined.texCoords.end(), data.texCoords.begin(), data.texCoords.end());
+	}
+	if (submeshes.empty())
+	{
+		std::cout << "ERROR: MODEL HAS NO TRIANGLES: " << source << std::endl;
+		return false;
+	}
+
+	std::vector<CookedMaterial> materials(scene->mNumMaterials);
+	for (unsigned int m = 0; m < scene->mNumMaterials; m++)
+	{
+		const aiMaterial *sourceMaterial = scene->mMaterials[m];
+		CookedMaterial &material = materials[m];
+		memset(&material, 0, sizeof(material));
+
+		aiString texture;
+		//embedded textures (paths starting with *) are not supported, those materials fall back to their color
+		if (sourceMaterial->GetTexture(aiTextureType_DIFFUSE, 0, &texture) == aiReturn_SUCCESS && texture.C_Str()[0] != '*')
+		{
+			strncpy(material.diffuseTexture, texture.C_Str(), MATERIAL_TEXTURE_PATH_SIZE - 1);
+		}
+		aiColor4D color(1.0f, 1.0f, 1.0f, 1.0f);
+		sourceMaterial->Get(AI_MATKEY_COLOR_DIFFUSE, color);
+		material.diffuseColor[0] = color.r;
+		material.diffuseColor[1] = color.g;
+		material.diffuseColor[2] = color.b;
+		material.diffuseColor[3] = color.a;
+		//same default as the built-in objects when the format carries no exponent
+		material.shininess = 64.0f;
+		sourceMaterial->Get(AI_MATKEY_SHININESS, material.shininess);
+		if (material.shininess <= 0.0f) { material.shininess = 64.0f; }
+	}
+	for (CookedSubmesh &submesh : submeshes)
+	{
+		if (submesh.material >= materials.size()) { submesh.material = 0; }
+	}
+	if (materials.empty())
+	{
+		CookedMaterial material = {};
+		std::fill(material.diffuseColor, material.diffuseColor + 4, 1.0f);
+		material.shininess = 64.0f;
+		materials.push_back(material);
+	}
+
+	PackedMesh packed;
+	PackMesh(combined, packed);
+	const MeshBuffers &buffers = packed.buffers;
+
+	CookedModelHeader header = {};
+	memcpy(header.magic, "GMDL", 4);
+	header.version = COOKED_MODEL_VERSION;
+	header.sourceHash = sourceHash;
+	header.attributes = buffers.attributes;
+	header.vertexCount = buffers.vertexCount;
+	header.indexCount = buffers.indexCount;
+	header.indexType = buffers.indexType;
+	header.submeshCount = (uint32_t)submeshes.size();
+	header.materialCount = (uint32_t)materials.size();
+	memcpy(header.boundsMin, &buffers.boundsMin.x, sizeof(header.boundsMin));
+	memcpy(header.boundsMax, &buffers.boundsMax.x, sizeof(header.boundsMax));
+
+	uint64_t positionSize = (uint64_t)buffers.vertexCount * sizeof(glm::vec3);
+	uint64_t attributeSize = (uint64_t)buffers.vertexCount * sizeof(PackedAttributes);
+	uint64_t indexSize = (uint64_t)buffers.indexCount * IndexSize(buffers.indexType);
+	uint64_t tableEnd = sizeof(header) + submeshes.size() * sizeof(CookedSubmesh) + materials.size() * sizeof(CookedMaterial);
+	header.positionOffset = (tableEnd + 15) & ~(uint64_t)15;
+	header.attributeOffset = (header.positionOffset + positionSize + 15) & ~(uint64_t)15;
+	header.indexOffset = (header.attributeOffset + attributeSize + 15) & ~(uint64_t)15;
+
+	//models may be loaded from anywhere, so the parent of the cache directory is created as well
+	std::string directory(COOKED_MODEL_DIRECTORY);
+	directory.pop_back();
+	MakeDirectory(directory.substr(0, directory.find_last_of('/')));
+	MakeDirectory(directory);
+	std::ofstream file(output, std::ios::binary);
+	if (!file)
+	{
+		std::cout << "ERROR: MODEL CACHE FAILED TO WRITE: " << output << std::endl;
+		return false;
+	}
+	file.write((const char *)&header, sizeof(header));
+	file.write((const char *)submeshes.data(), submeshes.size() * sizeof(CookedSubmesh));
+	file.write((const char *)materials.data(), materials.size() * sizeof(CookedMaterial));
+	AlignFile(file, tableEnd);
+	file.write((const char *)buffers.positions, positionSize);
+	AlignFile(file, header.positionOffset + positionSize);
+	file.write((const char *)buffers.packed, attributeSize);
+	AlignFile(file, header.attributeOffset + attributeSize);
+	file.write((const char *)buffers.indices, indexSize);
+
+	unsigned int triangles = buffers.indexCount / 3;
+	std::cout << "imported " << source << ": " << buffers.vertexCount << " vertices, " << triangles << " triangles, "
+		<< submeshes.size() << " submeshes, ACMR " << missesBefore / triangles << " -> " << missesAfter / triangles << std::endl;
+	return (bool)file;
+}
+
+bool ParseCookedModel(const MappedFile &file, CookedModel &model)
+{
+	if (file.Size() < sizeof(CookedModelHeader)) { return false; }
+
+	const CookedModelHeader *header = (const CookedModelHeader *)file.Data();
+	if (memcmp(header->magic, "GMDL", 4) != 0 || header->version != COOKED_MODEL_VERSION) { return false; }
+	if (header->submeshCount == 0 || header->materialCount == 0) { return false; }
+	if (header->indexType != GL_UNSIGNED_SHORT && header->indexType != GL_UNSIGNED_INT) { return false; }
+
+	uint64_t tableEnd = sizeof(CookedModelHeader) + (uint64_t)header->submeshCount * sizeof(CookedSubmesh)
+		+ (uint64_t)header->materialCount * sizeof(CookedMaterial);
+	if (tableEnd > file.Size()
+		|| header->positionOffset + (uint64_t)header->vertexCount * sizeof(glm::vec3) > file.Size()
+		|| header->attributeOffset + (uint64_t)header->vertexCount * sizeof(PackedAttributes) > file.Size()
+		|| header->indexOffset + (uint64_t)header->indexCount * IndexSize(header->indexType) > file.Size())
+	{
+		return false;
+	}
+
+	const CookedSubmesh *submeshes = (const CookedSubmesh *)(file.Data() + sizeof(CookedModelHeader));
+	for (uint32_t i = 0; i < header->submeshCount; i++)
+	{
+		if (submeshes[i].firstIndex + (uint64_t)submeshes[i].indexCount > header->indexCount || submeshes[i].material >= header->materialCount) { return false; }
+	}
+
+	model.header = header;
+	model.submeshes = submeshes;
+	model.materials = (const CookedMaterial *)(submeshes + header->submeshCount);
+	model.buffers.attributes = header->attributes;
+	model.buffers.vertexCount = header->vertexCount;
+	model.buffers.indexCount = header->indexCount;
+	model.buffers.indexType = header->indexType;
+	model.buffers.positions = (const glm::vec3 *)(file.Data() + header->positionOffset);
+	model.buffers.packed = (const PackedAttributes *)(file.Data() + header->attributeOffset);
+	model.buffers.indices = file.Data() + header->indexOffset;
+	model.buffers.boundsMin = glm::vec3(header->boundsMin[0], header->boundsMin[1], header->boundsMin[2]);
+	model.buffers.boundsMax = glm::vec3(header->boundsMax[0], header->boundsMax[1], header->boundsMax[2]);
+	return true;
+}
+
+bool Model::Load(const std::string &path)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+	imported = false;
+
+	uint64_t sourceHash = HashModelSource(path);
+	if (sourceHash == 0)
+	{
+		std::cout << "ERROR: MODEL NOT FOUND: " << path << std::endl;
+		return false;
+	}
+
+	std::string cachePath = CookedModelPath(path);
+	MappedFile cache;
+	CookedModel cooked;
+	if (!cache.Open(cachePath) || !ParseCookedModel(cache, cooked) || cooked.header->sourceHash != sourceHash)
+	{
+		//the slow path, taken on first load and after the source changed
+		cache.Close();
+		if (!CookModel(path, sourceHash, cachePath)) { return false; }
+		if (!cache.Open(cachePath) || !ParseCookedModel(cache, cooked))
+		{
+			std::cout << "ERROR: MODEL CACHE UNREADABLE: " << cachePath << std::endl;
+			return false;
+		}
+		imported = true;
+	}
+
+	//vertex and index blobs go from the mapping straight into the GL buffers
+	mesh.Create(cooked.buffers);
+	submeshes.assign(cooked.submeshes, cooked.submeshes + cooked.header->submeshCount);
+
+	size_t slash = path.find_last_of("/\\");
+	std::string directory = slash == std::string::npos ? "" : path.substr(0, slash + 1);
+	materials.resize(cooked.header->materialCount);
+	for (uint32_t i = 0; i < cooked.header->materialCount; i++)
+	{
+		const CookedMaterial &source = cooked.materials[i];
+		std::string texture(source.diffuseTexture, strnlen(source.diffuseTexture, MATERIAL_TEXTURE_PATH_SIZE));
+		materials[i].diffuseTexture = texture.empty() ? "" : directory + texture;
+		materials[i].diffuseColor = glm::vec4(source.diffuseColor[0], source.diffuseColor[1], source.diffuseColor[2], source.diffuseColor[3]);
+		materials[i].shininess = source.shininess;
+	}
+
+	loadMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	return true;
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "MappedFile.h"
+#include "Mesh.h"
+
+//mesh caches live next to the source models, one per model named after its file
+const char COOKED_MODEL_DIRECTORY[] = "Models/cooked/";
+const uint32_t COOKED_MODEL_VERSION = 1;
+const unsigned int MATERIAL_TEXTURE_PATH_SIZE = 256;
+
+//cache layout: header, submesh table, material table, then position, packed attribute and index blobs
+//blobs start 16 byte aligned and are in the layout Mesh uploads, so a mapped cache goes to the GPU as is
+struct CookedModelHeader
+{
+	char magic[4];
+	uint32_t version;
+	//hash of the source file content, the importer runs again when it differs
+	uint64_t sourceHash;
+	uint32_t attributes;
+	uint32_t vertexCount;
+	uint32_t indexCount;
+	uint32_t indexType;
+	uint32_t submeshCount;
+	uint32_t materialCount;
+	float boundsMin[3];
+	float boundsMax[3];
+	//from file start
+	uint64_t positionOffset;
+	uint64_t attributeOffset;
+	uint64_t indexOffset;
+};
+
+//range of the shared index buffer drawn with one material, indices address the whole vertex buffer
+struct CookedSubmesh
+{
+	uint32_t firstIndex;
+	uint32_t indexCount;
+	uint32_t material;
+	float boundsMin[3];
+	float boundsMax[3];
+};
+
+struct CookedMaterial
+{
+	//relative to the model file, empty when the material has no diffuse texture
+	char diffuseTexture[MATERIAL_TEXTURE_PATH_SIZE];
+	float diffuseColor[4];
+	float shininess;
+};
+
+//validated view into a mapped cache
+struct CookedModel
+{
+	const CookedModelHeader *header = nullptr;
+	const CookedSubmesh *submeshes = nullptr;
+	const CookedMaterial *materials = nullptr;
+	MeshBuffers buffers;
+};
+
+struct ModelMaterial
+{
+	//resolved against the model directory, empty without a texture
+	std::string diffuseTexture;
+	glm::vec4 diffuseColor;
+	float shininess;
+};
+
+//model drawn from one mesh, submesh index ranges select the material
+class Model
+{
+public:
+	//map the mesh cache of path, running the importer first when the cache is missing or stale
+	bool Load(const std::string &path);
+
+	Mesh mesh;
+	std::vector<CookedSubmesh> submeshes;
+	std::vector<ModelMaterial> materials;
+	//whether the last Load ran the importer
+	bool imported = false;
+	double loadMs = 0.0;
+};
+
+//cache path of a model, named after its source file and a hash of the path it was given
+std::string CookedModelPath(const std::string &source);
+
+//import source with assimp, weld, optimize and pack every mesh and write the cache
+bool CookModel(const std::string &source, uint64_t sourceHash, const std::string &output);
+
+bool ParseCookedModel(const MappedFile &file, CookedModel &model);
@@ -0,0 +1,434 @@
+#include "OcclusionCuller.h"
+#include "Random.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+static unsigned int Log2(unsigned int value)
+{
+	unsigned int log = 0;
+	while (value > 1)
+	{
+		value >>= 1;
+		log++;
+	}
+	return log;
+}
+
+void OcclusionCuller::Start(unsigned int threadCount)
+{
+	tileBins.resize(OCCLUSION_TILES_X * OCCLUSION_TILES_Y);
+	levels.resize(Log2(std::min(OCCLUSION_WIDTH, OCCLUSION_HEIGHT)) + 1);
+	for (unsigned int level = 0; level < levels.size(); level++)
+	{
+		levels[level].assign((OCCLUSION_WIDTH >> level) * (OCCLUSION_HEIGHT >> level), 1.0f);
+	}
+	workers.Start(threadCount);
+}
+
+void OcclusionCuller::Stop()
+{
+	workers.Stop();
+}
+
+void OcclusionCuller::BeginFrame(const glm::mat4 &viewProjection)
+{
+	this->viewProjection = viewProjection;
+	triangles.clear();
+	for (std::vector<uint32_t> &bin : tileBins) { bin.clear(); }
+}
+
+void OcclusionCuller::AddOccluder(const OccluderMesh &mesh, const glm::mat4 &model)
+{
+	glm::mat4 transform = viewProjection * model;
+	clipPositions.resize(mesh.positions.size());
+	for (size_t i = 0; i < mesh.positions.size(); i++) { clipPositions[i] = transform * glm::vec4(mesh.positions[i], 1.0f); }
+
+	for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+	{
+		const glm::vec4 &a = clipPositions[mesh.indices[i]], &b = clipPositions[mesh.indices[i + 1]], &c = clipPositions[mesh.indices[i + 2]];
+
+		//outside when all three corners are beyond the same side or far plane
+		if ((a.x > a.w && b.x > b.w && c.x > c.w) || (a.x < -a.w && b.x < -b.w && c.x < -c.w) ||
+			(a.y > a.w && b.y > b.w && c.y > c.w) || (a.y < -a.w && b.y < -b.w && c.y < -c.w) ||
+			(a.z > a.w && b.z > b.w && c.z > c.w)) { continue; }
+
+		//the near plane is the only one clipped against, the others only bound the pixels rasterized
+		bool inside[3] = { a.z >= -a.w, b.z >= -b.w, c.z >= -c.w };
+		if (inside[0] && inside[1] && inside[2])
+		{
+			AddTriangle(a, b, c);
+			continue;
+		}
+
+		const glm::vec4 corners[3] = { a, b, c };
+		glm::vec4 polygon[4];
+		unsigned int count = 0;
+		for (unsigned int j = 0; j < 3; j++)
+		{
+			const glm::vec4 &p = corners[j], &q = corners[(j + 1) % 3];
+			float dp = p.z + p.w, dq = q.z + q.w;
+			if (inside[j]) { polygon[count++] = p; }
+			if (inside[j] != inside[(j + 1) % 3]) { polygon[count++] = p + (q - p) * (dp / (dp - dq)); }
+		}
+		for (unsigned int j = 1; j + 1 < count; j++) { AddTriangle(polygon[0], polygon[j], polygon[j + 1]); }
+	}
+}
+
+void OcclusionCuller::AddTriangle(const glm::vec4 &a, const glm::vec4 &b, const glm::vec4 &c)
+{
+	//pixel coordinates with y up, depth in NDC
+	float x[3], y[3], z[3];
+	const glm::vec4 *corners[3] = { &a, &b, &c };
+	for (int i = 0; i < 3; i++)
+	{
+		float invW = 1.0f / corners[i]->w;
+		x[i] = (corners[i]->x * invW * 0.5f + 0.5f) * OCCLUSION_WIDTH;
+		y[i] = (corners[i]->y * invW * 0.5f + 0.5f) * OCCLUSION_HEIGHT;
+		z[i] = corners[i]->z * invW;
+	}
+
+	//occluders are drawn from both sides, clockwise triangles are flipped
+	float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+	if (area < 0.0f)
+	{
+		std::swap(x[1], x[2]);
+		std::swap(y[1], y[2]);
+		std::swap(z[1], z[2]);
+		area = -area;
+	}
+	if (!(area > 1e-6f)) { return; }
+
+	//pixels are sampled at their centers
+	Triangle triangle;
+	float minX = std::min(x[0], std::min(x[1], x[2])), maxX = std::max(x[0], std::max(x[1], x[2]));
+	float minY = std::min(y[0], std::min(y[1], y[2])), maxY = std::max(y[0], std::max(y[1], y[2]));
+	triangle.minX = (int)std::ceil(std::max(minX - 0.5f, 0.0f));
+	triangle.minY = (int)std::ceil(std::max(minY - 0.5f, 0.0f));
+	triangle.maxX = (int)std::floor(std::min(maxX - 0.5f, (float)OCCLUSION_WIDTH - 1.0f));
+	triangle.maxY = (int)std::floor(std::min(maxY - 0.5f, (float)OCCLUSION_HEIGHT - 1.0f));
+	if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY) { return; }
+
+	for (int i = 0; i < 3; i++)
+	{
+		int j = (i + 1) % 3;
+		triangle.edgeA[i] = y[i] - y[j];
+		triangle.edgeB[i] = x[j] - x[i];
+		triangle.edgeC[i] = (y[j] - y[i]) * x[i] - (x[j] - x[i]) * y[i];
+	}
+	triangle.dzdx = ((z[1] - z[0]) * (y[2] - y[0]) - (z[2] - z[0]) * (y[1] - y[0])) / area;
+	triangle.dzdy = ((x[1] - x[0]) * (z[2] - z[0]) - (x[2] - x[0]) * (z[1] - z[0])) / area;
+	triangle.z0 = z[0] - triangle.dzdx * x[0] - triangle.dzdy * y[0];
+
+	uint32_t index = (uint32_t)triangles.size();
+	triangles.push_back(triangle);
+	for (int ty = triangle.minY / (int)OCCLUSION_TILE_SIZE; ty <= triangle.maxY / (int)OCCLUSION_TILE_SIZE; ty++)
+	{
+		for (int tx = triangle.minX / (int)OCCLUSION_TILE_SIZE; tx <= triangle.maxX / (int)OCCLUSION_TILE_SIZE; tx++)
+		{
+			tileBins[ty * OCCLUSION_TILES_X + tx].push_back(index);
+		}
+	}
+}
+
+void OcclusionCuller::Rasterize()
+{
+	//workers and the calling thread take tiles until none is left
+	workers.Run(OCCLUSION_TILES_X * OCCLUSION_TILES_Y, [this](unsigned int tile) { RasterizeTile(tile); });
+
+	//levels above a tile span several tiles
+	for (unsigned int level = Log2(OCCLUSION_TILE_SIZE) + 1; level < levels.size(); level++)
+	{
+		Downsample(level, 0, 0, OCCLUSION_WIDTH >> level, OCCLUSION_HEIGHT >> level);
+	}
+}
+
+void OcclusionCuller::RasterizeTile(unsigned int tile)
+{
+	int tileX = (int)((tile % OCCLUSION_TILES_X) * OCCLUSION_TILE_SIZE), tileY = (int)((tile / OCCLUSION_TILES_X) * OCCLUSION_TILE_SIZE);
+	float *depth = levels[0].data();
+	for (int y = tileY; y < tileY + (int)OCCLUSION_TILE_SIZE; y++)
+	{
+		std::fill(depth + y * OCCLUSION_WIDTH + tileX, depth + y * OCCLUSION_WIDTH + tileX + OCCLUSION_TILE_SIZE, 1.0f);
+	}
+
+	for (uint32_t index : tileBins[tile])
+	{
+		const Triangle &triangle = triangles[index];
+		//rows start on a multiple of 4 pixels, tiles do too, so the last 4 pixels of a row end inside the tile
+		int x0 = std::max(triangle.minX, tileX) & ~3, x1 = std::min(triangle.maxX, tileX + (int)OCCLUSION_TILE_SIZE - 1);
+		int y0 = std::max(triangle.minY, tileY), y1 = std::min(triangle.maxY, tileY + (int)OCCLUSION_TILE_SIZE - 1);
+
+#if USE_SSE
+		//edge functions and depth of 4 neighbouring pixels, stepped 4 pixels to the right per iteration
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 pixelCenters = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+		__m128 edgeStep[3];
+		for (int e = 0; e < 3; e++) { edgeStep[e] = _mm_set1_ps(triangle.edgeA[e] * 4.0f); }
+		__m128 depthStep = _mm_set1_ps(triangle.dzdx * 4.0f);
+
+		for (int y = y0; y <= y1; y++)
+		{
+			float py = (float)y + 0.5f;
+			__m128 px = _mm_add_ps(_mm_set1_ps((float)x0), pixelCenters);
+			__m128 edge[3];
+			for (int e = 0; e < 3; e++)
+			{
+				edge[e] = _mm_add_ps(_mm_mul_ps(px, _mm_set1_ps(triangle.edgeA[e])), _mm_set1_ps(triangle.edgeB[e] * py + triangle.edgeC[e]));
+			}
+			__m128 z = _mm_add_ps(_mm_mul_ps(px, _mm_set1_ps(triangle.dzdx)), _mm_set1_ps(triangle.dzdy * py + triangle.z0));
+
+			float *row = depth + y * OCCLUSION_WIDTH;
+			for (int x = x0; x <= x1; x += 4)
+			{
+				__m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(edge[0], zero), _mm_cmpge_ps(edge[1], zero)), _mm_cmpge_ps(edge[2], zero));
+				if (_mm_movemask_ps(inside))
+				{
+					__m128 stored = _mm_loadu_ps(row + x);
+					__m128 nearest = _mm_min_ps(stored, z);
+					_mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearest), _mm_andnot_ps(inside, stored)));
+				}
+				for (int e = 0; e < 3; e++) { edge[e] = _mm_add_ps(edge[e], edgeStep[e]); }
+				z = _mm_add_ps(z, depthStep);
+			}
+		}
+#else
+		for (int y = y0; y <= y1; y++)
+		{
+			float py = (float)y + 0.5f;
+			float *row = depth + y * OCCLUSION_WIDTH;
+			for (int x = x0; x <= x1; x++)
+			{
+				float px = (float)x + 0.5f;
+				bool inside = true;
+				for (int e = 0; e < 3; e++) { inside = inside && triangle.edgeA[e] * px + triangle.edgeB[e] * py + triangle.edgeC[e] >= 0.0f; }
+				if (inside) { row[x] = std::min(row[x], triangle.z0 + triangle.dzdx * px + triangle.dzdy * py); }
+			}
+		}
+#endif
+	}
+
+	for (unsigned int level = 1; level <= Log2(OCCLUSION_TILE_SIZE); level++)
+	{
+		Downsample(level, tileX >> level, tileY >> level, (tileX + OCCLUSION_TILE_SIZE) >> level, (tileY + OCCLUSION_TILE_SIZE) >> level);
+	}
+}
+
+void OcclusionCuller::Downsample(unsigned int level, unsigned int x0, unsigned int y0, unsigned int x1, unsigned int y1)
+{
+	unsigned int width = OCCLUSION_WIDTH >> level, sourceWidth = OCCLUSION_WIDTH >> (level - 1);
+	const float *source = levels[level - 1].data();
+	float *target = levels[level].data();
+	for (unsigned int y = y0; y < y1; y++)
+	{
+		const float *top = source + (2 * y + 1) * sourceWidth, *bottom = source + 2 * y * sourceWidth;
+		float *row = target + y * width;
+		unsigned int x = x0;
+
+#if USE_SSE
+		//8 source pixels of both rows make 4 target pixels, even and odd columns are split by shuffles
+		for (; x + 4 <= x1; x += 4)
+		{
+			__m128 rows[2] =
+			{
+				_mm_max_ps(_mm_loadu_ps(bottom + 2 * x), _mm_loadu_ps(top + 2 * x)),
+				_mm_max_ps(_mm_loadu_ps(bottom + 2 * x + 4), _mm_loadu_ps(top + 2 * x + 4))
+			};
+			__m128 even = _mm_shuffle_ps(rows[0], rows[1], _MM_SHUFFLE(2, 0, 2, 0));
+			__m128 odd = _mm_shuffle_ps(rows[0], rows[1], _MM_SHUFFLE(3, 1, 3, 1));
+			_mm_storeu_ps(row + x, _mm_max_ps(even, odd));
+		}
+#endif
+
+		for (; x < x1; x++)
+		{
+			row[x] = std::max(std::max(bottom[2 * x], bottom[2 * x + 1]), std::max(top[2 * x], top[2 * x + 1]));
+		}
+	}
+}
+
+bool OcclusionCuller::IsVisible(const glm::vec3 &center, float radius) const
+{
+	//screen rectangle and nearest depth of the box around the sphere, the sphere is inside both
+	float minX = FLT_MAX, minY = FLT_MAX, maxX = -FLT_MAX, maxY = -FLT_MAX, minZ = FLT_MAX;
+	for (int i = 0; i < 8; i++)
+	{
+		glm::vec3 corner = center + glm::vec3(i & 1 ? radius : -radius, i & 2 ? radius : -radius, i & 4 ? radius : -radius);
+		glm::vec4 clip = viewProjection * glm::vec4(corner, 1.0f);
+		//reaching in front of the near plane, nothing can be in front of it
+		if (clip.z < -clip.w) { return true; }
+
+		float invW = 1.0f / clip.w;
+		minX = std::min(minX, clip.x * invW);
+		maxX = std::max(maxX, clip.x * invW);
+		minY = std::min(minY, clip.y * invW);
+		maxY = std::max(maxY, clip.y * invW);
+		minZ = std::min(minZ, clip.z * invW);
+	}
+
+	auto pixel = [](float ndc, unsigned int size) { return std::min(std::max((int)std::floor((ndc * 0.5f + 0.5f) * size), 0), (int)size - 1); };
+	int x0 = pixel(minX, OCCLUSION_WIDTH), x1 = pixel(maxX, OCCLUSION_WIDTH);
+	int y0 = pixel(minY, OCCLUSION_HEIGHT), y1 = pixel(maxY, OCCLUSION_HEIGHT);
+
+	//coarsest level where the rectangle spans at most 5 pixels per side
+	unsigned int span = (unsigned int)std::max(x1 - x0, y1 - y0), level = 0;
+	while (level + 1 < levels.size() && (span >> level) >= 4) { level++; }
+
+	const std::vector<float> &depths = levels[level];
+	unsigned int width = OCCLUSION_WIDTH >> level;
+	for (int y = y0 >> level; y <= y1 >> level; y++)
+	{
+		for (int x = x0 >> level; x <= x1 >> level; x++)
+		{
+			if (depths[y * width + x] >= minZ) { return true; }
+		}
+	}
+	return false;
+}
+
+unsigned int OcclusionCuller::CullOccluded(const BoundingSpheres &spheres, std::vector<unsigned int> &visible) const
+{
+	size_t kept = 0;
+	for (unsigned int index : visible)
+	{
+		glm::vec3 center(spheres.centerX[index], spheres.centerY[index], spheres.centerZ[index]);
+		if (IsVisible(center, spheres.radius[index])) { visible[kept++] = index; }
+	}
+	unsigned int culled = (unsigned int)(visible.size() - kept);
+	visible.resize(kept);
+	return culled;
+}
+
+//first hit of the segment from the origin to point with an axis aligned box, before the point
+static bool SegmentHitsBox(const glm::vec3 &point, const glm::vec3 &boxMin, const glm::vec3 &boxMax)
+{
+	float enter = 0.0f, exit = 1.0f;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		if (std::fabs(point[axis]) < 1e-8f)
+		{
+			if (boxMin[axis] > 0.0f || boxMax[axis] < 0.0f) { return false; }
+			continue;
+		}
+		float t0 = boxMin[axis] / point[axis], t1 = boxMax[axis] / point[axis];
+		enter = std::max(enter, std::min(t0, t1));
+		exit = std::min(exit, std::max(t0, t1));
+	}
+	return enter <= exit && enter < 1.0f;
+}
+
+bool RunOcclusionBenchmark(unsigned int count)
+{
+	count = std::max(1u, count);
+	const unsigned int ITERATIONS = 100;
+
+	//unit box as occluder mesh, every wall is a scaled copy of it
+	OccluderMesh box;
+	for (int i = 0; i < 8; i++) { box.positions.push_back(glm::vec3(i & 1 ? 0.5f : -0.5f, i & 2 ? 0.5f : -0.5f, i & 4 ? 0.5f : -0.5f)); }
+	const uint32_t faces[6][4] = { { 0, 2, 3, 1 }, { 4, 5, 7, 6 }, { 0, 1, 5, 4 }, { 2, 6, 7, 3 }, { 0, 4, 6, 2 }, { 1, 3, 7, 5 } };
+	for (const uint32_t *face : faces)
+	{
+		const uint32_t quad[6] = { face[0], face[1], face[2], face[2], face[3], face[0] };
+		box.indices.insert(box.indices.end(), quad, quad + 6);
+	}
+
+	//three rows of walls in front of a camera at the origin looking down -Z, gaps of each row shifted against the last
+	std::vector<glm::mat4> walls;
+	std::vector<glm::vec3> wallMin, wallMax;
+	for (int row = 0; row < 3; row++)
+	{
+		for (int segment = -5; segment <= 5; segment++)
+		{
+			glm::vec3 center((float)segment * 8.0f + (float)row * 3.0f, 0.0f, -8.0f - 8.0f * (float)row), size(6.0f, 12.0f, 0.5f);
+			walls.push_back(glm::scale(glm::translate(glm::mat4(), center), size));
+			wallMin.push_back(center - size * 0.5f);
+			wallMax.push_back(center + size * 0.5f);
+		}
+	}
+
+	const float FOV = 1.0471976f, ASPECT = 16.0f / 9.0f, NEAR_PLANE = 0.1f, FAR_PLANE = 100.0f;
+	glm::mat4 viewProjection = glm::perspective(FOV, ASPECT, NEAR_PLANE, FAR_PLANE);
+	float tanHalfY = std::tan(FOV * 0.5f), tanHalfX = tanHalfY * ASPECT;
+
+	//spheres spread through the view frustum, in front of the walls and behind them
+	Random random(1234);
+	BoundingSpheres spheres;
+	for (unsigned int i = 0; i < count; i++)
+	{
+		float depth = 2.0f + random.Unit() * 58.0f;
+		glm::vec3 center((random.Unit() * 2.0f - 1.0f) * depth * tanHalfX, (random.Unit() * 2.0f - 1.0f) * depth * tanHalfY, -depth);
+		spheres.Add(center, 0.2f + random.Unit() * 0.8f);
+	}
+	std::vector<unsigned int> all(count);
+	for (unsigned int i = 0; i < count; i++) { all[i] = i; }
+
+	unsigned int threadCount = std::max(1u, std::thread::hardware_concurrency());
+	OcclusionCuller single, parallel;
+	single.Start(1);
+	parallel.Start(threadCount);
+
+	std::vector<unsigned int> visible;
+	auto rasterize = [&walls, &box, &viewProjection](OcclusionCuller &culler)
+	{
+		culler.BeginFrame(viewProjection);
+		for (const glm::mat4 &wall : walls) { culler.AddOccluder(box, wall); }
+		culler.Rasterize();
+	};
+	auto time = [&rasterize, ITERATIONS](OcclusionCuller &culler)
+	{
+		rasterize(culler);
+		auto start = std::chrono::high_resolution_clock::now();
+		for (unsigned int iteration = 0; iteration < ITERATIONS; iteration++) { rasterize(culler); }
+		return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count() / ITERATIONS;
+	};
+	double singleMs = time(single);
+	double parallelMs = time(parallel);
+
+	auto start = std::chrono::high_resolution_clock::now();
+	for (unsigned int iteration = 0; iteration < ITERATIONS; iteration++)
+	{
+		visible = all;
+		parallel.CullOccluded(spheres, visible);
+	}
+	double testMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count() / ITERATIONS;
+
+	std::vector<unsigned int> singleVisible = all;
+	single.CullOccluded(spheres, singleVisible);
+	bool identical = single.DepthBuffer() == parallel.DepthBuffer() && singleVisible == visible;
+
+	//points on hidden spheres must lie behind a wall as seen from the camera, points off screen do not count
+	std::vector<bool> isVisible(count, false);
+	for (unsigned int index : visible) { isVisible[index] = true; }
+	unsigned int samples = 0, missed = 0;
+	for (unsigned int i = 0; i < count; i++)
+	{
+		if (isVisible[i]) { continue; }
+		for (int s = 0; s < 16; s++)
+		{
+			glm::vec3 direction(random.Unit() - 0.5f, random.Unit() - 0.5f, random.Unit() - 0.5f);
+			if (glm::dot(direction, direction) < 1e-6f) { continue; }
+			glm::vec3 point = glm::vec3(spheres.centerX[i], spheres.centerY[i], spheres.centerZ[i]) + glm::normalize(direction) * spheres.radius[i];
+			float depth = -point.z;
+			if (depth < NEAR_PLANE || std::fabs(point.x) > depth * tanHalfX || std::fabs(point.y) > depth * tanHalfY) { continue; }
+
+			samples++;
+			bool hidden = false;
+			for (size_t w = 0; w < wallMin.size() && !hidden; w++) { hidden = SegmentHitsBox(point, wallMin[w], wallMax[w]); }
+			if (!hidden) { missed++; }
+		}
+	}
+
+	std::cout << "occlusion culling of " << count << " spheres behind " << walls.size() << " walls (" << parallel.TriangleCount() << " triangles) at "
+		<< OCCLUSION_WIDTH << "x" << OCCLUSION_HEIGHT << ", " << ITERATIONS << " iterations" << std::endl;
+	std::cout << "  rasterize 1 thread     " << singleMs << " ms" << std::endl;
+	std::cout << "  rasterize " << threadCount << " threads    " << parallelMs << " ms" << std::endl;
+	std::cout << "  test spheres         " << testMs << " ms" << std::endl;
+	std::cout << "  hidden spheres " << count - visible.size() << " of " << count << std::endl;
+	std::cout << "  threaded result " << (identical ? "matches" : "DIFFERS FROM") << " single thread, " << missed << " of " << samples << " sample points on hidden spheres are not behind a wall" << std::endl;
+	return identical && missed == 0;
+}
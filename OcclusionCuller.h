@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "FrustumCuller.h"
+#include "WorkerPool.h"
+
+//resolution of the software depth buffer, pixels need not be square, the whole view is mapped onto it
+//both are powers of two so every level of the max-depth hierarchy halves them exactly
+const unsigned int OCCLUSION_WIDTH = 256;
+const unsigned int OCCLUSION_HEIGHT = 128;
+//square screen tiles rasterized by one thread each, a multiple of 4 so SSE rows never straddle two tiles
+const unsigned int OCCLUSION_TILE_SIZE = 32;
+const unsigned int OCCLUSION_TILES_X = OCCLUSION_WIDTH / OCCLUSION_TILE_SIZE;
+const unsigned int OCCLUSION_TILES_Y = OCCLUSION_HEIGHT / OCCLUSION_TILE_SIZE;
+
+//triangles of an occluder in model space, only positions are needed
+struct OccluderMesh
+{
+	std::vector<glm::vec3> positions;
+	std::vector<uint32_t> indices;
+};
+
+//hides instances behind large occluders before they are drawn: occluder triangles are rasterized into a low resolution
+//depth buffer on the CPU, four pixels per SSE instruction and tiles spread over worker threads, then bounding spheres
+//are tested as screen rectangles against a hierarchy of maximum depths
+//pure CPU like LightClusterer, so it runs the same without GL
+class OcclusionCuller
+{
+public:
+	//threadCount includes the thread calling Rasterize, 1 rasterizes everything on the caller
+	void Start(unsigned int threadCount);
+	void Stop();
+
+	//forget the occluders of the last view, depths are NDC z as seen through viewProjection
+	void BeginFrame(const glm::mat4 &viewProjection);
+	//transform, clip and bin the triangles of mesh, they are drawn by the next Rasterize
+	void AddOccluder(const OccluderMesh &mesh, const glm::mat4 &model);
+	//rasterize every occluder added since BeginFrame and build the max-depth hierarchy
+	void Rasterize();
+
+	//false only when every pixel the sphere may cover holds an occluder closer than the sphere
+	bool IsVisible(const glm::vec3 &center, float radius) const;
+	//drop indices of spheres hidden behind the occluders from visible, keeping the order, returns number dropped
+	unsigned int CullOccluded(const BoundingSpheres &spheres, std::vector<unsigned int> &visible) const;
+
+	//NDC depth of every pixel, row 0 at the bottom of the screen, 1 where no occluder was drawn
+	const std::vector<float> &DepthBuffer() const { return levels[0]; }
+	unsigned int TriangleCount() const { return (unsigned int)triangles.size(); }
+
+private:
+	//screen space triangle: a pixel center x, y is inside when edgeA * x + edgeB * y + edgeC >= 0 for all three edges,
+	//its depth there is z0 + dzdx * x + dzdy * y
+	struct Triangle
+	{
+		float edgeA[3], edgeB[3], edgeC[3];
+		float z0, dzdx, dzdy;
+		//pixels whose centers the triangle may cover, clamped to the screen
+		int minX, minY, maxX, maxY;
+	};
+
+	void RasterizeTile(unsigned int tile);
+	void AddTriangle(const glm::vec4 &a, const glm::vec4 &b, const glm::vec4 &c);
+	//max of 2x2 pixels of level - 1 into level, over the pixels of the rectangle given in level pixels
+	void Downsample(unsigned int level, unsigned int x0, unsigned int y0, unsigned int x1, unsigned int y1);
+
+	glm::mat4 viewProjection;
+	//clip space positions of the occluder being added
+	std::vector<glm::vec4> clipPositions;
+	std::vector<Triangle> triangles;
+	//indices into triangles of every tile a triangle's bounds touch, in the order they were added
+	std::vector<std::vector<uint32_t>> tileBins;
+	//level 0 is the depth buffer, every further level holds the maximum of 2x2 pixels of the one before
+	std::vector<std::vector<float>> levels;
+
+	WorkerPool workers;
+};
+
+//rasterize walls of boxes in front of count random spheres on one and on every hardware thread, time both,
+//check they agree and that no sphere reported hidden has a visible point, print the results and return whether both checks passed
+bool RunOcclusionBenchmark(unsigned int count);
@@ -0,0 +1,189 @@
+#include "Profiler.h"
+
+#include <glad/glad.h>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+Profiler profiler;
+
+void Profiler::Init(bool keep)
+{
+	keepTrace = keep;
+	for (unsigned int i = 0; i < PROFILER_FRAME_LATENCY; i++) { glGenQueries(PROFILER_MAX_GPU_SCOPES * 2, queries[i]); }
+
+	GLint64 gpuNow = 0;
+	glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+	start = std::chrono::high_resolution_clock::now();
+	gpuStartNs = gpuNow;
+	enabled = true;
+}
+
+void Profiler::Shutdown()
+{
+	if (!enabled) { return; }
+
+	//oldest frame first, so kept events stay in frame order
+	for (unsigned int i = 0; i < PROFILER_FRAME_LATENCY; i++)
+	{
+		unsigned int slotIndex = (frameIndex + i) % PROFILER_FRAME_LATENCY;
+		if (slots[slotIndex].pending) { Resolve(slots[slotIndex], slotIndex, true); }
+	}
+	for (unsigned int i = 0; i < PROFILER_FRAME_LATENCY; i++) { glDeleteQueries(PROFILER_MAX_GPU_SCOPES * 2, queries[i]); }
+	enabled = false;
+}
+
+double Profiler::NowMs() const
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+void Profiler::BeginFrame()
+{
+	if (!enabled) { return; }
+
+	unsigned int slotIndex = frameIndex % PROFILER_FRAME_LATENCY;
+	FrameSlot &slot = slots[slotIndex];
+	if (slot.pending) { Resolve(slot, slotIndex, false); }
+
+	slot.events.clear();
+	slot.eventQueries.clear();
+	slot.queryCount = 0;
+	slot.pending = true;
+	inFrame = true;
+}
+
+void Profiler::EndFrame()
+{
+	if (!enabled) { return; }
+
+	if (!open[PROFILE_THREAD_RENDER].empty()) { std::cout << "ERROR: PROFILER SCOPE LEFT OPEN AT END OF FRAME." << std::endl; }
+	open[PROFILE_THREAD_RENDER].clear();
+	inFrame = false;
+	frameIndex++;
+}
+
+void Profiler::BeginScope(const char *name, unsigned int thread, bool gpu)
+{
+	if (!enabled) { return; }
+
+	std::vector<ProfileEvent> *events = &simulationEvents;
+	if (thread == PROFILE_THREAD_RENDER)
+	{
+		//render scopes outside a frame have no slot to go to
+		if (!inFrame) { return; }
+		events = &slots[frameIndex % PROFILER_FRAME_LATENCY].events;
+	}
+
+	ProfileEvent event = { name, thread, (unsigned int)open[thread].size(), NowMs(), 0.0, -1.0, -1.0 };
+	OpenScope scope = { events->size(), -1 };
+	events->push_back(event);
+
+	if (gpu && thread == PROFILE_THREAD_RENDER)
+	{
+		FrameSlot &slot = slots[frameIndex % PROFILER_FRAME_LATENCY];
+		if (slot.queryCount < PROFILER_MAX_GPU_SCOPES * 2)
+		{
+			scope.query = (int)slot.queryCount;
+			slot.queryCount += 2;
+			glQueryCounter(queries[frameIndex % PROFILER_FRAME_LATENCY][scope.query], GL_TIMESTAMP);
+		}
+	}
+	if (thread == PROFILE_THREAD_RENDER) { slots[frameIndex % PROFILER_FRAME_LATENCY].eventQueries.push_back(scope.query); }
+	open[thread].push_back(scope);
+}
+
+void Profiler::EndScope(unsigned int thread)
+{
+	if (!enabled || open[thread].empty()) { return; }
+
+	OpenScope scope = open[thread].back();
+	open[thread].pop_back();
+
+	if (thread != PROFILE_THREAD_RENDER)
+	{
+		simulationEvents[scope.event].cpuEnd = NowMs();
+		//a closed top level scope ends the simulation frame
+		if (open[thread].empty())
+		{
+			Publish(thread, simulationEvents);
+			simulationEvents.clear();
+		}
+		return;
+	}
+
+	unsigned int slotIndex = frameIndex % PROFILER_FRAME_LATENCY;
+	if (scope.query >= 0) { glQueryCounter(queries[slotIndex][scope.query + 1], GL_TIMESTAMP); }
+	slots[slotIndex].events[scope.event].cpuEnd = NowMs();
+}
+
+void Profiler::Resolve(FrameSlot &slot, unsigned int slotIndex, bool wait)
+{
+	slot.pending = false;
+	if (slot.queryCount > 0)
+	{
+		//queries finish in order, so the last one tells for the whole frame
+		GLint available = 0;
+		glGetQueryObjectiv(queries[slotIndex][slot.queryCount - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+		if (available || wait)
+		{
+			for (size_t i = 0; i < slot.events.size(); i++)
+			{
+				int query = slot.eventQueries[i];
+				if (query < 0) { continue; }
+				GLuint64 begin = 0, end = 0;
+				glGetQueryObjectui64v(queries[slotIndex][query], GL_QUERY_RESULT, &begin);
+				glGetQueryObjectui64v(queries[slotIndex][query + 1], GL_QUERY_RESULT, &end);
+				slot.events[i].gpuStart = ((long long)begin - gpuStartNs) / 1000000.0;
+				slot.events[i].gpuEnd = ((long long)end - gpuStartNs) / 1000000.0;
+			}
+		}
+	}
+	Publish(PROFILE_THREAD_RENDER, slot.events);
+}
+
+void Profiler::Publish(unsigned int thread, const std::vector<ProfileEvent> &events)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	lastFrame[thread] = events;
+	if (keepTrace) { trace.insert(trace.end(), events.begin(), events.end()); }
+}
+
+void Profiler::LastFrames(std::vector<ProfileEvent> &events)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	events = lastFrame[PROFILE_THREAD_RENDER];
+	events.insert(events.end(), lastFrame[PROFILE_THREAD_SIMULATION].begin(), lastFrame[PROFILE_THREAD_SIMULATION].end());
+}
+
+bool Profiler::WriteTrace(const std::string &path)
+{
+	std::ofstream file(path);
+	if (!file)
+	{
+		std::cout << "ERROR: PROFILER TRACE FAILED TO WRITE: " << path << std::endl;
+		return false;
+	}
+
+	//complete events in microseconds, GPU work gets a lane of its own next to the two threads
+	const char *laneNames[] = { "Simulation", "Render", "GPU" };
+	file << std::fixed << std::setprecision(3);
+	file << "{\"traceEvents\":[\n";
+	for (int lane = 0; lane < 3; lane++)
+	{
+		file << (lane == 0 ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << lane << ",\"args\":{\"name\":\"" << laneNames[lane] << "\"}}";
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+	for (const ProfileEvent &event : trace)
+	{
+		file << ",\n{\"name\":\"" << event.name << "\",\"cat\":\"cpu\",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.thread
+			<< ",\"ts\":" << event.cpuStart * 1000.0 << ",\"dur\":" << (event.cpuEnd - event.cpuStart) * 1000.0 << "}";
+		if (event.gpuStart < 0.0) { continue; }
+		file << ",\n{\"name\":\"" << event.name << "\",\"cat\":\"gpu\",\"ph\":\"X\",\"pid\":1,\"tid\":2"
+			<< ",\"ts\":" << event.gpuStart * 1000.0 << ",\"dur\":" << (event.gpuEnd - event.gpuStart) * 1000.0 << "}";
+	}
+	file << "\n]}\n";
+	std::cout << "profiler trace of " << trace.size() << " scopes written to " << path << std::endl;
+	return true;
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+
+//frames a GPU result waits before it is read back, by then the queries are normally done and reading never stalls
+const unsigned int PROFILER_FRAME_LATENCY = 4;
+//GPU timed scopes per frame, further scopes of the frame are timed on the CPU only
+const unsigned int PROFILER_MAX_GPU_SCOPES = 32;
+
+//lanes of the trace, the render lane is the thread submitting GL work
+enum ProfileThread
+{
+	PROFILE_THREAD_SIMULATION = 0,
+	PROFILE_THREAD_RENDER = 1,
+	PROFILE_THREAD_COUNT = 2
+};
+
+//closed scope, times in ms since Init, GPU times stay negative when the scope was not timed on the GPU
+struct ProfileEvent
+{
+	//string literal, events keep only the pointer
+	const char *name;
+	unsigned int thread;
+	unsigned int depth;
+	double cpuStart, cpuEnd;
+	double gpuStart, gpuEnd;
+};
+
+//nested CPU scopes on every lane and GPU scopes on the render lane, GPU time comes from a pair of GL_TIMESTAMP
+//queries per scope in a ring of PROFILER_FRAME_LATENCY frames, every call is ignored until Init
+class Profiler
+{
+public:
+	//the context must be current, keepTrace keeps every event for WriteTrace
+	void Init(bool keepTrace);
+	//read back outstanding queries, waiting for them, and delete them
+	void Shutdown();
+	bool Enabled() const { return enabled; }
+
+	//frame of the render lane, reuses the queries of the frame PROFILER_FRAME_LATENCY ago after reading them back
+	void BeginFrame();
+	void EndFrame();
+
+	//scopes of a lane nest and are opened and closed on one thread, gpu only on the render lane inside a frame
+	void BeginScope(const char *name, unsigned int thread, bool gpu);
+	void EndScope(unsigned int thread);
+
+	//newest render frame whose GPU times are known followed by the newest simulation frame, in begin order
+	void LastFrames(std::vector<ProfileEvent> &events);
+	//every kept event as Chrome trace event JSON (chrome://tracing, Perfetto)
+	bool WriteTrace(const std::string &path);
+
+private:
+	struct OpenScope
+	{
+		size_t event;
+		int query;
+	};
+	struct FrameSlot
+	{
+		std::vector<ProfileEvent> events;
+		//first of the two queries of every event, -1 for CPU only events
+		std::vector<int> eventQueries;
+		unsigned int queryCount = 0;
+		bool pending = false;
+	};
+
+	double NowMs() const;
+	//GPU times of a finished frame, left negative when the queries are not done and wait is false
+	void Resolve(FrameSlot &slot, unsigned int slotIndex, bool wait);
+	void Publish(unsigned int thread, const std::vector<ProfileEvent> &events);
+
+	bool enabled = false;
+	bool keepTrace = false;
+	std::chrono::high_resolution_clock::time_point start;
+	//GPU timestamp taken at start, GPU times are moved into the CPU time base with it
+	long long gpuStartNs = 0;
+
+	unsigned int queries[PROFILER_FRAME_LATENCY][PROFILER_MAX_GPU_SCOPES * 2];
+	FrameSlot slots[PROFILER_FRAME_LATENCY];
+	unsigned int frameIndex = 0;
+	bool inFrame = false;
+
+	//open scopes of every lane and the simulation frame being recorded, each only touched by its own thread
+	std::vector<OpenScope> open[PROFILE_THREAD_COUNT];
+	std::vector<ProfileEvent> simulationEvents;
+
+	//completed frames, shared between threads
+	std::mutex mutex;
+	std::vector<ProfileEvent> lastFrame[PROFILE_THREAD_COUNT];
+	std::vector<ProfileEvent> trace;
+};
+
+extern Profiler profiler;
+
+//times the enclosing block
+class ProfileScope
+{
+public:
+	ProfileScope(const char *name, unsigned int thread, bool gpu = false) : thread(thread)
+	{
+		if (profiler.Enabled()) { profiler.BeginScope(name, thread, gpu); }
+	}
+	~ProfileScope()
+	{
+		if (profiler.Enabled()) { profiler.EndScope(thread); }
+	}
+
+private:
+	unsigned int thread;
+};
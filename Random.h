@@ -0,0 +1,18 @@
+#pragma once
+
+#include <random>
+
+//seeded generator for the random scenes of the demo and the benchmarks, the same seed always builds the same scene
+class Random
+{
+public:
+	explicit Random(unsigned int seed) : engine(seed) {}
+
+	//uniform in [0, 1]
+	float Unit() { return (float)(engine() - engine.min()) / (float)(engine.max() - engine.min()); }
+	//uniform integer in [0, count)
+	unsigned int Below(unsigned int count) { return (unsigned int)(engine() % count); }
+
+private:
+	std::mt19937 engine;
+};
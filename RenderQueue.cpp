@@ -0,0 +1,91 @@
+#include "RenderQueue.h"
+#include "GLStateCache.h"
+
+#include <algorithm>
+#include <cstring>
+
+uint64_t MakeSortKey(unsigned int pass, unsigned int program, unsigned int texture, unsigned int vao, float depth)
+{
+	uint64_t quantizedDepth = (uint64_t)(std::min(std::max(depth, 0.0f), 1.0f) * 0xFFFFFF);
+	return ((uint64_t)(pass & 0xF) << 60) | ((uint64_t)(program & 0x3FF) << 50) | ((uint64_t)(texture & 0xFFFF) << 34)
+		| ((uint64_t)(vao & 0x3FF) << 24) | quantizedDepth;
+}
+
+void RadixSortKeys(const std::vector<uint64_t> &keys, std::vector<uint32_t> &order, std::vector<uint32_t> &scratch)
+{
+	size_t count = keys.size();
+	order.resize(count);
+	scratch.resize(count);
+	for (size_t i = 0; i < count; i++) { order[i] = (uint32_t)i; }
+	if (count < 2) { return; }
+
+	//histograms of all eight digits in one pass over the keys
+	uint32_t histograms[8][256];
+	memset(histograms, 0, sizeof(histograms));
+	for (uint64_t key : keys)
+	{
+		for (int digit = 0; digit < 8; digit++) { histograms[digit][(key >> (digit * 8)) & 0xFF]++; }
+	}
+
+	for (int digit = 0; digit < 8; digit++)
+	{
+		uint32_t *histogram = histograms[digit];
+		//one bucket holding every key leaves the order as is
+		if (histogram[(keys[0] >> (digit * 8)) & 0xFF] == count) { continue; }
+
+		uint32_t offset = 0;
+		for (int bucket = 0; bucket < 256; bucket++)
+		{
+			uint32_t bucketSize = histogram[bucket];
+			histogram[bucket] = offset;
+			offset += bucketSize;
+		}
+		for (uint32_t index : order) { scratch[histogram[(keys[index] >> (digit * 8)) & 0xFF]++] = index; }
+		order.swap(scratch);
+	}
+}
+
+void RenderQueue::Submit(unsigned int pass, const DrawPacket &packet, float depth)
+{
+	if (packet.instanceCount == 0 || packet.indexCount == 0) { return; }
+	packets.push_back(packet);
+	keys.push_back(MakeSortKey(pass, packet.program, packet.textures[0], packet.vao, depth));
+}
+
+void RenderQueue::Sort(std::vector<DrawPacket> &sorted)
+{
+	RadixSortKeys(keys, order, scratch);
+	sorted.clear();
+	sorted.reserve(packets.size());
+	for (uint32_t index : order) { sorted.push_back(packets[index]); }
+
+	packets.clear();
+	keys.clear();
+}
+
+void DrawPackets(const std::vector<DrawPacket> &packets)
+{
+	//material uniform is plain program state too, it is only written when it changes
+	unsigned int lastProgram = ~0u;
+	int lastLocation = -1;
+	float lastValue = 0.0f;
+	for (const DrawPacket &packet : packets)
+	{
+		glState.UseProgram(packet.program);
+		if (packet.program != lastProgram) { lastLocation = -1; }
+		lastProgram = packet.program;
+
+		for (unsigned int unit = 0; unit < PACKET_TEXTURE_UNITS; unit++)
+		{
+			if (packet.textureTargets[unit] != 0) { glState.BindTexture(unit, packet.textureTargets[unit], packet.textures[unit]); }
+		}
+		if (packet.materialLocation >= 0 && (packet.materialLocation != lastLocation || packet.materialValue != lastValue))
+		{
+			glUniform1f(packet.materialLocation, packet.materialValue);
+			lastLocation = packet.materialLocation;
+			lastValue = packet.materialValue;
+		}
+		glState.BindVertexArray(packet.vao);
+		glDrawElementsInstanced(GL_TRIANGLES, packet.indexCount, packet.indexType, (void*)packet.indexOffset, packet.instanceCount);
+	}
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glad/glad.h>
+
+//passes in submission order, the pass is the most significant part of the sort key
+enum RenderPass
+{
+	RENDER_PASS_SHADOW = 0,
+	RENDER_PASS_OPAQUE = 1
+};
+
+//texture units a packet binds, 0 holds the diffuse texture and 1 the shadow maps
+const unsigned int PACKET_TEXTURE_UNITS = 2;
+
+//everything one instanced indexed draw needs, uniforms shared by all draws of a program are set before Flush
+struct DrawPacket
+{
+	unsigned int program = 0;
+	unsigned int vao = 0;
+	//target 0 leaves the unit untouched
+	GLenum textureTargets[PACKET_TEXTURE_UNITS] = {};
+	unsigned int textures[PACKET_TEXTURE_UNITS] = {};
+	//float uniform which differs between draws of one program, skipped while location is -1
+	int materialLocation = -1;
+	float materialValue = 0.0f;
+
+	unsigned int indexCount = 0;
+	GLenum indexType = GL_UNSIGNED_SHORT;
+	size_t indexOffset = 0;
+	unsigned int instanceCount = 1;
+};
+
+//bits of the sort key from the top: pass 4, program 10, diffuse texture 16, vertex array 10, depth 24
+//names wider than their field alias and only cost grouping, never correctness
+uint64_t MakeSortKey(unsigned int pass, unsigned int program, unsigned int texture, unsigned int vao, float depth);
+
+//LSD radix sort of order by keys, 8 bit digits, digits equal in every key are skipped
+void RadixSortKeys(const std::vector<uint64_t> &keys, std::vector<uint32_t> &order, std::vector<uint32_t> &scratch);
+
+//draws collected over a pass, sorted so consecutive packets share program, textures and vertex array
+//sorting needs no GL, so it runs on the recording thread and only DrawPackets runs on the render thread
+class RenderQueue
+{
+public:
+	//depth is the normalized view distance, opaque draws of equal state go front to back
+	void Submit(unsigned int pass, const DrawPacket &packet, float depth);
+	//move every packet into sorted in key order, the queue is empty afterwards
+	void Sort(std::vector<DrawPacket> &sorted);
+	unsigned int Size() const { return (unsigned int)packets.size(); }
+
+private:
+	std::vector<DrawPacket> packets;
+	std::vector<uint64_t> keys;
+	std::vector<uint32_t> order;
+	std::vector<uint32_t> scratch;
+};
+
+//issue packets in order through the GL state cache, which drops the binds consecutive packets have in common
+void DrawPackets(const std::vector<DrawPacket> &packets);
@@ -0,0 +1,82 @@
+#include "RenderThread.h"
+#include "Profiler.h"
+
+void CommandList::Execute()
+{
+	for (std::function<void()> &command : commands) { command(); }
+	commands.clear();
+}
+
+void RenderThread::Start(bool runThreaded, std::function<void()> acquire, std::function<void()> release)
+{
+	threaded = runThreaded;
+	recorded = executed = 0;
+	stopping = false;
+	if (!threaded) { return; }
+
+	acquireContext = acquire;
+	releaseContext = release;
+	thread = std::thread(&RenderThread::Loop, this);
+}
+
+void RenderThread::Stop()
+{
+	if (!thread.joinable()) { return; }
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	listRecorded.notify_one();
+	thread.join();
+}
+
+CommandList &RenderThread::BeginFrame()
+{
+	//the slot is free once the list recorded FRAME_LIST_COUNT frames ago has been executed
+	ProfileScope scope("Wait for render thread", PROFILE_THREAD_SIMULATION);
+	std::unique_lock<std::mutex> lock(mutex);
+	listExecuted.wait(lock, [this] { return recorded - executed < FRAME_LIST_COUNT; });
+	return lists[recorded % FRAME_LIST_COUNT];
+}
+
+void RenderThread::EndFrame()
+{
+	if (!threaded)
+	{
+		lists[recorded % FRAME_LIST_COUNT].Execute();
+		recorded++;
+		executed++;
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		recorded++;
+	}
+	listRecorded.notify_one();
+}
+
+void RenderThread::Loop()
+{
+	acquireContext();
+	while (true)
+	{
+		CommandList *list;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			listRecorded.wait(lock, [this] { return stopping || executed != recorded; });
+			//lists handed over before Stop are still executed
+			if (executed == recorded) { break; }
+			list = &lists[executed % FRAME_LIST_COUNT];
+		}
+
+		list->Execute();
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			executed++;
+		}
+		listExecuted.notify_one();
+	}
+	releaseContext();
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+//GL work of one frame, recorded on the simulation thread and executed in order on the thread owning the context
+//commands capture the frame data they need by value, so the simulation may change it while they run
+class CommandList
+{
+public:
+	template<typename F>
+	void Record(F &&command) { commands.emplace_back(std::forward<F>(command)); }
+	//run every command, then empty the list
+	void Execute();
+	size_t Size() const { return commands.size(); }
+
+private:
+	std::vector<std::function<void()>> commands;
+};
+
+//owns the GL context while started and executes one command list per frame,
+//the simulation thread records frame N+1 into the other list while frame N is submitted
+class RenderThread
+{
+public:
+	~RenderThread() { Stop(); }
+
+	//the calling thread must release the context first, acquire and release run on the render thread
+	//without runThreaded, lists are executed on the recording thread in EndFrame and the callbacks are not used
+	void Start(bool runThreaded, std::function<void()> acquire, std::function<void()> release);
+	//execute every handed over list, then stop the thread, which releases the context
+	void Stop();
+
+	//list to record the next frame into, waits while the render thread still executes it
+	CommandList &BeginFrame();
+	//hand the recorded list over to the render thread
+	void EndFrame();
+
+private:
+	void Loop();
+
+	static const unsigned int FRAME_LIST_COUNT = 2;
+	CommandList lists[FRAME_LIST_COUNT];
+	//lists handed over and lists executed since Start, list i lives in slot i % FRAME_LIST_COUNT
+	unsigned int recorded = 0;
+	unsigned int executed = 0;
+
+	bool threaded = false;
+	std::function<void()> acquireContext;
+	std::function<void()> releaseContext;
+	std::thread thread;
+	std::mutex mutex;
+	std::condition_variable listRecorded;
+	std::condition_variable listExecuted;
+	bool stopping = false;
+};
@@ -0,0 +1,364 @@
+#include "Shader.h"
+#include "UniformBuffer.h"
+#include "MappedFile.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+//programs by their stage files and defines, identical requests share one program
+static std::unordered_map<std::string, ShaderProgram> sharedPrograms;
+
+//requested program waiting for CompileShaderPrograms
+struct PendingProgram
+{
+	std::string key;
+	std::string paths[3];
+	std::string code[3];
+	uint64_t hash;
+	unsigned int shaders[3];
+	unsigned int id;
+};
+static std::vector<PendingProgram> pendingPrograms;
+
+static const GLenum SHADER_STAGES[3] = { GL_VERTEX_SHADER, GL_FRAGMENT_SHADER, GL_GEOMETRY_SHADER };
+static const char *SHADER_STAGE_NAMES[3] = { "VERTEX", "FRAGMENT", "GEOMETRY" };
+
+//program binaries are stored per hash of sources and driver
+static const char SHADER_CACHE_DIRECTORY[] = "ShaderCache";
+
+struct ProgramBinaryHeader
+{
+	char magic[4];
+	unsigned int format;
+	unsigned int length;
+	unsigned long long hash;
+};
+
+void ShaderProgram::Reflect()
+{
+	uniforms.clear();
+	uniformBlocks.clear();
+
+	int count = 0, maxLength = 0;
+	glGetProgramiv(id, GL_ACTIVE_UNIFORMS, &count);
+	glGetProgramiv(id, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+	std::string name(maxLength > 0 ? maxLength : 1, '\0');
+
+	for (int i = 0; i < count; i++)
+	{
+		int length = 0, size = 0;
+		GLenum type;
+		glGetActiveUniform(id, i, maxLength, &length, &size, &type, &name[0]);
+		std::string uniformName = name.substr(0, length);
+
+		//members of uniform blocks have no location, they are written through buffers
+		int location = glGetUniformLocation(id, uniformName.c_str());
+		if (location < 0) { continue; }
+
+		UniformInfo info = { location, type, size };
+		uniforms[uniformName] = info;
+
+		//arrays are reported as "name[0]", also make them reachable by their plain name
+		size_t bracket = uniformName.rfind("[0]");
+		if (bracket != std::string::npos && bracket + 3 == uniformName.size())
+		{
+			uniforms[uniformName.substr(0, bracket)] = info;
+		}
+	}
+
+	glGetProgramiv(id, GL_ACTIVE_UNIFORM_BLOCKS, &count);
+	glGetProgramiv(id, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &maxLength);
+	name.assign(maxLength > 0 ? maxLength : 1, '\0');
+
+	for (int i = 0; i < count; i++)
+	{
+		int length = 0;
+		glGetActiveUniformBlockName(id, i, maxLength, &length, &name[0]);
+		uniformBlocks[name.substr(0, length)] = i;
+	}
+}
+
+int ShaderProgram::GetUniformBlock(const std::string &name) const
+{
+	auto it = uniformBlocks.find(name);
+	return it == uniformBlocks.end() ? -1 : (int)it->second;
+}
+
+bool UniformTypeMatches(GLenum type, const float *) { return type == GL_FLOAT; }
+bool UniformTypeMatches(GLenum type, const glm::vec2 *) { return type == GL_FLOAT_VEC2; }
+bool UniformTypeMatches(GLenum type, const glm::vec3 *) { return type == GL_FLOAT_VEC3; }
+bool UniformTypeMatches(GLenum type, const glm::vec4 *) { return type == GL_FLOAT_VEC4; }
+bool UniformTypeMatches(GLenum type, const glm::mat4 *) { return type == GL_FLOAT_MAT4; }
+
+bool UniformTypeMatches(GLenum type, const int *)
+{
+	//samplers are set through integer texture unit
+	switch (type)
+	{
+	case GL_INT:
+	case GL_BOOL:
+	case GL_SAMPLER_2D:
+	case GL_SAMPLER_2D_ARRAY:
+	case GL_SAMPLER_2D_SHADOW:
+	case GL_SAMPLER_2D_ARRAY_SHADOW:
+	case GL_SAMPLER_CUBE:
+	case GL_SAMPLER_BUFFER:
+	case GL_INT_SAMPLER_BUFFER:
+	case GL_UNSIGNED_INT_SAMPLER_BUFFER:
+		return true;
+	default:
+		return false;
+	}
+}
+
+static bool ProgramBinariesSupported()
+{
+	if (!GLAD_GL_VERSION_4_1 && !GLAD_GL_ARB_get_program_binary) { return false; }
+	int formats = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+	return formats > 0;
+}
+
+//hash of every stage source and the driver, a driver update or edited shader gets a new cache entry
+//defines are part of the source text at this point, so every permutation has its own entry
+static uint64_t HashProgramSources(const std::string *code)
+{
+	uint64_t hash = FNV_OFFSET_BASIS;
+	const GLenum driverStrings[] = { GL_VENDOR, GL_RENDERER, GL_VERSION };
+	for (GLenum name : driverStrings)
+	{
+		const char *value = (const char *)glGetString(name);
+		if (value) { hash = HashBytes(value, strlen(value) + 1, hash); }
+	}
+	//stage sizes are hashed too so moving text between stages changes the key
+	for (int stage = 0; stage < 3; stage++)
+	{
+		size_t size = code[stage].size();
+		hash = HashBytes(&size, sizeof(size), hash);
+		hash = HashBytes(code[stage].data(), size, hash);
+	}
+	return hash;
+}
+
+static std::string ProgramBinaryPath(uint64_t hash)
+{
+	char name[32];
+	snprintf(name, sizeof(name), "/%016llx.bin", (unsigned long long)hash);
+	return SHADER_CACHE_DIRECTORY + std::string(name);
+}
+
+//program linked from cached binary, 0 when there is no entry or the driver rejects it
+static unsigned int LoadProgramBinary(uint64_t hash)
+{
+	MappedFile file;
+	if (!file.Open(ProgramBinaryPath(hash)) || file.Size() < sizeof(ProgramBinaryHeader)) { return 0; }
+
+	const ProgramBinaryHeader *header = (const ProgramBinaryHeader *)file.Data();
+	if (memcmp(header->magic, "GPRB", 4) != 0 || header->hash != hash || header->length != file.Size() - sizeof(ProgramBinaryHeader))
+	{
+		std::cout << "ERROR: SHADER CACHE ENTRY IS CORRUPT: " << ProgramBinaryPath(hash) << std::endl;
+		return 0;
+	}
+
+	unsigned int program = glCreateProgram();
+	glProgramBinary(program, header->format, file.Data() + sizeof(ProgramBinaryHeader), header->length);
+	int success = 0;
+	glGetProgramiv(program, GL_LINK_STATUS, &success);
+	if (!success)
+	{
+		//binary of another driver version, recompiled from source and overwritten
+		glDeleteProgram(program);
+		return 0;
+	}
+	return program;
+}
+
+static void SaveProgramBinary(unsigned int program, uint64_t hash)
+{
+	int length = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0) { return; }
+
+	ProgramBinaryHeader header;
+	memcpy(header.magic, "GPRB", 4);
+	header.hash = hash;
+	std::vector<char> binary(length);
+	GLenum format = 0;
+	glGetProgramBinary(program, length, &length, &format, binary.data());
+	header.format = format;
+	header.length = (unsigned int)length;
+
+	MakeDirectory(SHADER_CACHE_DIRECTORY);
+	std::ofstream file(ProgramBinaryPath(hash), std::ios::binary);
+	file.write((const char *)&header, sizeof(header));
+	file.write(binary.data(), length);
+}
+
+static bool ReadShaderFile(const std::string &path, std::string &code)
+{
+	std::ifstream file;
+	file.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+	try
+	{
+		file.open(path);
+		std::stringstream stream;
+		stream << file.rdbuf();
+		file.close();
+		code = stream.str();
+	}
+	catch (std::ifstream::failure &e)
+	{
+		std::cout << "ERROR: shader file failed to read: " << path << std::endl;
+		return false;
+	}
+	return true;
+}
+
+//defines go right after the #version line, #line keeps compiler messages pointing at the file's own lines
+static std::string InjectDefines(const std::string &code, const ShaderDefines &defines)
+{
+	if (defines.empty()) { return code; }
+
+	std::string block;
+	for (const auto &define : defines) { block += "#define " + define.first + " " + define.second + "\n"; }
+
+	size_t version = code.find("#version");
+	if (version == std::string::npos) { return block + "#line 1\n" + code; }
+	size_t lineEnd = code.find('\n', version);
+	if (lineEnd == std::string::npos) { return code + "\n" + block; }
+	return code.substr(0, lineEnd + 1) + block + "#line 2\n" + code.substr(lineEnd + 1);
+}
+
+const ShaderProgram *RequestShaderProgram(const char *vertexFilePath, const char *fragmentFilePath, const char *geometryFilePath, const ShaderDefines &defines)
+{
+	std::string key = std::string(vertexFilePath) + "|" + fragmentFilePath + "|" + (geometryFilePath ? geometryFilePath : "");
+	for (const auto &define : defines) { key += "|" + define.first + "=" + define.second; }
+
+	auto shared = sharedPrograms.find(key);
+	if (shared != sharedPrograms.end()) { return &shared->second; }
+
+	PendingProgram pending;
+	pending.key = key;
+	pending.paths[0] = vertexFilePath;
+	pending.paths[1] = fragmentFilePath;
+	pending.paths[2] = geometryFilePath ? geometryFilePath : "";
+	for (int stage = 0; stage < 3; stage++)
+	{
+		pending.shaders[stage] = 0;
+		if (pending.paths[stage].empty()) { continue; }
+		std::string code;
+		ReadShaderFile(pending.paths[stage], code);
+		pending.code[stage] = InjectDefines(code, defines);
+	}
+	pending.hash = HashProgramSources(pending.code);
+	pending.id = 0;
+	pendingPrograms.push_back(pending);
+
+	return &sharedPrograms[key];
+}
+
+void CompileShaderPrograms()
+{
+	if (pendingPrograms.empty()) { return; }
+
+	//let the driver compile on its own threads, status queries below wait for them
+	//needs a glad loader generated with KHR_parallel_shader_compile, without it compiles just run one after another
+#ifdef GL_KHR_parallel_shader_compile
+	static bool parallelCompileEnabled = false;
+	if (!parallelCompileEnabled && GLAD_GL_KHR_parallel_shader_compile)
+	{
+		glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+		parallelCompileEnabled = true;
+	}
+#endif
+
+	//use cached binaries where the driver still accepts them
+	bool useCache = ProgramBinariesSupported();
+	if (useCache)
+	{
+		for (PendingProgram &pending : pendingPrograms) { pending.id = LoadProgramBinary(pending.hash); }
+	}
+
+	//issue every compile and link before the first status query so they can run side by side
+	for (PendingProgram &pending : pendingPrograms)
+	{
+		if (pending.id != 0) { continue; }
+		for (int stage = 0; stage < 3; stage++)
+		{
+			if (pending.paths[stage].empty()) { continue; }
+			const char *source = pending.code[stage].c_str();
+			pending.shaders[stage] = glCreateShader(SHADER_STAGES[stage]);
+			glShaderSource(pending.shaders[stage], 1, &source, NULL);
+			glCompileShader(pending.shaders[stage]);
+		}
+	}
+	for (PendingProgram &pending : pendingPrograms)
+	{
+		if (pending.id != 0) { continue; }
+		pending.id = glCreateProgram();
+		for (int stage = 0; stage < 3; stage++)
+		{
+			if (pending.shaders[stage] != 0) { glAttachShader(pending.id, pending.shaders[stage]); }
+		}
+		if (useCache) { glProgramParameteri(pending.id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE); }
+		glLinkProgram(pending.id);
+	}
+
+	int success;
+	char infoLog[512];
+	for (PendingProgram &pending : pendingPrograms)
+	{
+		bool compiled = pending.shaders[0] != 0;
+		for (int stage = 0; stage < 3; stage++)
+		{
+			if (pending.shaders[stage] == 0) { continue; }
+			glGetShaderiv(pending.shaders[stage], GL_COMPILE_STATUS, &success);
+			if (!success)
+			{
+				//if shader failed to compile then pop up error message in console
+				glGetShaderInfoLog(pending.shaders[stage], 512, NULL, infoLog);
+				std::cout << "ERROR: " << SHADER_STAGE_NAMES[stage] << " SHADER FAILED TO COMPILE: " << pending.paths[stage] << "\n" << infoLog << std::endl;
+			}
+			glDeleteShader(pending.shaders[stage]);
+		}
+
+		if (compiled)
+		{
+			glGetProgramiv(pending.id, GL_LINK_STATUS, &success);
+			if (!success)
+			{
+				//if shader program failed to link shaders then pop up error message in console
+				glGetProgramInfoLog(pending.id, 512, NULL, infoLog);
+				std::cout << "ERROR: SHADER PROGRAM FAILED TO LINK: " << infoLog << std::endl;
+				glDeleteProgram(pending.id);
+				pending.id = 0;
+			}
+			else if (useCache)
+			{
+				SaveProgramBinary(pending.id, pending.hash);
+			}
+		}
+
+		ShaderProgram &program = sharedPrograms[pending.key];
+		program.id = pending.id;
+		program.Reflect();
+
+		//attach uniform blocks to their shared binding points
+		for (unsigned int i = 0; i < NUMBER_OF_UNIFORM_BLOCKS; i++)
+		{
+			int block = program.GetUniformBlock(UNIFORM_BLOCK_BINDINGS[i].name);
+			if (block >= 0) { glUniformBlockBinding(program.id, block, UNIFORM_BLOCK_BINDINGS[i].binding); }
+		}
+	}
+	pendingPrograms.clear();
+}
+
+ShaderProgram CreateShaderProgram(const char *vertexFilePath, const char *fragmentFilePath, const char *geometryFilePath, const ShaderDefines &defines)
+{
+	const ShaderProgram *program = RequestShaderProgram(vertexFilePath, fragmentFilePath, geometryFilePath, defines);
+	CompileShaderPrograms();
+	return *program;
+}
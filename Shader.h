@@ -0,0 +1,93 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <iostream>
+#include <map>
+#include <string>
+#include <unordered_map>
+
+#include <glm/glm.hpp>
+
+#include "GLStateCache.h"
+
+//typed handle of an active uniform, resolved once after the program is linked
+//location stays -1 when the uniform is inactive or of different type, setting it is then a no-op like in GL
+template<typename T>
+struct Uniform
+{
+	int location = -1;
+	int size = 0;
+};
+
+struct UniformInfo
+{
+	int location;
+	GLenum type;
+	int size;
+};
+
+class ShaderProgram
+{
+public:
+	unsigned int id = 0;
+
+	//every active uniform and uniform block, listed once at link time
+	//array uniforms are reachable both as "name" and "name[0]"
+	std::unordered_map<std::string, UniformInfo> uniforms;
+	std::unordered_map<std::string, unsigned int> uniformBlocks;
+
+	void Reflect();
+	void Use() const { glState.UseProgram(id); }
+
+	template<typename T>
+	Uniform<T> GetUniform(const std::string &name) const;
+	int GetUniformBlock(const std::string &name) const;
+};
+
+//preprocessor defines injected after the #version line of every stage, ordered so equal sets give equal keys
+typedef std::map<std::string, std::string> ShaderDefines;
+
+//queue a program permutation, the returned program gets its id in CompileShaderPrograms
+//requests with identical stage files and defines share one program, already compiled ones are returned as is
+//linked programs are cached as driver binaries in ShaderCache/, keyed by hash of the sources and the driver
+const ShaderProgram *RequestShaderProgram(const char *vertexFilePath, const char *fragmentFilePath, const char *geometryFilePath = nullptr, const ShaderDefines &defines = ShaderDefines());
+//compile and link every queued program, all compiles are issued before any status is checked
+//so drivers with KHR_parallel_shader_compile work on them at the same time
+void CompileShaderPrograms();
+
+//request and compile a single program
+ShaderProgram CreateShaderProgram(const char *vertexFilePath, const char *fragmentFilePath, const char *geometryFilePath = nullptr, const ShaderDefines &defines = ShaderDefines());
+
+bool UniformTypeMatches(GLenum type, const float *);
+bool UniformTypeMatches(GLenum type, const int *);
+bool UniformTypeMatches(GLenum type, const glm::vec2 *);
+bool UniformTypeMatches(GLenum type, const glm::vec3 *);
+bool UniformTypeMatches(GLenum type, const glm::vec4 *);
+bool UniformTypeMatches(GLenum type, const glm::mat4 *);
+
+template<typename T>
+Uniform<T> ShaderProgram::GetUniform(const std::string &name) const
+{
+	Uniform<T> handle;
+	auto it = uniforms.find(name);
+	if (it == uniforms.end()) { return handle; }
+
+	if (!UniformTypeMatches(it->second.type, (const T *)nullptr))
+	{
+		std::cout << "ERROR: UNIFORM TYPE MISMATCH: " << name << std::endl;
+		return handle;
+	}
+	handle.location = it->second.location;
+	handle.size = it->second.size;
+	return handle;
+}
+
+//setters write to the program currently in use
+inline void SetUniform(const Uniform<float> &u, float value) { glUniform1f(u.location, value); }
+inline void SetUniform(const Uniform<int> &u, int value) { glUniform1i(u.location, value); }
+inline void SetUniform(const Uniform<glm::vec2> &u, const glm::vec2 &value) { glUniform2fv(u.location, 1, &value.x); }
+inline void SetUniform(const Uniform<glm::vec3> &u, const glm::vec3 &value) { glUniform3fv(u.location, 1, &value.x); }
+inline void SetUniform(const Uniform<glm::vec4> &u, const glm::vec4 &value) { glUniform4fv(u.location, 1, &value.x); }
+inline void SetUniform(const Uniform<glm::mat4> &u, const glm::mat4 &value) { glUniformMatrix4fv(u.location, 1, GL_FALSE, &value[0][0]); }
+inline void SetUniform(const Uniform<int> &u, const int *values, int count) { glUniform1iv(u.location, count, values); }
+inline void SetUniform(const Uniform<glm::mat4> &u, const glm::mat4 *values, int count) { glUniformMatrix4fv(u.location, count, GL_FALSE, &values[0][0][0]); }
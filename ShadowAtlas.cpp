@@ -0,0 +1,99 @@
+#include "ShadowAtlas.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+float LightRadius(float constant, float linear, float quadratic, float cutoff)
+{
+	//solve quadratic * d^2 + linear * d + constant = 1 / cutoff
+	float c = constant - 1.0f / cutoff;
+	if (quadratic <= 0.0f) { return linear > 0.0f ? -c / linear : 0.0f; }
+	return (-linear + std::sqrt(linear * linear - 4.0f * quadratic * c)) / (2.0f * quadratic);
+}
+
+float LightScreenCoverage(const glm::vec3 &position, float radius, const glm::vec3 &cameraPos, const Frustum &cameraFrustum, float fovY)
+{
+	for (int i = 0; i < 6; i++)
+	{
+		const glm::vec4 &plane = cameraFrustum.planes[i];
+		if (glm::dot(glm::vec3(plane), position) + plane.w < -radius) { return 0.0f; }
+	}
+
+	float distance = glm::length(position - cameraPos);
+	if (distance <= radius) { return radius / (distance + 1e-4f); }
+	return radius / (distance * std::tan(fovY * 0.5f));
+}
+
+unsigned int ShadowTileSize(float coverage, unsigned int maxSize)
+{
+	if (maxSize < MIN_SHADOW_TILE_SIZE) { return 0; }
+	float texels = std::min(coverage, 1.0f) * (float)maxSize;
+	//largest power of two not above maxSize, tiles must be nodes of the atlas quadtree
+	unsigned int size = MIN_SHADOW_TILE_SIZE;
+	while (size * 2 <= maxSize) { size *= 2; }
+	while (size >= MIN_SHADOW_TILE_SIZE && (float)size > texels) { size /= 2; }
+	return size >= MIN_SHADOW_TILE_SIZE ? size : 0;
+}
+
+//x from the even bits of a Z-order index, y from the odd ones
+static unsigned int MortonX(unsigned int index)
+{
+	unsigned int x = 0;
+	for (unsigned int bit = 0; bit < 16; bit++) { x |= ((index >> (2 * bit)) & 1u) << bit; }
+	return x;
+}
+
+void PackShadowAtlas(unsigned int atlasSize, const ShadowTileRequest *requests, unsigned int count, ShadowTile *tiles)
+{
+	//over budget the least important tile is halved, once every tile is at the smallest size the least important is dropped
+	std::vector<unsigned int> sizes(count);
+	uint64_t area = 0;
+	for (unsigned int i = 0; i < count; i++)
+	{
+		sizes[i] = requests[i].size >= MIN_SHADOW_TILE_SIZE ? std::min(requests[i].size, atlasSize) : 0;
+		//a tile of any other size would not cover a whole number of Z-order cells and overlap the next one
+		assert((sizes[i] & (sizes[i] - 1)) == 0);
+		area += (uint64_t)sizes[i] * sizes[i];
+	}
+	while (area > (uint64_t)atlasSize * atlasSize)
+	{
+		int shrink = -1, drop = -1;
+		for (unsigned int i = 0; i < count; i++)
+		{
+			if (sizes[i] > MIN_SHADOW_TILE_SIZE && (shrink < 0 || requests[i].importance < requests[shrink].importance)) { shrink = i; }
+			if (sizes[i] != 0 && (drop < 0 || requests[i].importance < requests[drop].importance)) { drop = i; }
+		}
+		unsigned int index = shrink >= 0 ? shrink : drop;
+		area -= (uint64_t)sizes[index] * sizes[index];
+		sizes[index] = shrink >= 0 ? sizes[index] / 2 : 0;
+		area += (uint64_t)sizes[index] * sizes[index];
+	}
+
+	std::vector<unsigned int> order(count);
+	for (unsigned int i = 0; i < count; i++) { order[i] = i; }
+	std::stable_sort(order.begin(), order.end(), [&sizes, requests](unsigned int a, unsigned int b)
+	{
+		if (sizes[a] != sizes[b]) { return sizes[a] > sizes[b]; }
+		return requests[a].importance > requests[b].importance;
+	});
+
+	//atlas is covered in cells of the smallest tile, a tile of size s takes (s / MIN_SHADOW_TILE_SIZE)^2 consecutive cells
+	//of the Z-order curve; sizes descend, so every tile starts on a multiple of its own cell count and the tiles fit
+	//as long as their area does
+	unsigned int usedCells = 0;
+	for (unsigned int i = 0; i < count; i++)
+	{
+		ShadowTile &tile = tiles[order[i]];
+		tile = ShadowTile();
+		unsigned int size = sizes[order[i]];
+		if (size == 0) { continue; }
+
+		tile.x = MortonX(usedCells) * MIN_SHADOW_TILE_SIZE;
+		tile.y = MortonX(usedCells >> 1) * MIN_SHADOW_TILE_SIZE;
+		tile.size = size;
+		usedCells += (size / MIN_SHADOW_TILE_SIZE) * (size / MIN_SHADOW_TILE_SIZE);
+	}
+}
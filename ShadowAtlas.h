@@ -0,0 +1,37 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include "FrustumCuller.h"
+
+//smallest tile a shadow gets, less important shadows are dropped instead of shrunk below it
+const unsigned int MIN_SHADOW_TILE_SIZE = 64;
+
+//square region of the atlas in texels, size 0 when the shadow did not get a tile
+struct ShadowTile
+{
+	unsigned int x = 0, y = 0, size = 0;
+
+	bool operator==(const ShadowTile &other) const { return x == other.x && y == other.y && size == other.size; }
+	bool operator!=(const ShadowTile &other) const { return !(*this == other); }
+};
+
+//tile a shadow asks for, importance decides which ones shrink or drop first when the atlas is full
+struct ShadowTileRequest
+{
+	unsigned int size;
+	float importance;
+};
+
+//distance at which a light with these attenuation terms falls to cutoff of its full intensity
+float LightRadius(float constant, float linear, float quadratic, float cutoff);
+//projected radius of the sphere a light reaches over half the screen height, above 1 when the light covers
+//the whole screen; 0 when the sphere is outside of the camera frustum
+float LightScreenCoverage(const glm::vec3 &position, float radius, const glm::vec3 &cameraPos, const Frustum &cameraFrustum, float fovY);
+//largest power of two tile up to maxSize which matches the coverage, 0 when it would be below MIN_SHADOW_TILE_SIZE
+unsigned int ShadowTileSize(float coverage, unsigned int maxSize);
+
+//pack power of two tiles into a square power of two atlas as a quadtree: while the requests take more area than
+//the atlas has, the least important one is halved (dropped once all are at MIN_SHADOW_TILE_SIZE), then tiles are placed
+//largest first along the Z-order curve, so every tile lands on a node of its own size and no space is lost between them
+void PackShadowAtlas(unsigned int atlasSize, const ShadowTileRequest *requests, unsigned int count, ShadowTile *tiles);
@@ -0,0 +1,78 @@
+#include "ShadowCache.h"
+
+bool BoxIntersectsFrustum(const glm::mat4 &viewProjection, const glm::mat4 &model, const glm::vec3 &boundsMin, const glm::vec3 &boundsMax)
+{
+	glm::mat4 mvp = viewProjection * model;
+
+	//count corners outside of each clip plane, box is culled when all 8 corners are outside of one plane
+	int outside[6] = { 0, 0, 0, 0, 0, 0 };
+	for (int i = 0; i < 8; i++)
+	{
+		glm::vec4 corner((i & 1) ? boundsMax.x : boundsMin.x, (i & 2) ? boundsMax.y : boundsMin.y, (i & 4) ? boundsMax.z : boundsMin.z, 1.0f);
+		glm::vec4 clip = mvp * corner;
+		if (clip.x < -clip.w) { outside[0]++; }
+		if (clip.x >  clip.w) { outside[1]++; }
+		if (clip.y < -clip.w) { outside[2]++; }
+		if (clip.y >  clip.w) { outside[3]++; }
+		if (clip.z < -clip.w) { outside[4]++; }
+		if (clip.z >  clip.w) { outside[5]++; }
+	}
+	for (int i = 0; i < 6; i++)
+	{
+		if (outside[i] == 8) { return false; }
+	}
+	return true;
+}
+
+unsigned int ShadowCache::Update(const glm::mat4 *lightSpaceMatrix, unsigned int lightCount, const std::vector<ShadowCaster> &casters)
+{
+	if (lights.size() != lightCount) { lights.assign(lightCount, LightState()); }
+
+	unsigned int dirtyMask = 0;
+	for (unsigned int i = 0; i < lightCount; i++)
+	{
+		LightState &light = lights[i];
+		bool dirty = !light.valid || light.lightSpaceMatrix != lightSpaceMatrix[i];
+
+		for (size_t c = 0; c < casters.size() && !dirty; c++)
+		{
+			const ShadowCaster &caster = casters[c];
+			if (c >= light.casters.size())
+			{
+				//new caster only matters when it reaches into the light frustum
+				dirty = BoxIntersectsFrustum(lightSpaceMatrix[i], glm::mat4(), caster.boundsMin, caster.boundsMax);
+				continue;
+			}
+
+			const CasterState &last = light.casters[c];
+			if (last.instanceVersion != caster.instanceVersion || last.geometryVersion != caster.geometryVersion)
+			{
+				//moving into or out of the frustum both change the shadow map
+				dirty = BoxIntersectsFrustum(lightSpaceMatrix[i], glm::mat4(), last.boundsMin, last.boundsMax)
+					|| BoxIntersectsFrustum(lightSpaceMatrix[i], glm::mat4(), caster.boundsMin, caster.boundsMax);
+			}
+		}
+		//removed casters might have been visible, re-render conservatively
+		if (light.casters.size() > casters.size()) { dirty = true; }
+
+		//remember casters even when clean so changes outside the frustum are not compared again
+		light.casters.resize(casters.size());
+		for (size_t c = 0; c < casters.size(); c++)
+		{
+			light.casters[c].boundsMin = casters[c].boundsMin;
+			light.casters[c].boundsMax = casters[c].boundsMax;
+			light.casters[c].geometryVersion = casters[c].geometryVersion;
+			light.casters[c].instanceVersion = casters[c].instanceVersion;
+		}
+		light.lightSpaceMatrix = lightSpaceMatrix[i];
+		light.valid = true;
+
+		if (dirty) { dirtyMask |= 1u << i; }
+	}
+	return dirtyMask;
+}
+
+void ShadowCache::Invalidate()
+{
+	for (LightState &light : lights) { light.valid = false; }
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "InstanceBuffer.h"
+#include "Mesh.h"
+
+//instanced mesh which is drawn into shadow maps, visible instances are culled per pass into the buffer attached to the mesh
+struct ShadowCaster
+{
+	//world space box around every instance
+	glm::vec3 boundsMin;
+	glm::vec3 boundsMax;
+	//increased whenever vertex data of the caster changes
+	unsigned int geometryVersion;
+	//increased whenever instance transforms change
+	unsigned int instanceVersion;
+
+	const Mesh *mesh;
+	const InstanceSet *instances;
+	InstanceBuffer *visibleInstances;
+};
+
+//decides which shadow maps must be re-rendered, a map stays valid until its light moves,
+//its projection changes or a caster inside its frustum changes instances or geometry
+//instances of a caster are tracked as one box, moving any of them re-renders every map the box reaches
+class ShadowCache
+{
+public:
+	//returns bit mask of lights whose shadow map is dirty this frame
+	unsigned int Update(const glm::mat4 *lightSpaceMatrix, unsigned int lightCount, const std::vector<ShadowCaster> &casters);
+	//force every shadow map to re-render, e.g. after depth textures were recreated
+	void Invalidate();
+
+private:
+	struct CasterState
+	{
+		glm::vec3 boundsMin;
+		glm::vec3 boundsMax;
+		unsigned int geometryVersion;
+		unsigned int instanceVersion;
+	};
+	struct LightState
+	{
+		bool valid = false;
+		glm::mat4 lightSpaceMatrix;
+		std::vector<CasterState> casters;
+	};
+	std::vector<LightState> lights;
+};
+
+//true when box transformed by model touches clip volume of viewProjection
+bool BoxIntersectsFrustum(const glm::mat4 &viewProjection, const glm::mat4 &model, const glm::vec3 &boundsMin, const glm::vec3 &boundsMax);
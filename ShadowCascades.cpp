@@ -0,0 +1,52 @@
+#include "ShadowCascades.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <cmath>
+
+void ComputeCascadeSplits(float nearPlane, float shadowDistance, unsigned int cascadeCount, float lambda, float *cascadeFar)
+{
+	for (unsigned int i = 1; i <= cascadeCount; i++)
+	{
+		float t = (float)i / (float)cascadeCount;
+		float logarithmic = nearPlane * std::pow(shadowDistance / nearPlane, t);
+		float uniform = nearPlane + (shadowDistance - nearPlane) * t;
+		cascadeFar[i - 1] = lambda * logarithmic + (1.0f - lambda) * uniform;
+	}
+}
+
+glm::mat4 FitCascade(const glm::vec3 &lampPosition, const glm::mat4 &view, float fovY, float aspect, float sliceNear, float sliceFar, unsigned int resolution)
+{
+	//corners of the slice in world space and the sphere around them
+	glm::mat4 cameraToWorld = glm::inverse(view);
+	float tanHalfFov = std::tan(fovY * 0.5f);
+	glm::vec3 corners[8];
+	glm::vec3 center(0.0f);
+	for (int i = 0; i < 8; i++)
+	{
+		float depth = (i & 4) ? sliceFar : sliceNear;
+		float x = ((i & 1) ? 1.0f : -1.0f) * depth * tanHalfFov * aspect;
+		float y = ((i & 2) ? 1.0f : -1.0f) * depth * tanHalfFov;
+		corners[i] = glm::vec3(cameraToWorld * glm::vec4(x, y, -depth, 1.0f));
+		center += corners[i] * 0.125f;
+	}
+	float radius = 0.0f;
+	for (int i = 0; i < 8; i++) { radius = std::max(radius, glm::length(corners[i] - center)); }
+	//rounded up, float noise in the corners would otherwise change the extent every frame
+	radius = std::ceil(radius * 16.0f) / 16.0f;
+
+	//lamps shine at the origin as before, the up vector only has to differ from that direction
+	glm::vec3 direction = glm::normalize(-lampPosition);
+	glm::vec3 up = std::fabs(direction.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+	glm::mat4 lightView = glm::lookAt(lampPosition, glm::vec3(0.0f), up);
+
+	glm::vec3 lightCenter = glm::vec3(lightView * glm::vec4(center, 1.0f));
+	float texel = 2.0f * radius / (float)resolution;
+	lightCenter.x = std::floor(lightCenter.x / texel) * texel;
+	lightCenter.y = std::floor(lightCenter.y / texel) * texel;
+	//far plane in whole units for the same reason
+	float farPlane = std::max(std::ceil(-lightCenter.z + radius), CASCADE_NEAR_PLANE + 1.0f);
+
+	glm::mat4 lightProjection = glm::ortho(lightCenter.x - radius, lightCenter.x + radius, lightCenter.y - radius, lightCenter.y + radius, CASCADE_NEAR_PLANE, farPlane);
+	return lightProjection * lightView;
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+//the object shader reads the split depths of all cascades from one vec4
+const unsigned int MAX_SHADOW_CASCADES = 4;
+//near plane of every light projection, depth starts at the lamp so casters between it and a slice are kept
+const float CASCADE_NEAR_PLANE = 0.1f;
+
+//view depths where the cascades end, blend of logarithmic splits, which follow the texel density
+//of the perspective projection, and uniform splits; lambda 1 is fully logarithmic
+void ComputeCascadeSplits(float nearPlane, float shadowDistance, unsigned int cascadeCount, float lambda, float *cascadeFar);
+
+//orthographic light space matrix of a lamp looking at the origin, fitted around the slice of the camera frustum
+//between sliceNear and sliceFar; the slice is bounded by a sphere so the extent stays the same while the camera turns,
+//and the center is snapped to whole texels of a map of resolution texels so shadow edges do not shimmer
+glm::mat4 FitCascade(const glm::vec3 &lampPosition, const glm::mat4 &view, float fovY, float aspect, float sliceNear, float sliceFar, unsigned int resolution);
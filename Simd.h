@@ -0,0 +1,9 @@
+#pragma once
+
+//SSE is part of every x64 target and of x86 builds with /arch:SSE or higher
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define USE_SSE 1
+#include <xmmintrin.h>
+#else
+#define USE_SSE 0
+#endif
@@ -0,0 +1,496 @@
+#include "TextRenderer.h"
+#include "GLStateCache.h"
+
+#include <glad/glad.h>
+#include <iostream>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <cstring>
+#include <cstddef>
+#include <cstdint>
+#include <cmath>
+
+#include <ft2build.h>
+#include FT_FREETYPE_H
+#include FT_MODULE_H
+
+#include <glm/gtc/matrix_transform.hpp>
+
+//freetype 2.11 added a signed distance field renderer, older versions get a CPU distance transform
+#if FREETYPE_MAJOR > 2 || (FREETYPE_MAJOR == 2 && FREETYPE_MINOR >= 11)
+#define FREETYPE_HAS_SDF 1
+#else
+#define FREETYPE_HAS_SDF 0
+#endif
+
+//glyphs are rasterized once at SDF_PIXEL_SIZE, scale of RenderText stays relative to 48px text
+const int SDF_PIXEL_SIZE = 32;
+const float TEXT_REFERENCE_SIZE = 48.0f;
+//distance in pixels covered by the field on either side of the outline
+const int SDF_SPREAD = 4;
+
+//atlas is a texture array, every layer is one page packed with shelves
+//the whole budget is allocated once, pages are recycled least recently used first
+const int ATLAS_PAGE_SIZE = 512;
+const int ATLAS_MEMORY_BUDGET = 1024 * 1024;
+const int ATLAS_PAGE_COUNT = ATLAS_MEMORY_BUDGET / (ATLAS_PAGE_SIZE * ATLAS_PAGE_SIZE);
+static_assert(ATLAS_PAGE_COUNT >= 1 && ATLAS_PAGE_COUNT <= 32, "pages of a string are tracked in a 32 bit mask");
+
+struct Glyph
+{
+	glm::ivec2 size;
+	glm::ivec2 bearing;
+	float advance;
+	//page index and normalized corners of the glyph in that page, page is -1 for empty glyphs like space
+	int page;
+	glm::vec2 uvMin;
+	glm::vec2 uvMax;
+};
+
+struct AtlasPage
+{
+	int penX, penY, rowHeight;
+	unsigned int lastUsedFrame;
+	//keys of glyphs living in this page, dropped from the cache when page is evicted
+	std::vector<uint64_t> glyphs;
+};
+
+struct TextVertex
+{
+	float x, y, u, v;
+	float page;
+	unsigned char r, g, b, a;
+};
+
+//text queued by one RenderText call, vertices are reused while nothing changed since last frame
+struct TextEntry
+{
+	std::string text;
+	std::string font;
+	float x, y, scale;
+	glm::vec3 color;
+	//pages referenced by vertices and eviction count they were built against
+	unsigned int pageMask;
+	unsigned int evictions;
+	std::vector<TextVertex> vertices;
+};
+
+static FT_Library ft = nullptr;
+static std::vector<std::string> faceNames;
+static std::vector<FT_Face> faces;
+static std::unordered_map<uint64_t, Glyph> glyphs;
+
+static AtlasPage pages[ATLAS_PAGE_COUNT];
+static unsigned int atlasTexture = 0;
+static unsigned int atlasEvictions = 0;
+static unsigned int textFrame = 1;
+
+static unsigned int textVAO = 0, textVBO = 0;
+static size_t textVBOCapacity = 0;
+
+static std::vector<TextEntry> entries;
+static size_t entriesThisFrame = 0;
+static bool entriesChanged = true;
+static size_t uploadedVertexCount = 0;
+
+static unsigned int lastShader = 0;
+static unsigned int lastWidth = 0, lastHeight = 0;
+static Uniform<glm::mat4> projectionUniform;
+static Uniform<int> textUniform;
+
+// project and windows configuration:
+// copy freetype6.dll and zlib1.dll to system folder
+// add freetype.lib to Linkder/Input of project properties
+static void InitText()
+{
+	//freetype initialization
+	if (FT_Init_FreeType(&ft))
+	{
+		std::cout << "ERROR:FREETYPE: COULD NOT INITIALIZE FREETYPE" << std::endl;
+		ft = nullptr;
+	}
+#if FREETYPE_HAS_SDF
+	if (ft)
+	{
+		FT_Int spread = SDF_SPREAD;
+		FT_Property_Set(ft, "sdf", "spread", &spread);
+		FT_Property_Set(ft, "bsdf", "spread", &spread);
+	}
+#endif
+
+	for (int i = 0; i < ATLAS_PAGE_COUNT; i++)
+	{
+		pages[i].penX = pages[i].penY = 1;
+		pages[i].rowHeight = 0;
+		pages[i].lastUsedFrame = 0;
+	}
+
+	//storage only, glyphs are uploaded into it as they are first used
+	glGenTextures(1, &atlasTexture);
+	glState.BindTexture(0, GL_TEXTURE_2D_ARRAY, atlasTexture);
+	glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_R8, ATLAS_PAGE_SIZE, ATLAS_PAGE_SIZE, ATLAS_PAGE_COUNT, 0, GL_RED, GL_UNSIGNED_BYTE, NULL);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glState.BindTexture(0, GL_TEXTURE_2D_ARRAY, 0);
+
+	//allocate vao & vbo
+	glGenVertexArrays(1, &textVAO);
+	glGenBuffers(1, &textVBO);
+	glState.BindVertexArray(textVAO);
+	glBindBuffer(GL_ARRAY_BUFFER, textVBO);
+	glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(TextVertex), (void*)0);
+	glVertexAttribPointer(1, 1, GL_FLOAT, GL_FALSE, sizeof(TextVertex), (void*)offsetof(TextVertex, page));
+	glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(TextVertex), (void*)offsetof(TextVertex, r));
+	glEnableVertexAttribArray(0);
+	glEnableVertexAttribArray(1);
+	glEnableVertexAttribArray(2);
+	glState.BindVertexArray(0);
+}
+
+//index of face loaded from Fonts/<font>.ttf, faces which failed to load stay in the list as null
+static int FindFace(const std::string &font)
+{
+	for (size_t i = 0; i < faceNames.size(); i++)
+	{
+		if (faceNames[i] == font) { return (int)i; }
+	}
+
+	FT_Face face = nullptr;
+	if (!ft || FT_New_Face(ft, std::string("Fonts/" + font + ".ttf").c_str(), 0, &face))
+	{
+		std::cout << "ERROR:FREETYPE: COULD NOT LOAD FACE " << font << std::endl;
+		face = nullptr;
+	}
+	else
+	{
+		FT_Set_Pixel_Sizes(face, 0, SDF_PIXEL_SIZE);
+	}
+	faceNames.push_back(font);
+	faces.push_back(face);
+	return (int)faces.size() - 1;
+}
+
+//next code point of UTF-8 string, malformed sequences decode to U+FFFD
+static unsigned int DecodeUtf8(const std::string &text, size_t &i)
+{
+	unsigned char c = (unsigned char)text[i++];
+	if (c < 0x80) { return c; }
+
+	int length;
+	unsigned int codepoint;
+	if ((c & 0xE0) == 0xC0) { length = 1; codepoint = c & 0x1F; }
+	else if ((c & 0xF0) == 0xE0) { length = 2; codepoint = c & 0x0F; }
+	else if ((c & 0xF8) == 0xF0) { length = 3; codepoint = c & 0x07; }
+	else { return 0xFFFD; }
+
+	for (int n = 0; n < length; n++)
+	{
+		if (i >= text.size() || ((unsigned char)text[i] & 0xC0) != 0x80) { return 0xFFFD; }
+		codepoint = (codepoint << 6) | ((unsigned char)text[i++] & 0x3F);
+	}
+	return codepoint;
+}
+
+#if !FREETYPE_HAS_SDF
+//signed distance field of coverage bitmap, padded by SDF_SPREAD on every side
+//128 lies on the outline, larger values are inside like the output of freetype's sdf renderer
+static std::vector<unsigned char> DistanceField(const FT_Bitmap &bitmap, int &width, int &rows)
+{
+	width = bitmap.width + 2 * SDF_SPREAD;
+	rows = bitmap.rows + 2 * SDF_SPREAD;
+	auto inside = [&](int x, int y)
+	{
+		x -= SDF_SPREAD;
+		y -= SDF_SPREAD;
+		if (x < 0 || y < 0 || x >= (int)bitmap.width || y >= (int)bitmap.rows) { return false; }
+		return bitmap.buffer[y * bitmap.pitch + x] >= 128;
+	};
+
+	std::vector<unsigned char> field(width * rows);
+	for (int y = 0; y < rows; y++)
+	{
+		for (int x = 0; x < width; x++)
+		{
+			//nearest pixel of opposite state within spread
+			bool state = inside(x, y);
+			int best = SDF_SPREAD * SDF_SPREAD;
+			for (int dy = -SDF_SPREAD; dy <= SDF_SPREAD; dy++)
+			{
+				for (int dx = -SDF_SPREAD; dx <= SDF_SPREAD; dx++)
+				{
+					if (dx * dx + dy * dy < best && inside(x + dx, y + dy) != state) { best = dx * dx + dy * dy; }
+				}
+			}
+			float distance = std::sqrt((float)best) - 0.5f;
+			float value = 128.0f + (state ? distance : -distance) * 127.0f / SDF_SPREAD;
+			field[y * width + x] = (unsigned char)glm::clamp(value, 0.0f, 255.0f);
+		}
+	}
+	return field;
+}
+#endif
+
+//page which fits width x rows, evicting the least recently used page not needed in current frame
+static int AllocateInPage(int width, int rows, int &x, int &y)
+{
+	for (int i = 0; i < ATLAS_PAGE_COUNT; i++)
+	{
+		AtlasPage &page = pages[i];
+		int penX = page.penX, penY = page.penY, rowHeight = page.rowHeight;
+		if (penX + width + 1 > ATLAS_PAGE_SIZE)
+		{
+			penX = 1;
+			penY += rowHeight + 1;
+			rowHeight = 0;
+		}
+		if (penY + rows + 1 > ATLAS_PAGE_SIZE) { continue; }
+
+		x = penX;
+		y = penY;
+		page.penX = penX + width + 1;
+		page.penY = penY;
+		page.rowHeight = std::max(rowHeight, rows);
+		return i;
+	}
+
+	int victim = -1;
+	for (int i = 0; i < ATLAS_PAGE_COUNT; i++)
+	{
+		if (pages[i].lastUsedFrame == textFrame) { continue; }
+		if (victim < 0 || pages[i].lastUsedFrame < pages[victim].lastUsedFrame) { victim = i; }
+	}
+	if (victim < 0)
+	{
+		std::cout << "ERROR:TEXT: GLYPH ATLAS BUDGET EXCEEDED IN ONE FRAME" << std::endl;
+		return -1;
+	}
+
+	AtlasPage &page = pages[victim];
+	for (uint64_t key : page.glyphs) { glyphs.erase(key); }
+	page.glyphs.clear();
+	atlasEvictions++;
+
+	x = y = 1;
+	page.penX = 1 + width + 1;
+	page.penY = 1;
+	page.rowHeight = rows;
+	return victim;
+}
+
+//rasterize glyph on first use and place it in the atlas
+static const Glyph *FindGlyph(int faceIndex, unsigned int codepoint)
+{
+	uint64_t key = ((uint64_t)faceIndex << 32) | codepoint;
+	auto it = glyphs.find(key);
+	if (it != glyphs.end()) { return &it->second; }
+
+	FT_Face face = faces[faceIndex];
+	if (!face) { return nullptr; }
+
+	if (FT_Load_Char(face, codepoint, FT_LOAD_DEFAULT))
+	{
+		std::cout << "ERROR:FREETYPE: FAILED TO LOAD GLYPH" << std::endl;
+		return nullptr;
+	}
+
+	Glyph glyph;
+	glyph.advance = face->glyph->advance.x / 64.0f;
+	glyph.size = glm::ivec2(0);
+	glyph.bearing = glm::ivec2(0);
+	glyph.page = -1;
+	glyph.uvMin = glyph.uvMax = glm::vec2(0.0f);
+
+	//glyphs without outline (space) only advance the pen
+	if (face->glyph->format != FT_GLYPH_FORMAT_OUTLINE || face->glyph->outline.n_points > 0)
+	{
+		int width, rows;
+		const unsigned char *pixels;
+		int pitch;
+#if FREETYPE_HAS_SDF
+		if (FT_Render_Glyph(face->glyph, FT_RENDER_MODE_SDF))
+		{
+			std::cout << "ERROR:FREETYPE: FAILED TO RENDER GLYPH" << std::endl;
+			return nullptr;
+		}
+		width = face->glyph->bitmap.width;
+		rows = face->glyph->bitmap.rows;
+		pixels = face->glyph->bitmap.buffer;
+		pitch = face->glyph->bitmap.pitch;
+		glyph.bearing = glm::ivec2(face->glyph->bitmap_left, face->glyph->bitmap_top);
+#else
+		if (FT_Render_Glyph(face->glyph, FT_RENDER_MODE_NORMAL))
+		{
+			std::cout << "ERROR:FREETYPE: FAILED TO RENDER GLYPH" << std::endl;
+			return nullptr;
+		}
+		std::vector<unsigned char> field = DistanceField(face->glyph->bitmap, width, rows);
+		pixels = field.data();
+		pitch = width;
+		glyph.bearing = glm::ivec2(face->glyph->bitmap_left - SDF_SPREAD, face->glyph->bitmap_top + SDF_SPREAD);
+#endif
+
+		if (width > 0 && rows > 0)
+		{
+			int x, y;
+			int page = AllocateInPage(width, rows, x, y);
+			if (page < 0) { return nullptr; }
+
+			glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+			glPixelStorei(GL_UNPACK_ROW_LENGTH, pitch);
+			glState.BindTexture(0, GL_TEXTURE_2D_ARRAY, atlasTexture);
+			glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, x, y, page, width, rows, 1, GL_RED, GL_UNSIGNED_BYTE, pixels);
+			glState.BindTexture(0, GL_TEXTURE_2D_ARRAY, 0);
+			glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+			glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+			glyph.size = glm::ivec2(width, rows);
+			glyph.page = page;
+			glyph.uvMin = glm::vec2((float)x / ATLAS_PAGE_SIZE, (float)y / ATLAS_PAGE_SIZE);
+			glyph.uvMax = glm::vec2((float)(x + width) / ATLAS_PAGE_SIZE, (float)(y + rows) / ATLAS_PAGE_SIZE);
+			pages[page].glyphs.push_back(key);
+		}
+	}
+
+	return &glyphs.emplace(key, glyph).first->second;
+}
+
+static void BuildVertices(TextEntry &entry)
+{
+	entry.vertices.clear();
+	entry.pageMask = 0;
+	int faceIndex = FindFace(entry.font);
+
+	unsigned char r = (unsigned char)(glm::clamp(entry.color.x, 0.0f, 1.0f) * 255.0f);
+	unsigned char g = (unsigned char)(glm::clamp(entry.color.y, 0.0f, 1.0f) * 255.0f);
+	unsigned char b = (unsigned char)(glm::clamp(entry.color.z, 0.0f, 1.0f) * 255.0f);
+	float scale = entry.scale * TEXT_REFERENCE_SIZE / SDF_PIXEL_SIZE;
+
+	float x = entry.x;
+	size_t i = 0;
+	while (i < entry.text.size())
+	{
+		const Glyph *ch = FindGlyph(faceIndex, DecodeUtf8(entry.text, i));
+		if (!ch) { continue; }
+
+		float xpos = x + ch->bearing.x * scale;
+		float ypos = entry.y - (ch->size.y - ch->bearing.y) * scale;
+
+		float w = ch->size.x * scale;
+		float h = ch->size.y * scale;
+
+		x += ch->advance * scale;
+		if (ch->page < 0) { continue; }
+
+		float page = (float)ch->page;
+		pages[ch->page].lastUsedFrame = textFrame;
+		entry.pageMask |= 1u << ch->page;
+
+		TextVertex quad[6] =
+		{
+			{ xpos,     ypos + h,   ch->uvMin.x, ch->uvMin.y, page, r, g, b, 255 },
+			{ xpos,     ypos,       ch->uvMin.x, ch->uvMax.y, page, r, g, b, 255 },
+			{ xpos + w, ypos,       ch->uvMax.x, ch->uvMax.y, page, r, g, b, 255 },
+			{ xpos,     ypos + h,   ch->uvMin.x, ch->uvMin.y, page, r, g, b, 255 },
+			{ xpos + w, ypos,       ch->uvMax.x, ch->uvMax.y, page, r, g, b, 255 },
+			{ xpos + w, ypos + h,   ch->uvMax.x, ch->uvMin.y, page, r, g, b, 255 }
+		};
+		entry.vertices.insert(entry.vertices.end(), quad, quad + 6);
+	}
+	entry.evictions = atlasEvictions;
+}
+
+void RenderText(const std::string &text, float x, float y, float scale, const std::string &font, const glm::vec3 &color)
+{
+	if (textVAO == 0) { InitText(); }
+
+	//entries are matched by call order, so a string drawn every frame at the same place keeps its vertices
+	if (entriesThisFrame == entries.size())
+	{
+		entries.push_back(TextEntry());
+		entries.back().scale = -1.0f;
+	}
+	TextEntry &entry = entries[entriesThisFrame++];
+
+	if (entry.text != text || entry.font != font || entry.x != x || entry.y != y || entry.scale != scale || entry.color != color
+		|| entry.evictions != atlasEvictions)
+	{
+		entry.text = text;
+		entry.font = font;
+		entry.x = x;
+		entry.y = y;
+		entry.scale = scale;
+		entry.color = color;
+		BuildVertices(entry);
+		entriesChanged = true;
+	}
+	else
+	{
+		//reused vertices still keep their pages alive
+		for (int i = 0; i < ATLAS_PAGE_COUNT; i++)
+		{
+			if (entry.pageMask & (1u << i)) { pages[i].lastUsedFrame = textFrame; }
+		}
+	}
+}
+
+void FlushText(const ShaderProgram &shader, unsigned int screenWidth, unsigned int screenHeight)
+{
+	//strings queued last frame but not this frame are dropped
+	if (entriesThisFrame != entries.size())
+	{
+		entries.resize(entriesThisFrame);
+		entriesChanged = true;
+	}
+	entriesThisFrame = 0;
+	textFrame++;
+	if (textVAO == 0 || entries.empty()) { return; }
+
+	shader.Use();
+	if (shader.id != lastShader)
+	{
+		projectionUniform = shader.GetUniform<glm::mat4>("projection");
+		textUniform = shader.GetUniform<int>("text");
+		SetUniform(textUniform, 0);
+		lastShader = shader.id;
+		lastWidth = lastHeight = 0;
+	}
+	if (screenWidth != lastWidth || screenHeight != lastHeight)
+	{
+		SetUniform(projectionUniform, glm::ortho(0.0f, (float)screenWidth, 0.0f, (float)screenHeight));
+		lastWidth = screenWidth;
+		lastHeight = screenHeight;
+	}
+
+	glState.BindVertexArray(textVAO);
+	if (entriesChanged)
+	{
+		//gather vertices of every string into one stream
+		std::vector<TextVertex> stream;
+		for (const TextEntry &entry : entries) { stream.insert(stream.end(), entry.vertices.begin(), entry.vertices.end()); }
+
+		glBindBuffer(GL_ARRAY_BUFFER, textVBO);
+		size_t bytes = stream.size() * sizeof(TextVertex);
+		if (bytes > textVBOCapacity)
+		{
+			textVBOCapacity = bytes * 2;
+			glBufferData(GL_ARRAY_BUFFER, textVBOCapacity, NULL, GL_DYNAMIC_DRAW);
+		}
+		if (bytes > 0) { glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, stream.data()); }
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+		uploadedVertexCount = stream.size();
+		entriesChanged = false;
+	}
+
+	if (uploadedVertexCount > 0)
+	{
+		//overlay ignores scene depth, padded glyph quads overlap and must not reject each other either
+		glDisable(GL_DEPTH_TEST);
+		glState.BindTexture(0, GL_TEXTURE_2D_ARRAY, atlasTexture);
+		glDrawArrays(GL_TRIANGLES, 0, (GLsizei)uploadedVertexCount);
+		glEnable(GL_DEPTH_TEST);
+	}
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <string>
+
+#include <glm/glm.hpp>
+
+#include "Shader.h"
+
+//queue UTF-8 text for the current frame, every queued string is drawn by FlushText in a single draw call
+//x and y are screen space pixels of the baseline start, scale 1.0 gives 48px text
+//font names Fonts/<font>.ttf, faces and glyphs are loaded on first use and kept as distance fields
+void RenderText(const std::string &text, float x, float y, float scale, const std::string &font, const glm::vec3 &color);
+
+//upload the frame's text vertices and draw them, projection is rebuilt only when screen size changes
+void FlushText(const ShaderProgram &shader, unsigned int screenWidth, unsigned int screenHeight);
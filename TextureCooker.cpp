@@ -0,0 +1,371 @@
+#include "TextureCooker.h"
+
+#include <glad/glad.h>
+#include <stb_image.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+
+struct MipLevel
+{
+	int width, height;
+	std::vector<unsigned char> pixels;
+};
+
+std::string CookedTexturePath(const std::string &source)
+{
+	//textures of the same name in different directories share the cooked directory, the hash of the whole path tells them apart
+	std::string normalized = source;
+	std::replace(normalized.begin(), normalized.end(), '\\', '/');
+	char hash[17];
+	snprintf(hash, sizeof(hash), "%016llx", (unsigned long long)HashBytes(normalized.data(), normalized.size()));
+
+	size_t slash = normalized.find_last_of('/');
+	return std::string(COOKED_TEXTURE_DIRECTORY) + (slash == std::string::npos ? normalized : normalized.substr(slash + 1)) + "." + hash + ".gtex";
+}
+
+//64 bit FNV-1a of file content, 0 when file cannot be read
+static uint64_t HashFile(const std::string &path, uint64_t hash)
+{
+	MappedFile file;
+	if (!file.Open(path)) { return 0; }
+	return HashBytes(file.Data(), file.Size(), hash);
+}
+
+int StoredChannels(int channels)
+{
+	return channels == 1 ? 1 : 4;
+}
+
+void WidenPixels(const unsigned char *source, int pixelCount, int channels, std::vector<unsigned char> &pixels)
+{
+	int stored = StoredChannels(channels);
+	pixels.resize((size_t)pixelCount * stored);
+	for (int i = 0; i < pixelCount; i++)
+	{
+		const unsigned char *in = source + i * channels;
+		unsigned char *out = &pixels[(size_t)i * stored];
+		if (stored == 1)
+		{
+			out[0] = in[0];
+			continue;
+		}
+		//grey and alpha spreads grey over RGB, a missing alpha is opaque
+		bool grey = channels < 3;
+		out[0] = in[0];
+		out[1] = grey ? in[0] : in[1];
+		out[2] = grey ? in[0] : in[2];
+		out[3] = channels == 2 ? in[1] : (channels == 4 ? in[3] : 255);
+	}
+}
+
+bool RunCookerTests()
+{
+	struct Case
+	{
+		int channels;
+		unsigned char source[4];
+		unsigned char expected[4];
+	};
+	const Case cases[] =
+	{
+		{ 1, { 90 }, { 90 } },
+		{ 2, { 90, 40 }, { 90, 90, 90, 40 } },
+		{ 3, { 10, 20, 30 }, { 10, 20, 30, 255 } },
+		{ 4, { 10, 20, 30, 40 }, { 10, 20, 30, 40 } }
+	};
+
+	bool passed = true;
+	for (const Case &test : cases)
+	{
+		std::vector<unsigned char> pixels;
+		WidenPixels(test.source, 1, test.channels, pixels);
+		bool match = pixels.size() == (size_t)StoredChannels(test.channels) && memcmp(pixels.data(), test.expected, pixels.size()) == 0;
+		std::cout << "  " << test.channels << " channel source " << (match ? "passed" : "FAILED") << std::endl;
+		passed = passed && match;
+	}
+	std::cout << "texture cooker tests " << (passed ? "passed" : "FAILED") << std::endl;
+	return passed;
+}
+
+//half size level with 2x2 box filter, odd edges repeat their last row or column
+static MipLevel Downsample(const MipLevel &source, int channels)
+{
+	MipLevel level;
+	level.width = std::max(1, source.width / 2);
+	level.height = std::max(1, source.height / 2);
+	level.pixels.resize(level.width * level.height * channels);
+
+	for (int y = 0; y < level.height; y++)
+	{
+		int y0 = std::min(y * 2, source.height - 1), y1 = std::min(y * 2 + 1, source.height - 1);
+		for (int x = 0; x < level.width; x++)
+		{
+			int x0 = std::min(x * 2, source.width - 1), x1 = std::min(x * 2 + 1, source.width - 1);
+			for (int c = 0; c < channels; c++)
+			{
+				int sum = source.pixels[(y0 * source.width + x0) * channels + c] + source.pixels[(y0 * source.width + x1) * channels + c]
+					+ source.pixels[(y1 * source.width + x0) * channels + c] + source.pixels[(y1 * source.width + x1) * channels + c];
+				level.pixels[(y * level.width + x) * channels + c] = (unsigned char)((sum + 2) / 4);
+			}
+		}
+	}
+	return level;
+}
+
+static uint16_t PackColor565(const int *rgb)
+{
+	return (uint16_t)(((rgb[0] * 31 + 127) / 255) << 11 | ((rgb[1] * 63 + 127) / 255) << 5 | ((rgb[2] * 31 + 127) / 255));
+}
+
+static void UnpackColor565(uint16_t color, int *rgb)
+{
+	rgb[0] = ((color >> 11) & 31) * 255 / 31;
+	rgb[1] = ((color >> 5) & 63) * 255 / 63;
+	rgb[2] = (color & 31) * 255 / 31;
+}
+
+//BC1 blocks of RGBA level, endpoints are the corners of the block's color bounding box
+static std::vector<unsigned char> CompressBC1(const MipLevel &level)
+{
+	int blocksX = (level.width + 3) / 4, blocksY = (level.height + 3) / 4;
+	std::vector<unsigned char> blocks(blocksX * blocksY * 8);
+
+	for (int by = 0; by < blocksY; by++)
+	{
+		for (int bx = 0; bx < blocksX; bx++)
+		{
+			int texels[16][3];
+			int minColor[3] = { 255, 255, 255 }, maxColor[3] = { 0, 0, 0 };
+			for (int i = 0; i < 16; i++)
+			{
+				int x = std::min(bx * 4 + i % 4, level.width - 1);
+				int y = std::min(by * 4 + i / 4, level.height - 1);
+				for (int c = 0; c < 3; c++)
+				{
+					texels[i][c] = level.pixels[(y * level.width + x) * 4 + c];
+					minColor[c] = std::min(minColor[c], texels[i][c]);
+					maxColor[c] = std::max(maxColor[c], texels[i][c]);
+				}
+			}
+
+			uint16_t color0 = PackColor565(maxColor), color1 = PackColor565(minColor);
+			//color0 > color1 selects four color mode
+			if (color0 < color1) { std::swap(color0, color1); }
+
+			int palette[4][3];
+			UnpackColor565(color0, palette[0]);
+			UnpackColor565(color1, palette[1]);
+			for (int c = 0; c < 3; c++)
+			{
+				palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+				palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+			}
+
+			uint32_t indices = 0;
+			if (color0 != color1)
+			{
+				for (int i = 0; i < 16; i++)
+				{
+					int best = 0, bestDistance = 1 << 30;
+					for (int p = 0; p < 4; p++)
+					{
+						int dr = texels[i][0] - palette[p][0], dg = texels[i][1] - palette[p][1], db = texels[i][2] - palette[p][2];
+						int distance = dr * dr + dg * dg + db * db;
+						if (distance < bestDistance) { best = p; bestDistance = distance; }
+					}
+					indices |= (uint32_t)best << (i * 2);
+				}
+			}
+
+			unsigned char *block = &blocks[(by * blocksX + bx) * 8];
+			block[0] = color0 & 0xFF;
+			block[1] = color0 >> 8;
+			block[2] = color1 & 0xFF;
+			block[3] = color1 >> 8;
+			for (int i = 0; i < 4; i++) { block[4 + i] = (indices >> (i * 8)) & 0xFF; }
+		}
+	}
+	return blocks;
+}
+
+bool CookTexture(const std::vector<std::string> &sources, const std::string &output, bool compress)
+{
+	if (sources.size() != 1 && sources.size() != 6)
+	{
+		std::cout << "ERROR: TEXTURE COOKER NEEDS ONE IMAGE OR SIX CUBE MAP FACES: " << output << std::endl;
+		return false;
+	}
+
+	//every face as its full mip chain
+	std::vector<std::vector<MipLevel>> faces(sources.size());
+	int sourceChannels = 0;
+	for (size_t face = 0; face < sources.size(); face++)
+	{
+		int width, height, channels;
+		unsigned char *data = stbi_load(sources[face].c_str(), &width, &height, &channels, 0);
+		if (!data)
+		{
+			std::cout << "ERROR: TEXTURE COOKER FAILED TO LOAD: " << sources[face] << std::endl;
+			return false;
+		}
+		if (face > 0 && (width != faces[0][0].width || height != faces[0][0].height || channels != sourceChannels))
+		{
+			std::cout << "ERROR: CUBE MAP FACES DIFFER IN SIZE OR FORMAT: " << sources[face] << std::endl;
+			stbi_image_free(data);
+			return false;
+		}
+		sourceChannels = channels;
+
+		int stored = StoredChannels(channels);
+		MipLevel base;
+		base.width = width;
+		base.height = height;
+		WidenPixels(data, width * height, channels, base.pixels);
+		stbi_image_free(data);
+
+		faces[face].push_back(base);
+		while (faces[face].back().width > 1 || faces[face].back().height > 1)
+		{
+			faces[face].push_back(Downsample(faces[face].back(), stored));
+		}
+	}
+
+	bool blockCompressed = compress && sourceChannels == 3;
+	CookedTextureHeader header;
+	memcpy(header.magic, "GTEX", 4);
+	header.version = COOKED_TEXTURE_VERSION;
+	header.target = sources.size() == 6 ? GL_TEXTURE_CUBE_MAP : GL_TEXTURE_2D;
+	header.internalFormat = blockCompressed ? GL_COMPRESSED_RGB_S3TC_DXT1_EXT : (sourceChannels == 1 ? GL_R8 : GL_RGBA8);
+	header.format = blockCompressed ? 0 : (sourceChannels == 1 ? GL_RED : GL_RGBA);
+	header.width = faces[0][0].width;
+	header.height = faces[0][0].height;
+	header.faceCount = (uint32_t)faces.size();
+	header.levelCount = (uint32_t)faces[0].size();
+	header.reserved = 0;
+
+	std::vector<CookedTextureLevel> levels;
+	std::vector<std::vector<unsigned char>> payloads;
+	uint64_t offset = 0;
+	for (uint32_t face = 0; face < header.faceCount; face++)
+	{
+		for (uint32_t level = 0; level < header.levelCount; level++)
+		{
+			const MipLevel &mip = faces[face][level];
+			payloads.push_back(blockCompressed ? CompressBC1(mip) : mip.pixels);
+
+			CookedTextureLevel entry = { face, level, (uint32_t)mip.width, (uint32_t)mip.height, offset, payloads.back().size() };
+			levels.push_back(entry);
+			//levels start 16 byte aligned inside the data block
+			offset += (payloads.back().size() + 15) & ~(uint64_t)15;
+		}
+	}
+
+	std::string directory(COOKED_TEXTURE_DIRECTORY);
+	directory.pop_back();
+	MakeDirectory(directory);
+	std::ofstream file(output, std::ios::binary);
+	if (!file)
+	{
+		std::cout << "ERROR: TEXTURE COOKER FAILED TO WRITE: " << output << std::endl;
+		return false;
+	}
+	file.write((const char *)&header, sizeof(header));
+	file.write((const char *)levels.data(), levels.size() * sizeof(CookedTextureLevel));
+	//pad so the data block is 16 byte aligned from file start
+	size_t written = sizeof(header) + levels.size() * sizeof(CookedTextureLevel);
+	const char zeros[16] = {};
+	file.write(zeros, (16 - written % 16) % 16);
+	for (const std::vector<unsigned char> &payload : payloads)
+	{
+		file.write((const char *)payload.data(), payload.size());
+		file.write(zeros, (16 - payload.size() % 16) % 16);
+	}
+	return (bool)file;
+}
+
+bool CookTextures(const std::vector<std::vector<std::string>> &textures, bool compress)
+{
+	//manifest lines: <content hash> <container path>
+	std::map<std::string, std::string> manifest;
+	std::ifstream manifestIn(COOKED_TEXTURE_MANIFEST);
+	std::string hash, path;
+	while (manifestIn >> hash >> path) { manifest[path] = hash; }
+	manifestIn.close();
+
+	bool succeeded = true;
+	unsigned int cooked = 0;
+	for (const std::vector<std::string> &sources : textures)
+	{
+		//hash covers every source, the container version and the compression setting
+		uint64_t contentHash = FNV_OFFSET_BASIS ^ COOKED_TEXTURE_VERSION ^ (compress ? 0x100 : 0);
+		for (const std::string &source : sources) { contentHash = HashFile(source, contentHash); }
+
+		char hex[17];
+		snprintf(hex, sizeof(hex), "%016llx", (unsigned long long)contentHash);
+		std::string output = CookedTexturePath(sources[0]);
+
+		MappedFile existing;
+		if (manifest[output] == hex && existing.Open(output)) { continue; }
+
+		if (CookTexture(sources, output, compress))
+		{
+			manifest[output] = hex;
+			cooked++;
+		}
+		else
+		{
+			manifest.erase(output);
+			succeeded = false;
+		}
+	}
+
+	std::ofstream manifestOut(COOKED_TEXTURE_MANIFEST);
+	for (const auto &entry : manifest) { manifestOut << entry.second << " " << entry.first << "\n"; }
+
+	std::cout << "cooked " << cooked << " of " << textures.size() << " textures" << std::endl;
+	return succeeded;
+}
+
+bool ParseCookedTexture(const MappedFile &file, CookedTexture &texture)
+{
+	if (file.Size() < sizeof(CookedTextureHeader)) { return false; }
+
+	const CookedTextureHeader *header = (const CookedTextureHeader *)file.Data();
+	if (memcmp(header->magic, "GTEX", 4) != 0 || header->version != COOKED_TEXTURE_VERSION) { return false; }
+
+	//only what the cooker writes is accepted, the loader passes every level to GL without further checks
+	bool cube = header->target == GL_TEXTURE_CUBE_MAP;
+	if ((!cube && header->target != GL_TEXTURE_2D) || header->faceCount != (cube ? 6u : 1u)) { return false; }
+	if (header->width == 0 || header->height == 0 || header->levelCount == 0 || header->levelCount > 32) { return false; }
+	bool blockCompressed = header->internalFormat == GL_COMPRESSED_RGB_S3TC_DXT1_EXT && header->format == 0;
+	uint64_t texelBytes = header->internalFormat == GL_R8 && header->format == GL_RED ? 1 : (header->internalFormat == GL_RGBA8 && header->format == GL_RGBA ? 4 : 0);
+	if (!blockCompressed && texelBytes == 0) { return false; }
+
+	size_t levelCount = (size_t)header->faceCount * header->levelCount;
+	size_t tableEnd = sizeof(CookedTextureHeader) + levelCount * sizeof(CookedTextureLevel);
+	size_t dataStart = (tableEnd + 15) & ~(size_t)15;
+	if (dataStart > file.Size()) { return false; }
+	uint64_t dataSize = file.Size() - dataStart;
+
+	//levels are stored face by face, each mip chain halving down from the header size
+	const CookedTextureLevel *levels = (const CookedTextureLevel *)(file.Data() + sizeof(CookedTextureHeader));
+	for (size_t i = 0; i < levelCount; i++)
+	{
+		const CookedTextureLevel &level = levels[i];
+		if (level.face != i / header->levelCount || level.level != i % header->levelCount) { return false; }
+		uint32_t width = std::max(1u, header->width >> level.level), height = std::max(1u, header->height >> level.level);
+		if (level.width != width || level.height != height) { return false; }
+
+		uint64_t size = blockCompressed ? (uint64_t)((width + 3) / 4) * ((height + 3) / 4) * 8 : (uint64_t)width * height * texelBytes;
+		if (level.size != size || level.offset > dataSize || level.size > dataSize - level.offset) { return false; }
+	}
+
+	texture.header = header;
+	texture.levels = levels;
+	texture.data = file.Data() + dataStart;
+	return true;
+}
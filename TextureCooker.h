@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "MappedFile.h"
+
+//cooked containers and the manifest live next to the source textures
+const char COOKED_TEXTURE_DIRECTORY[] = "Textures/cooked/";
+const char COOKED_TEXTURE_MANIFEST[] = "Textures/cooked/manifest.txt";
+const uint32_t COOKED_TEXTURE_VERSION = 2;
+
+//not every glad build carries EXT_texture_compression_s3tc
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+
+//container layout: header, levelCount * faceCount level entries, then pixel data of every level
+//pixel rows are tightly packed, data of every level can be passed to glTexImage2D/glCompressedTexImage2D as is
+struct CookedTextureHeader
+{
+	char magic[4];
+	uint32_t version;
+	uint32_t target;
+	uint32_t internalFormat;
+	//pixel format of uncompressed data, 0 for block compressed data
+	uint32_t format;
+	uint32_t width;
+	uint32_t height;
+	uint32_t faceCount;
+	uint32_t levelCount;
+	//pads the header to 40 bytes, the level table after it holds 64 bit fields and must start 8 byte aligned
+	uint32_t reserved;
+};
+static_assert(sizeof(CookedTextureHeader) % 8 == 0, "level table follows the header and needs 8 byte alignment");
+
+struct CookedTextureLevel
+{
+	uint32_t face;
+	uint32_t level;
+	uint32_t width;
+	uint32_t height;
+	uint64_t offset;
+	uint64_t size;
+};
+
+//validated view into a mapped container, pixel data of a level starts at data + level.offset
+struct CookedTexture
+{
+	const CookedTextureHeader *header = nullptr;
+	const CookedTextureLevel *levels = nullptr;
+	const unsigned char *data = nullptr;
+};
+
+//container path of a texture, named after its first source file and a hash of that file's path
+std::string CookedTexturePath(const std::string &source);
+
+//decode sources (one, or six cube map faces in GL order), build mip chains and write the container
+//compress stores images without alpha as BC1, others stay uncompressed
+bool CookTexture(const std::vector<std::string> &sources, const std::string &output, bool compress);
+
+//channels a source is stored with: grey stays one channel, everything else becomes RGBA so rows stay 4 byte aligned
+int StoredChannels(int channels);
+//widen pixelCount pixels of channels each into StoredChannels(channels) per pixel,
+//grey and alpha spreads grey over RGB and keeps alpha, RGB gets opaque alpha
+void WidenPixels(const unsigned char *source, int pixelCount, int channels, std::vector<unsigned char> &pixels);
+//check WidenPixels on a pixel of every channel count and print the results, false when any differs
+bool RunCookerTests();
+
+//cook every texture whose source content hash differs from the manifest entry, returns false on any failure
+bool CookTextures(const std::vector<std::vector<std::string>> &textures, bool compress);
+
+bool ParseCookedTexture(const MappedFile &file, CookedTexture &texture);
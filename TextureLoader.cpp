@@ -0,0 +1,310 @@
+#include "TextureLoader.h"
+#include "GLStateCache.h"
+
+#include <glad/glad.h>
+#include <stb_image.h>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+//images have 1, 3 or 4 channels, two channel images are expanded to four when decoded
+static GLenum ChannelFormat(int channels)
+{
+	switch (channels)
+	{
+	case 1:
+		return GL_RED;
+	case 3:
+		return GL_RGB;
+	default:
+		return GL_RGBA;
+	}
+}
+
+static double MillisecondsSince(std::chrono::high_resolution_clock::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+void TextureLoader::Start(unsigned int workerCount)
+{
+	if (workerCount == 0) { workerCount = 1; }
+
+	//placeholders are mid grey so lit surfaces look plausible until the real texture arrives
+	unsigned char grey[] = { 128, 128, 128, 255 };
+	glGenTextures(1, &placeholder2D);
+	glState.BindTexture(0, GL_TEXTURE_2D, placeholder2D);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, grey);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+	glGenTextures(1, &placeholderCube);
+	glState.BindTexture(0, GL_TEXTURE_CUBE_MAP, placeholderCube);
+	for (int i = 0; i < 6; i++)
+	{
+		glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, grey);
+	}
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glState.BindTexture(0, GL_TEXTURE_CUBE_MAP, 0);
+
+	glGenBuffers(PBO_COUNT, pbos);
+
+	//BC1 containers are only used when the driver lists the format
+	GLint formatCount = 0;
+	glGetIntegerv(GL_NUM_COMPRESSED_TEXTURE_FORMATS, &formatCount);
+	std::vector<GLint> formats(std::max(formatCount, 1));
+	if (formatCount > 0) { glGetIntegerv(GL_COMPRESSED_TEXTURE_FORMATS, formats.data()); }
+	supportsBC1 = std::find(formats.begin(), formats.begin() + formatCount, GL_COMPRESSED_RGB_S3TC_DXT1_EXT) != formats.begin() + formatCount;
+
+	stopping = false;
+	for (unsigned int i = 0; i < workerCount; i++)
+	{
+		workers.push_back(std::thread(&TextureLoader::WorkerLoop, this));
+	}
+}
+
+void TextureLoader::Stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	jobAvailable.notify_all();
+	for (std::thread &worker : workers) { worker.join(); }
+	workers.clear();
+
+	//images decoded but never uploaded
+	for (Job &job : decoded) { stbi_image_free(job.request->images[job.image].data); }
+	jobs.clear();
+	decoded.clear();
+	pending = 0;
+
+	glDeleteBuffers(PBO_COUNT, pbos);
+}
+
+unsigned int TextureLoader::LoadTexture(const std::string &path, TextureCallback onLoaded)
+{
+	return Enqueue(GL_TEXTURE_2D, std::vector<std::string>(1, path), onLoaded);
+}
+
+unsigned int TextureLoader::LoadCubeMapTexture(const std::vector<std::string> &faces, TextureCallback onLoaded)
+{
+	return Enqueue(GL_TEXTURE_CUBE_MAP, faces, onLoaded);
+}
+
+unsigned int TextureLoader::Enqueue(unsigned int target, const std::vector<std::string> &paths, TextureCallback onLoaded)
+{
+	std::shared_ptr<Request> request = std::make_shared<Request>();
+	request->target = target;
+	request->images.resize(paths.size());
+	for (size_t i = 0; i < paths.size(); i++) { request->images[i].path = paths[i]; }
+	request->onLoaded = onLoaded;
+	pending++;
+
+	//cooked container needs no decoding, it goes straight to the upload queue
+	std::shared_ptr<MappedFile> file = std::make_shared<MappedFile>();
+	CookedTexture cooked;
+	if (file->Open(CookedTexturePath(paths[0])) && ParseCookedTexture(*file, cooked)
+		&& cooked.header->target == target && cooked.header->faceCount == paths.size()
+		&& (cooked.header->format != 0 || supportsBC1))
+	{
+		request->cookedFile = file;
+		request->cooked = cooked;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			Job job = { request, 0 };
+			decoded.push_back(job);
+		}
+		imageDecoded.notify_all();
+		return target == GL_TEXTURE_CUBE_MAP ? placeholderCube : placeholder2D;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		for (unsigned int i = 0; i < paths.size(); i++)
+		{
+			Job job = { request, i };
+			jobs.push_back(job);
+		}
+	}
+	jobAvailable.notify_all();
+
+	return target == GL_TEXTURE_CUBE_MAP ? placeholderCube : placeholder2D;
+}
+
+void TextureLoader::WorkerLoop()
+{
+	while (true)
+	{
+		Job job;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			jobAvailable.wait(lock, [this] { return stopping || !jobs.empty(); });
+			if (stopping) { return; }
+			job = jobs.front();
+			jobs.pop_front();
+		}
+
+		auto start = std::chrono::high_resolution_clock::now();
+		Image &image = job.request->images[job.image];
+		//grey and alpha has no matching upload format, it is expanded to RGBA while decoding
+		int sourceChannels = 0;
+		int desiredChannels = stbi_info(image.path.c_str(), &image.width, &image.height, &sourceChannels) && sourceChannels == 2 ? 4 : 0;
+		image.data = stbi_load(image.path.c_str(), &image.width, &image.height, &image.channels, desiredChannels);
+		if (desiredChannels != 0) { image.channels = desiredChannels; }
+		double elapsed = MillisecondsSince(start);
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			decodeMs += elapsed;
+			decoded.push_back(job);
+		}
+		imageDecoded.notify_all();
+	}
+}
+
+void TextureLoader::CreateTexture(Request &request)
+{
+	glGenTextures(1, &request.texture);
+	glState.BindTexture(0, request.target, request.texture);
+	if (request.target == GL_TEXTURE_CUBE_MAP)
+	{
+		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	}
+	else
+	{
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	}
+	glTexParameteri(request.target, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(request.target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+}
+
+void TextureLoader::Upload(Request &request, unsigned int index)
+{
+	Image &image = request.images[index];
+	request.uploaded++;
+
+	if (!image.data)
+	{
+		std::cout << "ERROR: TEXTURE FAILED TO LOAD: " << image.path << std::endl;
+		return;
+	}
+
+	if (request.texture == 0) { CreateTexture(request); }
+
+	//copy into a freshly orphaned pixel buffer, the driver transfers it to the texture asynchronously
+	size_t bytes = (size_t)image.width * image.height * image.channels;
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbos[nextPbo]);
+	nextPbo = (nextPbo + 1) % PBO_COUNT;
+	glBufferData(GL_PIXEL_UNPACK_BUFFER, bytes, NULL, GL_STREAM_DRAW);
+	void *mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, bytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+	if (mapped)
+	{
+		memcpy(mapped, image.data, bytes);
+		glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+	}
+
+	GLenum format = ChannelFormat(image.channels);
+	GLenum target = request.target == GL_TEXTURE_CUBE_MAP ? GL_TEXTURE_CUBE_MAP_POSITIVE_X + index : GL_TEXTURE_2D;
+	glState.BindTexture(0, request.target, request.texture);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexImage2D(target, 0, format, image.width, image.height, 0, format, GL_UNSIGNED_BYTE, mapped ? (void*)0 : image.data);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+	stbi_image_free(image.data);
+	image.data = nullptr;
+	uploadedImages++;
+}
+
+void TextureLoader::UploadCooked(Request &request)
+{
+	const CookedTextureHeader &header = *request.cooked.header;
+	CreateTexture(request);
+	glTexParameteri(request.target, GL_TEXTURE_MAX_LEVEL, header.levelCount - 1);
+	//the cooked mip chain is only sampled with a mipmapped minification filter
+	if (header.levelCount > 1) { glTexParameteri(request.target, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR); }
+
+	//pixels are read straight from the mapping, rows of every level are tightly packed
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	for (uint32_t i = 0; i < header.faceCount * header.levelCount; i++)
+	{
+		const CookedTextureLevel &level = request.cooked.levels[i];
+		const unsigned char *pixels = request.cooked.data + level.offset;
+		GLenum target = request.target == GL_TEXTURE_CUBE_MAP ? GL_TEXTURE_CUBE_MAP_POSITIVE_X + level.face : GL_TEXTURE_2D;
+		if (header.format == 0)
+		{
+			glCompressedTexImage2D(target, level.level, header.internalFormat, level.width, level.height, 0, (GLsizei)level.size, pixels);
+		}
+		else
+		{
+			glTexImage2D(target, level.level, header.internalFormat, level.width, level.height, 0, header.format, GL_UNSIGNED_BYTE, pixels);
+		}
+	}
+
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+	request.uploaded = (unsigned int)request.images.size();
+	uploadedImages += header.faceCount;
+	cookedTextures++;
+	request.cookedLevels = true;
+	//GL holds its own copy now, header and levels are no longer valid after unmapping
+	request.cookedFile.reset();
+	request.cooked = CookedTexture();
+}
+
+void TextureLoader::Update(double budgetMs)
+{
+	if (pending == 0) { return; }
+
+	auto start = std::chrono::high_resolution_clock::now();
+	bool uploadedAny = false;
+	while (!uploadedAny || MillisecondsSince(start) < budgetMs)
+	{
+		Job job;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (decoded.empty()) { break; }
+			job = decoded.front();
+			decoded.pop_front();
+		}
+
+		Request &request = *job.request;
+		if (request.cookedFile) { UploadCooked(request); }
+		else { Upload(request, job.image); }
+		uploadedAny = true;
+
+		if (request.uploaded == request.images.size())
+		{
+			if (request.texture != 0)
+			{
+				if (request.target == GL_TEXTURE_2D && !request.cookedLevels)
+				{
+					glGenerateMipmap(GL_TEXTURE_2D);
+					glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+				}
+				glState.BindTexture(0, request.target, 0);
+				if (request.onLoaded) { request.onLoaded(request.texture); }
+			}
+			pending--;
+		}
+	}
+	uploadMs += MillisecondsSince(start);
+}
+
+void TextureLoader::Finish()
+{
+	while (pending > 0)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			imageDecoded.wait(lock, [this] { return !decoded.empty(); });
+		}
+		Update(0.0);
+	}
+}
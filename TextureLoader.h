@@ -0,0 +1,94 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "TextureCooker.h"
+
+//called on the GL thread once every level of the real texture is uploaded
+typedef std::function<void(unsigned int texture)> TextureCallback;
+
+//decodes images on worker threads and uploads them through pixel buffer objects on the GL thread
+//load functions return a shared placeholder texture at once, the callback swaps in the real one
+//when a cooked container of the texture exists it is mapped instead and its mip chain uploaded from the mapping
+class TextureLoader
+{
+public:
+	//workerCount of 0 starts one worker
+	void Start(unsigned int workerCount);
+	void Stop();
+
+	unsigned int LoadTexture(const std::string &path, TextureCallback onLoaded);
+	//faces in order +X, -X, +Y, -Y, +Z, -Z, decoded in parallel
+	unsigned int LoadCubeMapTexture(const std::vector<std::string> &faces, TextureCallback onLoaded);
+
+	//upload decoded images until budget is spent, at least one image per call so loads always progress
+	void Update(double budgetMs);
+	//block until every requested texture is uploaded, used where frames must not depend on load timing
+	void Finish();
+
+	unsigned int PendingCount() const { return pending; }
+
+	//totals since start
+	unsigned int uploadedImages = 0;
+	unsigned int cookedTextures = 0;
+	double decodeMs = 0.0;
+	double uploadMs = 0.0;
+
+private:
+	struct Image
+	{
+		std::string path;
+		int width = 0, height = 0, channels = 0;
+		unsigned char *data = nullptr;
+	};
+	struct Request
+	{
+		unsigned int target;
+		std::vector<Image> images;
+		unsigned int decoded = 0;
+		unsigned int uploaded = 0;
+		unsigned int texture = 0;
+		TextureCallback onLoaded;
+		//set when the texture comes from a cooked container
+		std::shared_ptr<MappedFile> cookedFile;
+		CookedTexture cooked;
+		bool cookedLevels = false;
+	};
+	struct Job
+	{
+		std::shared_ptr<Request> request;
+		unsigned int image;
+	};
+
+	unsigned int Enqueue(unsigned int target, const std::vector<std::string> &paths, TextureCallback onLoaded);
+	void WorkerLoop();
+	void CreateTexture(Request &request);
+	void Upload(Request &request, unsigned int image);
+	void UploadCooked(Request &request);
+
+	std::vector<std::thread> workers;
+	std::mutex mutex;
+	std::condition_variable jobAvailable;
+	std::condition_variable imageDecoded;
+	std::deque<Job> jobs;
+	std::deque<Job> decoded;
+	bool stopping = false;
+
+	//requests not fully uploaded, counted up by the recording thread and down by the render thread
+	std::atomic<unsigned int> pending{ 0 };
+	unsigned int placeholder2D = 0;
+	unsigned int placeholderCube = 0;
+	bool supportsBC1 = false;
+	//streaming buffers, consecutive uploads alternate so a copy never waits on the previous one
+	static const unsigned int PBO_COUNT = 2;
+	unsigned int pbos[PBO_COUNT] = {};
+	unsigned int nextPbo = 0;
+};
@@ -0,0 +1,43 @@
+#include "UniformBuffer.h"
+
+#include <glad/glad.h>
+#include <cstring>
+
+const UniformBlockBinding UNIFORM_BLOCK_BINDINGS[] =
+{
+	{ "Camera", CAMERA_BLOCK_BINDING },
+	{ "Lights", LIGHT_BLOCK_BINDING },
+	{ "ShadowMatrices", SHADOW_BLOCK_BINDING }
+};
+const unsigned int NUMBER_OF_UNIFORM_BLOCKS = sizeof(UNIFORM_BLOCK_BINDINGS) / sizeof(UNIFORM_BLOCK_BINDINGS[0]);
+
+void UniformBuffer::Create(unsigned int binding, size_t size)
+{
+	glGenBuffers(1, &id);
+	glBindBuffer(GL_UNIFORM_BUFFER, id);
+	glBufferData(GL_UNIFORM_BUFFER, size, NULL, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	glBindBufferBase(GL_UNIFORM_BUFFER, binding, id);
+
+	shadow.assign(size, 0);
+	valid = false;
+}
+
+bool UniformBuffer::Update(const void *data, size_t size)
+{
+	if (size > shadow.size()) { size = shadow.size(); }
+	if (valid && !memcmp(shadow.data(), data, size))
+	{
+		skippedUploads++;
+		return false;
+	}
+
+	memcpy(shadow.data(), data, size);
+	valid = true;
+	uploads++;
+
+	glBindBuffer(GL_UNIFORM_BUFFER, id);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, size, data);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	return true;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+
+#include <glm/glm.hpp>
+
+//fixed binding points shared by every program in Shaders/, CreateShaderProgram binds blocks by name
+const unsigned int CAMERA_BLOCK_BINDING = 0;
+const unsigned int LIGHT_BLOCK_BINDING = 1;
+const unsigned int SHADOW_BLOCK_BINDING = 2;
+
+//std140 layouts, must match the block declarations in the shaders
+struct CameraBlock
+{
+	glm::mat4 projection;
+	glm::mat4 view;
+	glm::vec4 viewPos;
+};
+
+struct LightData
+{
+	glm::vec3 ambient;
+	float constant;
+	glm::vec3 diffuse;
+	float linear;
+	glm::vec3 specular;
+	float quadratic;
+	glm::vec4 lightPos;
+};
+
+//name of uniform block and its binding point
+struct UniformBlockBinding
+{
+	const char *name;
+	unsigned int binding;
+};
+extern const UniformBlockBinding UNIFORM_BLOCK_BINDINGS[];
+extern const unsigned int NUMBER_OF_UNIFORM_BLOCKS;
+
+//uniform buffer object which keeps a copy of its content and skips uploads of identical data
+class UniformBuffer
+{
+public:
+	void Create(unsigned int binding, size_t size);
+	//returns false when data equals the last upload and nothing was sent to GL
+	bool Update(const void *data, size_t size);
+
+	template<typename T>
+	bool Update(const T &data) { return Update(&data, sizeof(T)); }
+
+	unsigned int id = 0;
+	unsigned int uploads = 0;
+	unsigned int skippedUploads = 0;
+
+private:
+	std::vector<unsigned char> shadow;
+	bool valid = false;
+};
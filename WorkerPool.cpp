@@ -0,0 +1,64 @@
+#include "WorkerPool.h"
+
+void WorkerPool::Start(unsigned int threadCount)
+{
+	Stop();
+	stopping = false;
+	for (unsigned int i = 1; i < threadCount; i++) { workers.emplace_back(&WorkerPool::WorkerLoop, this); }
+}
+
+void WorkerPool::Stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	workAvailable.notify_all();
+	for (std::thread &worker : workers) { worker.join(); }
+	workers.clear();
+}
+
+void WorkerPool::Run(unsigned int count, const std::function<void(unsigned int)> &item)
+{
+	this->item = &item;
+	itemCount = count;
+	nextItem = 0;
+	if (!workers.empty())
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		generation++;
+		busyWorkers = (unsigned int)workers.size();
+	}
+	workAvailable.notify_all();
+	TakeItems();
+	if (!workers.empty())
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		workDone.wait(lock, [this]() { return busyWorkers == 0; });
+	}
+	this->item = nullptr;
+}
+
+void WorkerPool::WorkerLoop()
+{
+	unsigned int seen = 0;
+	for (;;)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			workAvailable.wait(lock, [this, seen]() { return stopping || generation != seen; });
+			if (stopping) { return; }
+			seen = generation;
+		}
+
+		TakeItems();
+
+		std::lock_guard<std::mutex> lock(mutex);
+		if (--busyWorkers == 0) { workDone.notify_one(); }
+	}
+}
+
+void WorkerPool::TakeItems()
+{
+	for (unsigned int i = nextItem++; i < itemCount; i = nextItem++) { (*item)(i); }
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//threads which split one batch of numbered items with the caller, every thread takes the next item until none is left
+//used for work that has to be done before the caller can go on, like binning lights or rasterizing occluders
+class WorkerPool
+{
+public:
+	~WorkerPool() { Stop(); }
+
+	//threadCount includes the thread calling Run, 1 runs everything on the caller
+	void Start(unsigned int threadCount);
+	void Stop();
+
+	//call item for 0 to count - 1 on the workers and the caller, returns once every item is done
+	void Run(unsigned int count, const std::function<void(unsigned int)> &item);
+
+private:
+	void WorkerLoop();
+	void TakeItems();
+
+	std::vector<std::thread> workers;
+	std::mutex mutex;
+	std::condition_variable workAvailable;
+	std::condition_variable workDone;
+	unsigned int generation = 0;
+	unsigned int busyWorkers = 0;
+	bool stopping = false;
+
+	//batch being run, only changed while no worker is busy
+	const std::function<void(unsigned int)> *item = nullptr;
+	unsigned int itemCount = 0;
+	std::atomic<unsigned int> nextItem;
+};
@@ -5,18 +5,39 @@
 #include <fstream>
 #include <sstream>
 #include <vector>
-#include <map>
+#include <algorithm>
+#include <thread>
+#include <mutex>
 
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
 
-#include <ft2build.h>
-#include FT_FREETYPE_H
-
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include "Benchmark.h"
+#include "Shader.h"
+#include "UniformBuffer.h"
+#include "InstanceBuffer.h"
+#include "EntityStore.h"
+#include "FrustumCuller.h"
+#include "Mesh.h"
+#include "LightClusters.h"
+#include "ModelLoader.h"
+#include "OcclusionCuller.h"
+#include "Profiler.h"
+#include "Random.h"
+#include "GLBackend.h"
+#include "RenderQueue.h"
+#include "RenderThread.h"
+#include "ShadowCache.h"
+#include "ShadowCascades.h"
+#include "ShadowAtlas.h"
+#include "TextRenderer.h"
+#include "TextureLoader.h"
+#include "TextureCooker.h"
+
 //pre-definition of functions
 void processInput(GLFWwindow *window);
 void keyboard_callback(GLFWwindow *window, float _movSpeed);
@@ -24,22 +45,44 @@ void cursor_pos_callback(GLFWwindow *window, double xpos, double ypos);
 void mouse_button_callback(GLFWwindow *window, int button, int action, int mods);
 void scroll_callback(GLFWwindow *window, double xoffset, double yoffset);
 void framebuffer_size_callback(GLFWwindow *window, int width, int height);
-void RenderCube();
-void RenderFloor();
-void RenderLamp();
-void RenderText(unsigned int shader, std::string text, float x, float y, float scale, std::string font, glm::vec3 color);
+void CreateCube();
+void CreateFloor();
+void CreateLamp();
+void SubmitCube(unsigned int instanceCount);
+void SubmitFloor(unsigned int instanceCount);
+void SubmitLamp(unsigned int instanceCount);
+void SubmitModel(unsigned int instanceCount);
+float ViewDepth(const InstanceSet &set);
+void RecordPackets(CommandList &commands, const char *scope);
+void SubmitShadowCasters(const Frustum *frusta, unsigned int frustumCount, unsigned int program, CommandList &commands);
+unsigned int CullInstances(const InstanceSet &set, const Frustum *frusta, unsigned int frustumCount, InstanceBuffer &buffer, CommandList &commands, const OcclusionCuller *occlusion = nullptr);
+void RecordText(CommandList &commands, const std::string &text, float x, float y);
+std::string FormatMs(double ms);
+void TextureLoaded(unsigned int &slot, unsigned int texture);
+void SwapInLoadedTextures();
 void RenderSkybox();
-unsigned int CreateShaderProgram(const char *vertexFilePath, const char *fragmentFilePath, const char *geometryFilePath = nullptr);
-unsigned int LoadTexture(const char *filepath);
-unsigned int LoadCubeMapTexture(std::vector<std::string> faces);
+void ResolveUniforms();
+struct ObjectUniforms;
+void SetClusterUniforms(const ShaderProgram &shader, const ObjectUniforms &uniforms, const glm::vec4 &clusterScale);
+void CreateSceneEntities(unsigned int propCount);
+void AssignInstances();
+void LoadModelTextures();
+void CreatePointLights(unsigned int count);
+void AnimatePointLights(float time);
 
 //pre-define width and height of the scene would being generated
 unsigned int SCREEN_WIDTH  = 800;
 unsigned int SCREEN_HEIGHT = 600;
 
-//pre-define width and height of shadow frame buffer object
-const unsigned int SHADOW_WIDTH = 1024;
-const unsigned int SHADOW_HEIGHT = 1024;
+//camera frustum covered by shadow cascades, fragments farther away are not shadowed
+const float SHADOW_DISTANCE = 25.0f;
+const float CASCADE_SPLIT_LAMBDA = 0.75f;
+//cascades per lamp, largest tile a cascade gets and width and height of the atlas all tiles share, set from the command line
+unsigned int shadowCascades = 3;
+unsigned int shadowMapSize = 512;
+unsigned int shadowAtlasSize = 2048;
+//filter of shadow lookups, variance shadow maps render and blur depth moments next to the depth
+ShadowFilter shadowFilter = SHADOW_FILTER_PCF;
 
 //cursor pos(look rotation) initlization factors
 float fov = 60.0f;
@@ -60,7 +103,7 @@ glm::vec3 cameraPos = glm::vec3(0.0f, 1.0f, 5.0f);
 glm::vec3 cameraFront = glm::vec3(0.0f, 0.0f, -1.0f);
 glm::vec3 cameraUp = glm::vec3(0.0f, 1.0f, 0.0f);
 
-//properties of lamps in the scene
+//properties of lamps in the scene, initial positions of the lamp entities which then drive them
 glm::vec3 lampPositions[] = 
 {
 	glm::vec3(2.0f, 3.0f, 3.0f),
@@ -68,32 +111,117 @@ glm::vec3 lampPositions[] =
 	glm::vec3(0.5f, 2.0f, -2.5f)
 };
 const unsigned int NUMBER_OF_LAMP = 3;
-
-//pre-define freetype class instances and structs
-FT_Library ft;
-FT_Face face;
-
-struct Character
+//attenuation of the lamps, also decides how far their light and so the shadows worth a tile reach
+const float LAMP_CONSTANT = 1.0f;
+const float LAMP_LINEAR = 0.09f;
+const float LAMP_QUADRATIC = 0.032f;
+//share of full intensity below which a lamp no longer lights anything visibly
+const float LAMP_CUTOFF = 1.0f / 32.0f;
+//shadow map layers, cascade c of lamp l is layer l * shadowCascades + c
+const unsigned int MAX_SHADOW_LAYERS = NUMBER_OF_LAMP * MAX_SHADOW_CASCADES;
+
+//std140 layout of the ShadowMatrices block, only the layers in use are uploaded
+struct ShadowLayer
 {
-	unsigned int texture;
-	glm::ivec2 size;
-	glm::ivec2 bearing;
-	unsigned int advance;
+	glm::mat4 lightSpaceMatrix;
+	//offset and size of the layer's atlas tile in texture coordinates, size 0 when it has no shadow this frame
+	glm::vec4 atlasRect;
 };
-std::map<GLchar, Character> Characters;
-
-//VAO & VBO definition
-unsigned int cubeVAO = 0, cubeVBO;
-unsigned int floorVAO = 0, floorVBO;
-unsigned int lampVAO = 0, lampVBO;
-unsigned int textVAO, textVBO;
-unsigned int skyboxVAO = 0, skyboxVBO;
-unsigned int depthMapFBO[NUMBER_OF_LAMP];
+struct ShadowBlock
+{
+	//view depth where every cascade ends
+	glm::vec4 cascadeFar;
+	ShadowLayer layers[MAX_SHADOW_LAYERS];
+};
+ShadowBlock shadowBlock;
+//light space matrices of every layer, fitted to the camera frustum every frame
+glm::mat4 lightSpaceMatrix[MAX_SHADOW_LAYERS];
+//atlas tile of every layer, packed again every frame from the lamps' screen coverage
+ShadowTile shadowTiles[MAX_SHADOW_LAYERS];
+
+//meshes of the scene, welded into indexed and packed vertex buffers on first draw
+Mesh cubeMesh;
+Mesh floorMesh;
+Mesh lampMesh;
+Mesh skyboxMesh;
+//frame buffer object of shadow passes, every pass draws into its tiles of depthMap (and shadowMoments)
+unsigned int depthMapFBO;
+//target of the first blur pass of variance shadow maps, the second one blurs back into shadowMoments
+unsigned int shadowBlurFBO;
+//vertex array without attributes for passes which draw one triangle generated in the vertex shader
+unsigned int emptyVAO = 0;
+//frame buffer which receives the final image, offscreen frame buffer object in benchmark mode
+unsigned int defaultFramebuffer = 0;
 
 //Texture objects definition
 unsigned int cubeTexture = 0;
 unsigned int floorTexture = 0;
-unsigned int depthMap[NUMBER_OF_LAMP];
+//shadow atlas, depth maps of every cascade of every lamp are tiles of it
+unsigned int depthMap = 0;
+//depth and squared depth of every atlas texel for variance shadow maps, and the half blurred copy
+unsigned int shadowMoments = 0;
+unsigned int shadowMomentsBlur = 0;
+//texture the object shaders filter shadows from, moments for variance shadow maps and depth otherwise
+unsigned int shadowSampleMap = 0;
+
+//transforms of every object in the scene, world matrices are rebuilt only for moved entities
+EntityStore scene;
+Entity cubeEntity;
+Entity floorEntity;
+Entity lampEntities[NUMBER_OF_LAMP];
+std::vector<Entity> propEntities;
+std::vector<glm::vec4> propTints;
+
+//per-instance transforms of every mesh, each mesh is drawn with one instanced call
+//cube instances are the center cube followed by the scattered props
+InstanceSet cubeInstances;
+InstanceSet floorInstances;
+InstanceSet lampInstances;
+//instances which passed culling of the view being drawn
+InstanceBuffer cubeVisible;
+InstanceBuffer floorVisible;
+InstanceBuffer lampVisible;
+std::vector<unsigned int> visibleInstances;
+//instances tested and culled this frame over the camera and every light
+CullingStats cullingStats;
+//center cube and floor are rasterized into a software depth buffer every frame,
+//instances of the camera pass hidden behind them are not drawn, --no-occlusion turns it off
+bool occlusionCulling = true;
+OcclusionCuller occlusionCuller;
+OccluderMesh cubeOccluder;
+OccluderMesh floorOccluder;
+
+//draw packets of the pass being recorded, sorted by state before they are handed to the render thread
+RenderQueue renderQueue;
+//submits the GL work of one frame while the next one is recorded
+RenderThread renderThread;
+
+//objects drawn into shadow maps and the cache deciding which maps need re-rendering
+std::vector<ShadowCaster> shadowCasters;
+ShadowCache shadowCache;
+//totals since start, layers without an atlas tile count as neither
+unsigned int shadowPassesRendered = 0;
+unsigned int shadowPassesSkipped = 0;
+unsigned int cubeGeometryVersion = 0;
+unsigned int floorGeometryVersion = 0;
+
+//model given with --model, mapped from its mesh cache and drawn with one instanced call per submesh
+Model model;
+Entity modelEntity = NO_ENTITY;
+InstanceSet modelInstances;
+InstanceBuffer modelVisible;
+//diffuse texture of every model material, a single texel of the material color when it has none
+std::vector<unsigned int> modelTextures;
+unsigned int modelGeometryVersion = 0;
+
+//unshadowed point lights orbiting over the floor, binned into view frustum clusters every frame
+std::vector<PointLight> pointLights;
+//orbit center in xyz and phase in w of every point light
+std::vector<glm::vec4> pointLightOrbits;
+LightClusterer lightClusterer;
+ClusterBuffers clusterBuffers;
+//first of the three texture units the cluster buffers are bound to, 0 and 1 hold diffuse and shadow maps
+const unsigned int CLUSTER_TEXTURE_UNIT = 2;
 
 std::vector<std::string> faces
 {
@@ -106,14 +234,56 @@ std::vector<std::string> faces
 	"Textures/skybox/front.jpg"
 };
 unsigned int skyboxTexture = 0;
+//textures are decoded by worker threads and swapped in when uploaded
+TextureLoader textureLoader;
+//textures uploaded on the render thread, waiting to be swapped in by the simulation thread
+std::mutex loadedTexturesMutex;
+std::vector<std::pair<unsigned int *, unsigned int>> loadedTextures;
+const double TEXTURE_UPLOAD_BUDGET_MS = 2.0;
 
 //Shader programs definition
-unsigned int cubeShader = 0;
-unsigned int floorShader = 0;
-unsigned int lampShader = 0;
-unsigned int shadowMapShader = 0;
-unsigned int skyboxShader = 0;
-unsigned int textShader = 0;
+ShaderProgram cubeShader;
+ShaderProgram floorShader;
+ShaderProgram modelShader;
+ShaderProgram lampShader;
+ShaderProgram shadowMapShader;
+ShaderProgram shadowMapLayeredShader;
+ShaderProgram shadowBlurShader;
+ShaderProgram skyboxShader;
+ShaderProgram textShader;
+
+//uniform handles of shader programs, resolved once after linking
+//model matrices are per-instance vertex attributes, see InstanceBuffer
+struct ObjectUniforms
+{
+	Uniform<float> shininess;
+	Uniform<int> diffuse, shadowMap;
+	Uniform<int> pointLights, clusterRanges, clusterLightIndices;
+	Uniform<glm::vec4> clusterScale;
+} cubeUniforms, floorUniforms, modelUniforms;
+struct
+{
+	Uniform<int> layer;
+} shadowMapUniforms;
+struct
+{
+	Uniform<int> layerMask;
+} shadowMapLayeredUniforms;
+struct
+{
+	Uniform<int> moments;
+	Uniform<glm::vec2> direction;
+	Uniform<glm::vec4> tileBounds;
+} shadowBlurUniforms;
+struct
+{
+	Uniform<int> skybox;
+} skyboxUniforms;
+
+//uniform buffers shared by all shader programs, written once per frame
+UniformBuffer cameraBuffer;
+UniformBuffer lightBuffer;
+UniformBuffer shadowBuffer;
 
 //definition of varibles which performs FPS calculation
 float deltaTime = 0.0f;
@@ -121,36 +291,72 @@ float lastTime = 0.0f;
 float timeCounter = 0.0f;
 float fps = 0.0f;
 
-int main()
+int main(int argc, char **argv)
 {
-	if (!glfwInit()) { return -1; }
+	BenchmarkConfig benchmark;
+	if (!ParseBenchmarkArgs(argc, argv, benchmark)) { return -1; }
 
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	//cooking runs without GL, the loader picks up the containers on next launch
+	if (benchmark.cookTextures)
+	{
+		std::vector<std::vector<std::string>> textures = { { "Textures/cube.png" }, { "Textures/floor.png" }, faces };
+		return CookTextures(textures, benchmark.compressTextures) ? 0 : -1;
+	}
+	if (benchmark.testCooker) { return RunCookerTests() ? 0 : -1; }
+	if (benchmark.transformBenchmark > 0) { return RunTransformBenchmark(benchmark.transformBenchmark) ? 0 : -1; }
+	if (benchmark.clusterBenchmark > 0) { return RunClusterBenchmark(benchmark.clusterBenchmark) ? 0 : -1; }
+	if (benchmark.occlusionBenchmark > 0) { return RunOcclusionBenchmark(benchmark.occlusionBenchmark) ? 0 : -1; }
+	if (!benchmark.replayGLPath.empty())
+	{
+		return ReplayGLCallLog(benchmark.replayGLPath, benchmark.outputPath) ? 0 : -1;
+	}
 
-	//Create glfw window with opengl property
-	GLFWwindow *window = glfwCreateWindow(SCREEN_WIDTH, SCREEN_HEIGHT, "Opengl win32", NULL, NULL);
-	if (!window)
+	GLFWwindow *window = nullptr;
+	if (benchmark.enabled)
 	{
-		glfwTerminate();
-		return -1;
+		//render offscreen without window and input devices, or without GL at all to time the CPU side only
+		if (benchmark.nullGL) { InstallNullGLBackend(); }
+		else if (!CreateHeadlessContext(SCREEN_WIDTH, SCREEN_HEIGHT, defaultFramebuffer)) { return -1; }
+		if (!benchmark.recordGLPath.empty()) { StartGLRecording(defaultFramebuffer, SCREEN_WIDTH, SCREEN_HEIGHT); }
+		InstallCallCounters();
 	}
-	glfwMakeContextCurrent(window);
-	glfwSetCursorPosCallback(window, cursor_pos_callback);
-	glfwSetMouseButtonCallback(window, mouse_button_callback);
-	glfwSetScrollCallback(window, scroll_callback);
-	glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+	else
+	{
+		if (!glfwInit()) { return -1; }
 
-	//Set cursor to invisible while window is running
-	glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+		glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
-	if (!gladLoadGLLoader(GLADloadproc(glfwGetProcAddress)))
-	{
-		glfwTerminate();
-		return -1;
+		//Create glfw window with opengl property
+		window = glfwCreateWindow(SCREEN_WIDTH, SCREEN_HEIGHT, "Opengl win32", NULL, NULL);
+		if (!window)
+		{
+			glfwTerminate();
+			return -1;
+		}
+		glfwMakeContextCurrent(window);
+		glfwSetCursorPosCallback(window, cursor_pos_callback);
+		glfwSetMouseButtonCallback(window, mouse_button_callback);
+		glfwSetScrollCallback(window, scroll_callback);
+		glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+
+		//Set cursor to invisible while window is running
+		glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+
+		if (!gladLoadGLLoader(GLADloadproc(glfwGetProcAddress)))
+		{
+			glfwTerminate();
+			return -1;
+		}
 	}
 
+	//start decoding textures first so it overlaps with shader compilation, one worker per hardware thread besides this one
+	//hardware_concurrency may report 0, it is clamped before subtracting and Start turns 0 workers into 1
+	textureLoader.Start(std::max(1u, std::thread::hardware_concurrency()) - 1);
+	cubeTexture = textureLoader.LoadTexture("Textures/cube.png", [](unsigned int texture) { TextureLoaded(cubeTexture, texture); });
+	floorTexture = textureLoader.LoadTexture("Textures/floor.png", [](unsigned int texture) { TextureLoaded(floorTexture, texture); });
+
 	glEnable(GL_DEPTH_TEST);
 	//Enable cull face function
 	//glEnable(GL_CULL_FACE);
@@ -159,153 +365,501 @@ int main()
 	glEnable(GL_BLEND);
 	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
-	//Assign value to instances of shader programs
-	cubeShader = CreateShaderProgram("Shaders/object.glvs", "Shaders/object.glfs");
-	floorShader = CreateShaderProgram("Shaders/object.glvs", "Shaders/object.glfs");
-	lampShader = CreateShaderProgram("Shaders/lamp.glvs", "Shaders/lamp.glfs");
-	shadowMapShader = CreateShaderProgram("Shaders/shadowMap.glvs", "Shaders/shadowMap.glfs");
-	skyboxShader = CreateShaderProgram("Shaders/cubemap.glvs", "Shaders/cubemap.glfs");
-	textShader = CreateShaderProgram("Shaders/text.glvs", "Shaders/text.glfs");
+	//permutation defines of the scene shaders, lamp count comes from the same constant as the CPU side arrays
+	shadowCascades = benchmark.shadowCascades;
+	shadowAtlasSize = benchmark.shadowAtlasSize;
+	shadowMapSize = std::min(benchmark.shadowMapSize, shadowAtlasSize);
+	shadowFilter = benchmark.shadowFilter;
+	bool varianceShadows = shadowFilter == SHADOW_FILTER_VSM;
+	unsigned int shadowLayers = NUMBER_OF_LAMP * shadowCascades;
+	ShaderDefines shadowDefines;
+	shadowDefines["SHADOW_LAYERS"] = std::to_string(shadowLayers);
+	shadowDefines["MAX_LAYER_VERTICES"] = std::to_string(3 * shadowLayers);
+	shadowDefines["VSM"] = varianceShadows ? "1" : "0";
+	ShaderDefines blurDefines;
+	blurDefines["PCF_KERNEL_SIZE"] = std::to_string(benchmark.pcfKernelSize);
+	ShaderDefines objectDefines;
+	objectDefines["NUM_OF_LAMP"] = std::to_string(NUMBER_OF_LAMP);
+	objectDefines["CASCADES"] = std::to_string(shadowCascades);
+	objectDefines["SHADOW_LAYERS"] = std::to_string(shadowLayers);
+	objectDefines["SHADOWS"] = benchmark.shadows ? "1" : "0";
+	objectDefines["PCF_KERNEL_SIZE"] = std::to_string(benchmark.pcfKernelSize);
+	objectDefines["SHADOW_FILTER"] = std::to_string((int)shadowFilter);
+	objectDefines["BLINN_PHONG"] = benchmark.blinnPhong ? "1" : "0";
+	objectDefines["CLUSTERED_LIGHTS"] = benchmark.pointLights > 0 ? "1" : "0";
+	objectDefines["CLUSTER_TILES_X"] = std::to_string(CLUSTER_TILES_X);
+	objectDefines["CLUSTER_TILES_Y"] = std::to_string(CLUSTER_TILES_Y);
+	objectDefines["CLUSTER_SLICES"] = std::to_string(CLUSTER_SLICES);
+
+	//Assign value to instances of shader programs, every program is requested first and compiled in one batch
+	const ShaderProgram *cubeProgram = RequestShaderProgram("Shaders/object.glvs", "Shaders/object.glfs", nullptr, objectDefines);
+	const ShaderProgram *floorProgram = RequestShaderProgram("Shaders/object.glvs", "Shaders/object.glfs", nullptr, objectDefines);
+	const ShaderProgram *modelProgram = RequestShaderProgram("Shaders/object.glvs", "Shaders/object.glfs", nullptr, objectDefines);
+	const ShaderProgram *lampProgram = RequestShaderProgram("Shaders/lamp.glvs", "Shaders/lamp.glfs");
+	const ShaderProgram *shadowMapProgram = RequestShaderProgram("Shaders/shadowMap.glvs", "Shaders/shadowMap.glfs", nullptr, shadowDefines);
+	const ShaderProgram *shadowMapLayeredProgram = RequestShaderProgram("Shaders/shadowMapLayered.glvs", "Shaders/shadowMap.glfs", "Shaders/shadowMapLayered.glgs", shadowDefines);
+	const ShaderProgram *shadowBlurProgram = varianceShadows ? RequestShaderProgram("Shaders/shadowBlur.glvs", "Shaders/shadowBlur.glfs", nullptr, blurDefines) : nullptr;
+	const ShaderProgram *skyboxProgram = RequestShaderProgram("Shaders/cubemap.glvs", "Shaders/cubemap.glfs");
+	const ShaderProgram *textProgram = RequestShaderProgram("Shaders/text.glvs", "Shaders/text.glfs");
+	CompileShaderPrograms();
+	cubeShader = *cubeProgram;
+	floorShader = *floorProgram;
+	modelShader = *modelProgram;
+	lampShader = *lampProgram;
+	shadowMapShader = *shadowMapProgram;
+	shadowMapLayeredShader = *shadowMapLayeredProgram;
+	if (shadowBlurProgram) { shadowBlurShader = *shadowBlurProgram; }
+	skyboxShader = *skyboxProgram;
+	textShader = *textProgram;
+	ResolveUniforms();
+	if (shadowBlurShader.id != 0)
+	{
+		shadowBlurShader.Use();
+		SetUniform(shadowBlurUniforms.moments, 0);
+	}
 
-	//Depth map frame buffer object
-	for (int i = 0; i < NUMBER_OF_LAMP; i++)
+	//the importer only runs when the mesh cache of the model is missing or older than its source
+	if (!benchmark.modelPath.empty() && model.Load(benchmark.modelPath))
 	{
-		glGenTextures(1, &depthMap[i]);
-		glBindTexture(GL_TEXTURE_2D, depthMap[i]);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_BORDER);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT, SHADOW_WIDTH, SHADOW_HEIGHT, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+		std::cout << "model " << benchmark.modelPath << (model.imported ? " imported" : " mapped from cache") << " in " << model.loadMs << " ms" << std::endl;
+		LoadModelTextures();
+		modelInstances.Create(model.mesh.boundsMin, model.mesh.boundsMax);
+		modelVisible.Create();
+		modelVisible.Attach(model.mesh.vao);
+		modelVisible.Attach(model.mesh.shadowVao);
+
+		modelShader.Use();
+		SetUniform(modelUniforms.diffuse, 0);
+		SetUniform(modelUniforms.shadowMap, 1);
+	}
+
+	//occluders are rasterized in tiles by the calling thread and one worker per remaining hardware thread
+	occlusionCulling = benchmark.occlusionCulling;
+	if (occlusionCulling) { occlusionCuller.Start(std::max(1u, std::thread::hardware_concurrency())); }
+
+	//binning runs on the calling thread and one worker per remaining hardware thread
+	if (benchmark.pointLights > 0)
+	{
+		CreatePointLights(benchmark.pointLights);
+		lightClusterer.Start(std::max(1u, std::thread::hardware_concurrency()));
+		clusterBuffers.Create();
+	}
+
+	//instances are filled from the entity store whenever an entity moved
+	cubeInstances.Create(glm::vec3(-0.5f), glm::vec3(0.5f));
+	floorInstances.Create(glm::vec3(-10.0f, 0.0f, -10.0f), glm::vec3(10.0f, 0.0f, 10.0f));
+	lampInstances.Create(glm::vec3(-0.5f), glm::vec3(0.5f));
+	cubeVisible.Create();
+	floorVisible.Create();
+	lampVisible.Create();
+	CreateSceneEntities(benchmark.props);
+	//meshes are built before the render thread takes over the context, frames only record draws of them
+	CreateCube();
+	CreateFloor();
+	CreateLamp();
+
+	cameraBuffer.Create(CAMERA_BLOCK_BINDING, sizeof(CameraBlock));
+	lightBuffer.Create(LIGHT_BLOCK_BINDING, sizeof(LightData) * NUMBER_OF_LAMP);
+	shadowBuffer.Create(SHADOW_BLOCK_BINDING, sizeof(glm::vec4) + sizeof(ShadowLayer) * shadowLayers);
+
+	//Shadow atlas of fixed size, tiles are handed out per frame so shadow memory does not grow with the lamps
+	//the hardware filter lets the sampler compare depth and blend the four results bilinearly
+	bool hardwareCompare = shadowFilter == SHADOW_FILTER_HARDWARE;
+	glGenTextures(1, &depthMap);
+	glState.BindTexture(0, GL_TEXTURE_2D, depthMap);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, hardwareCompare ? GL_LINEAR : GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, hardwareCompare ? GL_LINEAR : GL_NEAREST);
+	if (hardwareCompare)
+	{
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+	}
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT, shadowAtlasSize, shadowAtlasSize, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+	shadowSampleMap = depthMap;
+
+	glGenFramebuffers(1, &depthMapFBO);
+	glBindFramebuffer(GL_FRAMEBUFFER, depthMapFBO);
+	glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, depthMap, 0);
+	glDrawBuffer(GL_NONE);
+	glReadBuffer(GL_NONE);
+
+	if (varianceShadows)
+	{
+		//moments are filtered linearly, so the object shader takes one fetch for the blurred square
+		unsigned int *momentMaps[] = { &shadowMoments, &shadowMomentsBlur };
+		for (unsigned int *map : momentMaps)
+		{
+			glGenTextures(1, map);
+			glState.BindTexture(0, GL_TEXTURE_2D, *map);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_RG32F, shadowAtlasSize, shadowAtlasSize, 0, GL_RG, GL_FLOAT, NULL);
+		}
+		shadowSampleMap = shadowMoments;
+
+		glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, shadowMoments, 0);
+		glDrawBuffer(GL_COLOR_ATTACHMENT0);
 
-		glGenFramebuffers(1, &depthMapFBO[i]);
-		glBindFramebuffer(GL_FRAMEBUFFER, depthMapFBO[i]);
-		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depthMap[i], 0);
-		glDrawBuffer(GL_NONE);
+		glGenFramebuffers(1, &shadowBlurFBO);
+		glBindFramebuffer(GL_FRAMEBUFFER, shadowBlurFBO);
+		glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, shadowMomentsBlur, 0);
+		glDrawBuffer(GL_COLOR_ATTACHMENT0);
 		glReadBuffer(GL_NONE);
-		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+		glGenVertexArrays(1, &emptyVAO);
 	}
+	glBindFramebuffer(GL_FRAMEBUFFER, defaultFramebuffer);
 
-	while (!glfwWindowShouldClose(window))
+	FrameRecorder recorder;
+	if (benchmark.enabled)
 	{
-		//invoke keyboard callback functions
-		processInput(window);
-		keyboard_callback(window, 0.1f);
+		//recorded frames must not depend on how fast workers decode
+		textureLoader.Finish();
+		recorder.Init();
+	}
+	unsigned int frame = 0;
 
-		//setup shadow map frame buffer data
-		glm::mat4 lightProjection, lightView;
-		glm::mat4 lightSpaceMatrix[NUMBER_OF_LAMP];
+	//queries of the GPU scopes are created while this thread still has the context
+	if (benchmark.profile) { profiler.Init(!benchmark.tracePath.empty()); }
 
-		lightProjection = glm::ortho(-10.0f, 10.0f, -10.0f, 10.0f, 0.1f, 7.5f);
+	//from here on the render thread owns the context and this thread only records frames for it
+	bool nullGL = benchmark.nullGL;
+	std::function<void()> acquireContext = [window, nullGL]() { if (window) { glfwMakeContextCurrent(window); } else if (!nullGL) { MakeHeadlessContextCurrent(true); } };
+	std::function<void()> releaseContext = [window, nullGL]() { if (window) { glfwMakeContextCurrent(NULL); } else if (!nullGL) { MakeHeadlessContextCurrent(false); } };
+	if (benchmark.renderThread) { releaseContext(); }
+	renderThread.Start(benchmark.renderThread, acquireContext, releaseContext);
 
-		for (int i = 0; i < NUMBER_OF_LAMP; i++)
+	while (benchmark.enabled ? frame < benchmark.warmupFrames + benchmark.frames : !glfwWindowShouldClose(window))
+	{
+		//everything this thread does for one frame, closing it hands the simulation timings to the profiler
+		ProfileScope frameScope("Record frame", PROFILE_THREAD_SIMULATION);
+		//waits while the render thread still submits the frame before last
+		CommandList &commands = renderThread.BeginFrame();
+		//counters of this thread, added to renderStats by the render thread which owns them
+		RenderStats frameStats;
+
+		bool recordFrame = benchmark.enabled && frame >= benchmark.warmupFrames;
+		if (benchmark.enabled)
 		{
-			lightView = glm::lookAt(lampPositions[i], glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-			//set individual space matrix for each lamp in the scene for shadow mapping
-			lightSpaceMatrix[i] = lightProjection * lightView;
-
-			glm::mat4 shadow_cubeModel, shadow_floorModel;
+			//drive camera along a scripted path instead of keyboard and cursor input
+			ScriptedCameraPath(frame, benchmark.warmupFrames + benchmark.frames, cameraPos, cameraFront);
+			unsigned int sample = frame - benchmark.warmupFrames;
+			if (recordFrame) { commands.Record([&recorder, sample]() { recorder.BeginFrame(sample); }); }
+		}
+		else
+		{
+			//events are handled here while the render thread presents the previous frame
+			glfwPollEvents();
+			//invoke keyboard callback functions
+			processInput(window);
+			keyboard_callback(window, 0.1f);
+		}
+		commands.Record([]()
+		{
+			glState.ResetCounters();
+			profiler.BeginFrame();
+		});
+
+		//upload textures decoded since last frame, limited so a scene load does not stall the frame
+		//textures the render thread finished so far are drawn from this frame on
+		SwapInLoadedTextures();
+		commands.Record([]()
+		{
+			ProfileScope scope("Texture uploads", PROFILE_THREAD_RENDER, true);
+			textureLoader.Update(TEXTURE_UPLOAD_BUDGET_MS);
+		});
 
-			glUseProgram(shadowMapShader);
-			glUniformMatrix4fv(glGetUniformLocation(shadowMapShader, "lightSpaceMatrix"), 1, GL_FALSE, glm::value_ptr(lightSpaceMatrix[i]));
+		//world matrices of moved entities, instances are uploaded again only when one of them changed
+		if (scene.Update() > 0) { AssignInstances(); }
+		cullingStats = CullingStats();
+		for (int i = 0; i < NUMBER_OF_LAMP; i++) { lampPositions[i] = glm::vec3(scene.World(lampEntities[i])[3]); }
 
-			glViewport(0, 0, SHADOW_WIDTH, SHADOW_HEIGHT);
+		//Initilize matrix which send to uniforms of vertex shader
+		unsigned int width = SCREEN_WIDTH, height = SCREEN_HEIGHT;
+		glm::mat4 projection = glm::perspective(glm::radians(fov), (float)width / (float)height, 0.1f, 100.0f);
+		glm::mat4 view = glm::lookAt(cameraPos, cameraPos + cameraFront, cameraUp);
 
-			//bind specific depth map object before rendering the scene
-			glBindFramebuffer(GL_FRAMEBUFFER, depthMapFBO[i]);
+		//split the camera frustum into cascades and fit the projection of every lamp tightly around each slice
+		float cascadeFar[MAX_SHADOW_CASCADES] = { SHADOW_DISTANCE, SHADOW_DISTANCE, SHADOW_DISTANCE, SHADOW_DISTANCE };
+		ComputeCascadeSplits(0.1f, SHADOW_DISTANCE, shadowCascades, CASCADE_SPLIT_LAMBDA, cascadeFar);
+		shadowBlock.cascadeFar = glm::vec4(cascadeFar[0], cascadeFar[1], cascadeFar[2], cascadeFar[3]);
+
+		//tiles are sized by how much of the screen a lamp lights, far cascades shrink first when the atlas is full
+		//and lamps lighting nothing visible lose their shadows, the frustum also culls instances further down
+		Frustum cameraFrustum = FrustumFromMatrix(projection * view);
+		float lampRadius = LightRadius(LAMP_CONSTANT, LAMP_LINEAR, LAMP_QUADRATIC, LAMP_CUTOFF);
+		ShadowTileRequest tileRequests[MAX_SHADOW_LAYERS];
+		for (unsigned int i = 0; i < shadowLayers; i++)
+		{
+			float coverage = LightScreenCoverage(lampPositions[i / shadowCascades], lampRadius, cameraPos, cameraFrustum, glm::radians(fov));
+			tileRequests[i].size = ShadowTileSize(coverage, shadowMapSize);
+			tileRequests[i].importance = coverage / (float)(i % shadowCascades + 1);
+		}
+		ShadowTile previousTiles[MAX_SHADOW_LAYERS];
+		std::copy(shadowTiles, shadowTiles + shadowLayers, previousTiles);
+		PackShadowAtlas(shadowAtlasSize, tileRequests, shadowLayers, shadowTiles);
 
-			//essential to claer depth buffer data otherwise depth buffer will store the depth data of last frame
-			glClear(GL_DEPTH_BUFFER_BIT);
+		unsigned int tiledLayers = 0, movedTiles = 0;
+		for (unsigned int i = 0; i < shadowLayers; i++)
+		{
+			const ShadowTile &tile = shadowTiles[i];
+			unsigned int cascade = i % shadowCascades;
+			float sliceNear = cascade == 0 ? 0.1f : cascadeFar[cascade - 1];
+			lightSpaceMatrix[i] = FitCascade(lampPositions[i / shadowCascades], view, glm::radians(fov), (float)width / (float)height, sliceNear, cascadeFar[cascade], std::max(tile.size, MIN_SHADOW_TILE_SIZE));
+
+			shadowBlock.layers[i].lightSpaceMatrix = lightSpaceMatrix[i];
+			shadowBlock.layers[i].atlasRect = glm::vec4(tile.x, tile.y, tile.size, tile.size) / (float)shadowAtlasSize;
+			if (tile.size != 0) { tiledLayers |= 1u << i; }
+			if (tile != previousTiles[i]) { movedTiles |= 1u << i; }
+		}
+		//upload is skipped while neither lamps nor camera move
+		ShadowBlock shadowData = shadowBlock;
+		size_t shadowDataSize = sizeof(glm::vec4) + sizeof(ShadowLayer) * shadowLayers;
+		commands.Record([shadowData, shadowDataSize]() { shadowBuffer.Update(&shadowData, shadowDataSize); });
+
+		//objects which cast shadows this frame
+		shadowCasters.clear();
+		shadowCasters.push_back({ cubeInstances.boundsMin, cubeInstances.boundsMax, cubeGeometryVersion, cubeInstances.version, &cubeMesh, &cubeInstances, &cubeVisible });
+		shadowCasters.push_back({ floorInstances.boundsMin, floorInstances.boundsMax, floorGeometryVersion, floorInstances.version, &floorMesh, &floorInstances, &floorVisible });
+		if (modelEntity != NO_ENTITY)
+		{
+			shadowCasters.push_back({ modelInstances.boundsMin, modelInstances.boundsMax, modelGeometryVersion, modelInstances.version, &model.mesh, &modelInstances, &modelVisible });
+		}
 
-			//render scene for gaining depth data for shadow framebuffer object
-			shadow_cubeModel = glm::translate(shadow_cubeModel, glm::vec3(0.0f, 0.5f, 0.0f));
-			glUniformMatrix4fv(glGetUniformLocation(shadowMapShader, "model"), 1, GL_FALSE, glm::value_ptr(shadow_cubeModel));
+		//only tiles of layers whose light space, casters or place in the atlas changed are rendered again
+		//the permutation without shadows never samples them, so no pass is rendered at all
+		unsigned int dirtyLayers = 0;
+		if (benchmark.shadows)
+		{
+			dirtyLayers = (shadowCache.Update(lightSpaceMatrix, shadowLayers, shadowCasters) | movedTiles) & tiledLayers;
+			for (unsigned int i = 0; i < shadowLayers; i++)
+			{
+				if (dirtyLayers & (1u << i)) { frameStats.shadowPassesRendered++; }
+				else if (tiledLayers & (1u << i)) { frameStats.shadowPassesSkipped++; }
+			}
+			shadowPassesRendered += frameStats.shadowPassesRendered;
+			shadowPassesSkipped += frameStats.shadowPassesSkipped;
+		}
 
-			glBindVertexArray(cubeVAO);
-			glDrawArrays(GL_TRIANGLES, 0, 36);
-			glBindVertexArray(0);
-			//RenderCube();
+		if (dirtyLayers != 0)
+		{
+			std::vector<ShadowTile> dirtyTiles;
+			for (unsigned int i = 0; i < shadowLayers; i++)
+			{
+				if (dirtyLayers & (1u << i)) { dirtyTiles.push_back(shadowTiles[i]); }
+			}
+			commands.Record([dirtyTiles]()
+			{
+				profiler.BeginScope("Shadows", PROFILE_THREAD_RENDER, true);
+				glBindFramebuffer(GL_FRAMEBUFFER, depthMapFBO);
+				//essential to claer depth buffer data otherwise depth buffer will store the depth data of last frame
+				//only tiles drawn again are cleared, the others keep their cached depth
+				//moments are float targets which cannot be blended and start out at the far plane
+				GLbitfield clearBits = GL_DEPTH_BUFFER_BIT;
+				if (shadowFilter == SHADOW_FILTER_VSM)
+				{
+					glDisable(GL_BLEND);
+					glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
+					clearBits |= GL_COLOR_BUFFER_BIT;
+				}
+				glEnable(GL_SCISSOR_TEST);
+				for (const ShadowTile &tile : dirtyTiles)
+				{
+					glScissor(tile.x, tile.y, tile.size, tile.size);
+					glClear(clearBits);
+				}
+				glDisable(GL_SCISSOR_TEST);
+			});
+
+			//casters are culled against the frustum of every layer whose tile is drawn
+			Frustum lightFrusta[MAX_SHADOW_LAYERS], dirtyFrusta[MAX_SHADOW_LAYERS];
+			unsigned int dirtyFrustumCount = 0;
+			for (unsigned int i = 0; i < shadowLayers; i++)
+			{
+				lightFrusta[i] = FrustumFromMatrix(lightSpaceMatrix[i]);
+				if (dirtyLayers & (1u << i)) { dirtyFrusta[dirtyFrustumCount++] = lightFrusta[i]; }
+			}
 
-			shadow_floorModel = glm::translate(shadow_floorModel, glm::vec3(0.0f, 0.0f, 0.0f));
-			glUniformMatrix4fv(glGetUniformLocation(shadowMapShader, "model"), 1, GL_FALSE, glm::value_ptr(shadow_floorModel));
+			if (benchmark.layeredShadows)
+			{
+				commands.Record([dirtyLayers]()
+				{
+					//one submission for all dirty layers, geometry shader moves every triangle into the tile of each of them
+					//and clip distances cut it at the tile's edges, so instances visible to any of them are drawn
+					glViewport(0, 0, shadowAtlasSize, shadowAtlasSize);
+					for (int plane = 0; plane < 4; plane++) { glEnable(GL_CLIP_DISTANCE0 + plane); }
+					shadowMapLayeredShader.Use();
+					SetUniform(shadowMapLayeredUniforms.layerMask, (int)dirtyLayers);
+				});
+
+				SubmitShadowCasters(dirtyFrusta, dirtyFrustumCount, shadowMapLayeredShader.id, commands);
+
+				commands.Record([]()
+				{
+					for (int plane = 0; plane < 4; plane++) { glDisable(GL_CLIP_DISTANCE0 + plane); }
+				});
+			}
+			else
+			{
+				commands.Record([]() { glEnable(GL_SCISSOR_TEST); });
+				for (unsigned int i = 0; i < shadowLayers; i++)
+				{
+					if (!(dirtyLayers & (1u << i))) { continue; }
+					ShadowTile tile = shadowTiles[i];
+					commands.Record([i, tile]()
+					{
+						shadowMapShader.Use();
+						SetUniform(shadowMapUniforms.layer, (int)i);
+
+						//viewport and scissor keep the pass inside the layer's tile
+						glViewport(tile.x, tile.y, tile.size, tile.size);
+						glScissor(tile.x, tile.y, tile.size, tile.size);
+					});
+
+					SubmitShadowCasters(&lightFrusta[i], 1, shadowMapShader.id, commands);
+				}
+				commands.Record([]() { glDisable(GL_SCISSOR_TEST); });
+			}
 
-			glBindVertexArray(floorVAO);
-			glDrawArrays(GL_TRIANGLES, 0, 6);
-			glBindVertexArray(0);
-			//RenderFloor();
+			if (shadowFilter == SHADOW_FILTER_VSM)
+			{
+				commands.Record([dirtyTiles]()
+				{
+					//separable box blur of the moments of every redrawn tile, across into the copy and down back
+					ProfileScope scope("Shadow blur", PROFILE_THREAD_RENDER, true);
+					glDisable(GL_DEPTH_TEST);
+					shadowBlurShader.Use();
+					glState.BindVertexArray(emptyVAO);
+					float texel = 1.0f / shadowAtlasSize;
+					for (const ShadowTile &tile : dirtyTiles)
+					{
+						glViewport(tile.x, tile.y, tile.size, tile.size);
+						SetUniform(shadowBlurUniforms.tileBounds, glm::vec4(tile.x + 0.5f, tile.y + 0.5f, tile.x + tile.size - 0.5f, tile.y + tile.size - 0.5f) * texel);
+
+						glBindFramebuffer(GL_FRAMEBUFFER, shadowBlurFBO);
+						glState.BindTexture(0, GL_TEXTURE_2D, shadowMoments);
+						SetUniform(shadowBlurUniforms.direction, glm::vec2(texel, 0.0f));
+						glDrawArrays(GL_TRIANGLES, 0, 3);
+
+						glBindFramebuffer(GL_FRAMEBUFFER, depthMapFBO);
+						glState.BindTexture(0, GL_TEXTURE_2D, shadowMomentsBlur);
+						SetUniform(shadowBlurUniforms.direction, glm::vec2(0.0f, texel));
+						glDrawArrays(GL_TRIANGLES, 0, 3);
+					}
+					glEnable(GL_DEPTH_TEST);
+					glEnable(GL_BLEND);
+				});
+			}
 
-			glBindFramebuffer(GL_FRAMEBUFFER, 0);
+			commands.Record([]()
+			{
+				glBindFramebuffer(GL_FRAMEBUFFER, defaultFramebuffer);
+				profiler.EndScope(PROFILE_THREAD_RENDER);
+			});
 		}
 
 		//refresh background color buffer and depth test buffer
-		glViewport(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT);
+		commands.Record([width, height]()
+		{
+			glViewport(0, 0, width, height);
 
-		glClearColor(0.15f, 0.15f, 0.15f, 1.0f);
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			glClearColor(0.15f, 0.15f, 0.15f, 1.0f);
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		});
 
-		//Initilize matrix which send to uniforms of vertex shader
-		glm::mat4 projection = glm::perspective(glm::radians(fov), (float)SCREEN_WIDTH / (float)SCREEN_HEIGHT, 0.1f, 100.0f);
-		glm::mat4 view = glm::lookAt(cameraPos, cameraPos + cameraFront, cameraUp);
-		glm::mat4 cubeModel, floorModel, lampModel[NUMBER_OF_LAMP];
+		//Setup camera and lighting parameters shared by every shader program
+		CameraBlock camera = { projection, view, glm::vec4(cameraPos, 1.0f) };
+		commands.Record([camera]() { cameraBuffer.Update(camera); });
 
-		//Rendering cube object in the scene
-		glUseProgram(cubeShader);
-		//Setup lighting and matrix parameters
-		glUniform1f(glGetUniformLocation(cubeShader, "material.shininess"), 64.0f);
+		std::vector<LightData> lights(NUMBER_OF_LAMP);
 		for (int i = 0; i < NUMBER_OF_LAMP; i++)
 		{
-			glUniform1f(glGetUniformLocation(cubeShader, std::string("light[" + std::to_string(i) + "].constant").c_str()), 1.0f);
-			glUniform1f(glGetUniformLocation(cubeShader, std::string("light[" + std::to_string(i) + "].linear").c_str()), 0.09f);
-			glUniform1f(glGetUniformLocation(cubeShader, std::string("light[" + std::to_string(i) + "].quadratic").c_str()), 0.032f);
-			glUniform3fv(glGetUniformLocation(cubeShader, std::string("light[" + std::to_string(i) + "].ambient").c_str()), 1, glm::value_ptr(glm::vec3(0.1f)));
-			glUniform3fv(glGetUniformLocation(cubeShader, std::string("light[" + std::to_string(i) + "].diffuse").c_str()), 1, glm::value_ptr(glm::vec3(0.5f)));
-			glUniform3fv(glGetUniformLocation(cubeShader, std::string("light[" + std::to_string(i) + "].specular").c_str()), 1, glm::value_ptr(glm::vec3(1.0f)));
-			glUniform3fv(glGetUniformLocation(cubeShader, std::string("light[" + std::to_string(i) + "].lightPos").c_str()), 1, glm::value_ptr(lampPositions[i]));
+			lights[i].ambient = glm::vec3(0.1f);
+			lights[i].constant = 1.0f;
+			lights[i].diffuse = glm::vec3(0.5f);
+			lights[i].linear = 0.09f;
+			lights[i].specular = glm::vec3(1.0f);
+			lights[i].quadratic = 0.032f;
+			lights[i].lightPos = glm::vec4(lampPositions[i], 1.0f);
 		}
-		glUniform3fv(glGetUniformLocation(cubeShader, "viewPos"), 1, glm::value_ptr(cameraPos));
-		glUniformMatrix4fv(glGetUniformLocation(cubeShader, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
-		glUniformMatrix4fv(glGetUniformLocation(cubeShader, "view"), 1, GL_FALSE, glm::value_ptr(view));
-		for (int i = 0; i < NUMBER_OF_LAMP; i++)
+		commands.Record([lights]() { lightBuffer.Update(lights.data(), sizeof(LightData) * lights.size()); });
+
+		//point lights move every frame, so their clusters are rebuilt and uploaded every frame
+		//binning runs here, the render thread uploads copies of its output
+		if (!pointLights.empty())
 		{
-			glUniformMatrix4fv(glGetUniformLocation(cubeShader, std::string("lightSpaceMatrix[" + std::to_string(i) + "]").c_str()), 1, GL_FALSE, glm::value_ptr(lightSpaceMatrix[i]));
+			AnimatePointLights(benchmark.enabled ? frame * BENCHMARK_TIMESTEP : (float)glfwGetTime());
+			lightClusterer.SetProjection(glm::radians(fov), (float)width / (float)height, 0.1f, 100.0f);
+			{
+				ProfileScope scope("Light binning", PROFILE_THREAD_SIMULATION);
+				lightClusterer.Build(view, pointLights.data(), (unsigned int)pointLights.size());
+			}
+
+			glm::vec2 sliceScaleBias = lightClusterer.SliceScaleBias();
+			glm::vec4 clusterScale(sliceScaleBias.x, sliceScaleBias.y, (float)CLUSTER_TILES_X / width, (float)CLUSTER_TILES_Y / height);
+			std::vector<ClusterRange> clusters = lightClusterer.clusters;
+			std::vector<uint16_t> lightIndices = lightClusterer.lightIndices;
+			std::vector<PointLight> frameLights = pointLights;
+			commands.Record([clusters, lightIndices, frameLights, clusterScale]()
+			{
+				ProfileScope scope("Cluster upload", PROFILE_THREAD_RENDER, true);
+				clusterBuffers.Update(clusters, lightIndices, frameLights.data(), (unsigned int)frameLights.size());
+				clusterBuffers.Bind(CLUSTER_TEXTURE_UNIT);
+				SetClusterUniforms(cubeShader, cubeUniforms, clusterScale);
+				SetClusterUniforms(floorShader, floorUniforms, clusterScale);
+				SetClusterUniforms(modelShader, modelUniforms, clusterScale);
+			});
 		}
-		cubeModel = glm::translate(cubeModel, glm::vec3(0.0f, 0.5f, 0.0f));
-		glUniformMatrix4fv(glGetUniformLocation(cubeShader, "model"), 1, GL_FALSE, glm::value_ptr(cubeModel));
 
-		RenderCube();
+		//the center cube and the floor are the occluders, shadow passes keep every caster since lamps see past them
+		if (occlusionCulling)
+		{
+			ProfileScope scope("Occluders", PROFILE_THREAD_SIMULATION);
+			occlusionCuller.BeginFrame(projection * view);
+			occlusionCuller.AddOccluder(cubeOccluder, scene.World(cubeEntity));
+			occlusionCuller.AddOccluder(floorOccluder, scene.World(floorEntity));
+			occlusionCuller.Rasterize();
+		}
 
-		//Rendering floor object in the scene
-		floorModel = glm::translate(floorModel, glm::vec3(0.0f, 0.0f, 0.0f));
-		glUniformMatrix4fv(glGetUniformLocation(floorShader, "model"), 1, GL_FALSE, glm::value_ptr(floorModel));
+		//only instances inside the camera frustum and not hidden behind an occluder are uploaded and drawn
+		unsigned int cubeCount, floorCount, lampCount, modelCount = 0;
+		{
+			ProfileScope scope("Culling", PROFILE_THREAD_SIMULATION);
+			const OcclusionCuller *occlusion = occlusionCulling ? &occlusionCuller : nullptr;
+			cubeCount = CullInstances(cubeInstances, &cameraFrustum, 1, cubeVisible, commands, occlusion);
+			floorCount = CullInstances(floorInstances, &cameraFrustum, 1, floorVisible, commands, occlusion);
+			lampCount = CullInstances(lampInstances, &cameraFrustum, 1, lampVisible, commands, occlusion);
+			if (modelEntity != NO_ENTITY) { modelCount = CullInstances(modelInstances, &cameraFrustum, 1, modelVisible, commands, occlusion); }
+		}
 
-		RenderFloor();
+		//Rendering cube and prop objects, floor and imported model in the scene
+		//draws are queued and go out sorted by program, textures and vertex array
+		SubmitCube(cubeCount);
+		SubmitFloor(floorCount);
+		SubmitModel(modelCount);
+		RecordPackets(commands, "Objects");
 
 		//Rendering lamp objects in the scene
-		glUseProgram(lampShader);
-		glUniformMatrix4fv(glGetUniformLocation(lampShader, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
-		glUniformMatrix4fv(glGetUniformLocation(lampShader, "view"), 1, GL_FALSE, glm::value_ptr(view));
-		for (int i = 0; i < NUMBER_OF_LAMP; i++)
-		{
-			lampModel[i] = glm::translate(lampModel[i], lampPositions[i]);
-			lampModel[i] = glm::scale(lampModel[i], glm::vec3(0.25f));
-			glUniformMatrix4fv(glGetUniformLocation(lampShader, "model"), 1, GL_FALSE, glm::value_ptr(lampModel[i]));
-
-			RenderLamp();
-		}
+		SubmitLamp(lampCount);
+		RecordPackets(commands, "Lamps");
 
 		//Rendering cubemap skybox
 		/*
-		glDepthFunc(GL_LEQUAL);
-		glUseProgram(skyboxShader);
-		glUniformMatrix4fv(glGetUniformLocation(skyboxShader, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
-		view = glm::mat4(glm::mat3(glm::lookAt(cameraPos, cameraPos + cameraFront, cameraUp)));
-		glUniformMatrix4fv(glGetUniformLocation(skyboxShader, "view"), 1, GL_FALSE, glm::value_ptr(view));
+		commands.Record([]()
+		{
+			glDepthFunc(GL_LEQUAL);
+			skyboxShader.Use();
 
-		RenderSkybox();
+			RenderSkybox();
+		});
 		*/
 
 		//Rendering FPS text in the scene
-		float currentTime = glfwGetTime();
+		float currentTime = benchmark.enabled ? frame * BENCHMARK_TIMESTEP : (float)glfwGetTime();
 		deltaTime = currentTime - lastTime;
 		lastTime = currentTime;
 
@@ -317,17 +871,113 @@ int main()
 			timeCounter = 0.0f;
 		}
 		std::string str_fps = "FPS: " + std::to_string(fps);
-		RenderText(textShader, str_fps, 10.0f, (float)SCREEN_HEIGHT - 22.0f, 0.3f, "Roboto", glm::vec3(1.0f));
+		commands.Record([]() { profiler.BeginScope("Text", PROFILE_THREAD_RENDER, true); });
+		RecordText(commands, str_fps, 10.0f, (float)height - 22.0f);
 
 		//Render mouse click text
 		std::string str_leftMouseClick = "Left Mouse clicked";
-		if (isLeftMouseClicked) { RenderText(textShader, str_leftMouseClick, 10.0f, (float)SCREEN_HEIGHT - 44.0f, 0.3f, "Roboto", glm::vec3(1.0f)); }
+		if (isLeftMouseClicked) { RecordText(commands, str_leftMouseClick, 10.0f, (float)height - 44.0f); }
 		std::string str_RightMouseClick = "Right Mouse clicked";
-		if (isRightMouseClicked) { RenderText(textShader, str_RightMouseClick, 10.0f, (float)SCREEN_HEIGHT - 66.0f, 0.3f, "Roboto", glm::vec3(1.0f)); }
+		if (isRightMouseClicked) { RecordText(commands, str_RightMouseClick, 10.0f, (float)height - 66.0f); }
+
+		//Render culling counters of this frame
+		std::string str_culling = "Objects tested: " + std::to_string(cullingStats.tested) + " culled: " + std::to_string(cullingStats.culled);
+		if (occlusionCulling) { str_culling += " occluded: " + std::to_string(cullingStats.occluded); }
+		str_culling += " drawn: " + std::to_string(cullingStats.drawn);
+		RecordText(commands, str_culling, 10.0f, 32.0f);
+		frameStats.objectsTested += cullingStats.tested;
+		frameStats.objectsCulled += cullingStats.culled;
+		frameStats.objectsOccluded += cullingStats.occluded;
+		frameStats.objectsDrawn += cullingStats.drawn;
+
+		//Render clustered light counters
+		if (!pointLights.empty())
+		{
+			std::string str_lights = "Point lights: " + std::to_string(pointLights.size()) + " max per cluster: " + std::to_string(lightClusterer.maxLightsPerCluster);
+			RecordText(commands, str_lights, 10.0f, 76.0f);
+		}
+
+		//Render binds the state cache dropped so far this frame, only known once the render thread got here
+		commands.Record([]()
+		{
+			std::string str_binds = "Redundant binds dropped: " + std::to_string(glState.droppedCalls);
+			RenderText(str_binds, 10.0f, 54.0f, 0.3f, "Roboto", glm::vec3(1.0f));
+		});
+
+		//Render shadow cache counters
+		std::string str_shadow = "Shadow passes rendered: " + std::to_string(shadowPassesRendered) + " skipped: " + std::to_string(shadowPassesSkipped);
+		RecordText(commands, str_shadow, 10.0f, 10.0f);
+
+		//Render profiler breakdown of the newest frame whose GPU times are back, nested scopes indented
+		if (profiler.Enabled())
+		{
+			commands.Record([width, height]()
+			{
+				std::vector<ProfileEvent> events;
+				profiler.LastFrames(events);
+				float y = (float)height - 22.0f;
+				for (const ProfileEvent &event : events)
+				{
+					std::string line = std::string(event.depth * 2, ' ') + event.name + "  cpu " + FormatMs(event.cpuEnd - event.cpuStart);
+					if (event.gpuStart >= 0.0) { line += "  gpu " + FormatMs(event.gpuEnd - event.gpuStart); }
+					RenderText(line, (float)width - 300.0f, y, 0.3f, "Roboto", glm::vec3(1.0f));
+					y -= 18.0f;
+				}
+			});
+		}
+
+		//every string queued above goes out in one draw call
+		commands.Record([width, height, frameStats]()
+		{
+			FlushText(textShader, width, height);
+			profiler.EndScope(PROFILE_THREAD_RENDER);
+			renderStats.redundantBindsDropped += glState.droppedCalls;
+			renderStats.shadowPassesRendered += frameStats.shadowPassesRendered;
+			renderStats.shadowPassesSkipped += frameStats.shadowPassesSkipped;
+			renderStats.objectsTested += frameStats.objectsTested;
+			renderStats.objectsCulled += frameStats.objectsCulled;
+			renderStats.objectsOccluded += frameStats.objectsOccluded;
+			renderStats.objectsDrawn += frameStats.objectsDrawn;
+		});
+
+		if (benchmark.enabled)
+		{
+			if (recordFrame) { commands.Record([&recorder]() { recorder.EndFrame(); }); }
+		}
+		else
+		{
+			//buffer manipulation every single frame
+			commands.Record([window]()
+			{
+				ProfileScope scope("Swap", PROFILE_THREAD_RENDER);
+				glfwSwapBuffers(window);
+			});
+		}
+		commands.Record([]() { profiler.EndFrame(); });
+		renderThread.EndFrame();
+		frame++;
+	}
 
-		//buffer and event manipulation every single frame
-		glfwSwapBuffers(window);
-		glfwPollEvents();
+	//frames still queued are submitted, then the context comes back for cleanup
+	renderThread.Stop();
+	if (benchmark.renderThread) { acquireContext(); }
+	textureLoader.Stop();
+	lightClusterer.Stop();
+	profiler.Shutdown();
+	if (!benchmark.tracePath.empty()) { profiler.WriteTrace(benchmark.tracePath); }
+	//teardown is left out of the log, a replay keeps its own frame buffer
+	if (!benchmark.recordGLPath.empty())
+	{
+		StopGLRecording();
+		WriteGLCallLog(RecordedGLCalls(), benchmark.recordGLPath);
+		WriteGLCallCounts(RecordedGLCalls(), benchmark.recordGLPath + ".csv");
+	}
+	if (benchmark.enabled)
+	{
+		recorder.Finish();
+		bool written = recorder.WriteResults(benchmark.outputPath);
+		if (!benchmark.nullGL) { DestroyHeadlessContext(); }
+		if (!written) { return -1; }
 	}
 
 	return 0;
@@ -436,310 +1086,277 @@ void scroll_callback(GLFWwindow *window, double xoffset, double yoffset)
 
 void framebuffer_size_callback(GLFWwindow *window, int width, int height)
 {
-	glViewport(0, 0, width, height);
+	//minimized window reports zero size, keep the last one
+	if (width == 0 || height == 0) { return; }
+	SCREEN_WIDTH = width;
+	SCREEN_HEIGHT = height;
 }
 
-void RenderCube()
+void CreateCube()
 {
-	if (cubeVAO == 0)
+	float cubeVertices[] =
 	{
-		float cubeVertices[] =
-		{
-			-0.5f,  0.5f,  0.5f,    0.0f,  1.0f,  0.0f,    0.0f,  0.0f,
-			 0.5f,  0.5f,  0.5f,    0.0f,  1.0f,  0.0f,    1.0f,  0.0f,
-			 0.5f,  0.5f, -0.5f,    0.0f,  1.0f,  0.0f,    1.0f,  1.0f,
-			 0.5f,  0.5f, -0.5f,    0.0f,  1.0f,  0.0f,    1.0f,  1.0f,
-			-0.5f,  0.5f, -0.5f,    0.0f,  1.0f,  0.0f,    0.0f,  1.0f,
-			-0.5f,  0.5f,  0.5f,    0.0f,  1.0f,  0.0f,    0.0f,  0.0f,
-
-			 0.5f, -0.5f, -0.5f,    0.0f, -1.0f,  0.0f,    0.0f,  0.0f,
-			-0.5f, -0.5f, -0.5f,    0.0f, -1.0f,  0.0f,    1.0f,  0.0f,
-			-0.5f, -0.5f,  0.5f,    0.0f, -1.0f,  0.0f,    1.0f,  1.0f,
-			-0.5f, -0.5f,  0.5f,    0.0f, -1.0f,  0.0f,    1.0f,  1.0f,
-			 0.5f, -0.5f,  0.5f,    0.0f, -1.0f,  0.0f,    0.0f,  1.0f,
-			 0.5f, -0.5f, -0.5f,    0.0f, -1.0f,  0.0f,    0.0f,  0.0f,
-
-			-0.5f, -0.5f, -0.5f,   -1.0f,  0.0f,  0.0f,    0.0f,  0.0f,
-			-0.5f, -0.5f,  0.5f,   -1.0f,  0.0f,  0.0f,    1.0f,  0.0f,
-			-0.5f,  0.5f,  0.5f,   -1.0f,  0.0f,  0.0f,    1.0f,  1.0f,
-			-0.5f,  0.5f,  0.5f,   -1.0f,  0.0f,  0.0f,    1.0f,  1.0f,
-			-0.5f,  0.5f, -0.5f,   -1.0f,  0.0f,  0.0f,    0.0f,  1.0f,
-			-0.5f, -0.5f, -0.5f,   -1.0f,  0.0f,  0.0f,    0.0f,  0.0f,
-
-			 0.5f, -0.5f,  0.5f,    1.0f,  0.0f,  0.0f,    0.0f,  0.0f,
-			 0.5f, -0.5f, -0.5f,    1.0f,  0.0f,  0.0f,    1.0f,  0.0f,
-			 0.5f,  0.5f, -0.5f,    1.0f,  0.0f,  0.0f,    1.0f,  1.0f,
-			 0.5f,  0.5f, -0.5f,    1.0f,  0.0f,  0.0f,    1.0f,  1.0f,
-			 0.5f,  0.5f,  0.5f,    1.0f,  0.0f,  0.0f,    0.0f,  1.0f,
-			 0.5f, -0.5f,  0.5f,    1.0f,  0.0f,  0.0f,    0.0f,  0.0f,
-
-			-0.5f, -0.5f,  0.5f,    0.0f,  0.0f,  1.0f,    0.0f,  0.0f,
-			 0.5f, -0.5f,  0.5f,    0.0f,  0.0f,  1.0f,    1.0f,  0.0f,
-			 0.5f,  0.5f,  0.5f,    0.0f,  0.0f,  1.0f,    1.0f,  1.0f,
-			 0.5f,  0.5f,  0.5f,    0.0f,  0.0f,  1.0f,    1.0f,  1.0f,
-			-0.5f,  0.5f,  0.5f,    0.0f,  0.0f,  1.0f,    0.0f,  1.0f,
-			-0.5f, -0.5f,  0.5f,    0.0f,  0.0f,  1.0f,    0.0f,  0.0f,
-
-			 0.5f, -0.5f, -0.5f,    0.0f,  0.0f, -1.0f,    0.0f,  0.0f,
-			-0.5f, -0.5f, -0.5f,    0.0f,  0.0f, -1.0f,    1.0f,  0.0f,
-			-0.5f,  0.5f, -0.5f,    0.0f,  0.0f, -1.0f,    1.0f,  1.0f,
-			-0.5f,  0.5f, -0.5f,    0.0f,  0.0f, -1.0f,    1.0f,  1.0f,
-			 0.5f,  0.5f, -0.5f,    0.0f,  0.0f, -1.0f,    0.0f,  1.0f,
-			 0.5f, -0.5f, -0.5f,    0.0f,  0.0f, -1.0f,    0.0f,  0.0f
-		};
-
-		glGenVertexArrays(1, &cubeVAO);
-		glGenBuffers(1, &cubeVBO);
-		glBindVertexArray(cubeVAO);
-		glBindBuffer(GL_ARRAY_BUFFER, cubeVBO);
-		glBufferData(GL_ARRAY_BUFFER, sizeof(cubeVertices), cubeVertices, GL_STATIC_DRAW);
+		-0.5f,  0.5f,  0.5f,    0.0f,  1.0f,  0.0f,    0.0f,  0.0f,
+		 0.5f,  0.5f,  0.5f,    0.0f,  1.0f,  0.0f,    1.0f,  0.0f,
+		 0.5f,  0.5f, -0.5f,    0.0f,  1.0f,  0.0f,    1.0f,  1.0f,
+		 0.5f,  0.5f, -0.5f,    0.0f,  1.0f,  0.0f,    1.0f,  1.0f,
+		-0.5f,  0.5f, -0.5f,    0.0f,  1.0f,  0.0f,    0.0f,  1.0f,
+		-0.5f,  0.5f,  0.5f,    0.0f,  1.0f,  0.0f,    0.0f,  0.0f,
+
+		 0.5f, -0.5f, -0.5f,    0.0f, -1.0f,  0.0f,    0.0f,  0.0f,
+		-0.5f, -0.5f, -0.5f,    0.0f, -1.0f,  0.0f,    1.0f,  0.0f,
+		-0.5f, -0.5f,  0.5f,    0.0f, -1.0f,  0.0f,    1.0f,  1.0f,
+		-0.5f, -0.5f,  0.5f,    0.0f, -1.0f,  0.0f,    1.0f,  1.0f,
+		 0.5f, -0.5f,  0.5f,    0.0f, -1.0f,  0.0f,    0.0f,  1.0f,
+		 0.5f, -0.5f, -0.5f,    0.0f, -1.0f,  0.0f,    0.0f,  0.0f,
+
+		-0.5f, -0.5f, -0.5f,   -1.0f,  0.0f,  0.0f,    0.0f,  0.0f,
+		-0.5f, -0.5f,  0.5f,   -1.0f,  0.0f,  0.0f,    1.0f,  0.0f,
+		-0.5f,  0.5f,  0.5f,   -1.0f,  0.0f,  0.0f,    1.0f,  1.0f,
+		-0.5f,  0.5f,  0.5f,   -1.0f,  0.0f,  0.0f,    1.0f,  1.0f,
+		-0.5f,  0.5f, -0.5f,   -1.0f,  0.0f,  0.0f,    0.0f,  1.0f,
+		-0.5f, -0.5f, -0.5f,   -1.0f,  0.0f,  0.0f,    0.0f,  0.0f,
+
+		 0.5f, -0.5f,  0.5f,    1.0f,  0.0f,  0.0f,    0.0f,  0.0f,
+		 0.5f, -0.5f, -0.5f,    1.0f,  0.0f,  0.0f,    1.0f,  0.0f,
+		 0.5f,  0.5f, -0.5f,    1.0f,  0.0f,  0.0f,    1.0f,  1.0f,
+		 0.5f,  0.5f, -0.5f,    1.0f,  0.0f,  0.0f,    1.0f,  1.0f,
+		 0.5f,  0.5f,  0.5f,    1.0f,  0.0f,  0.0f,    0.0f,  1.0f,
+		 0.5f, -0.5f,  0.5f,    1.0f,  0.0f,  0.0f,    0.0f,  0.0f,
+
+		-0.5f, -0.5f,  0.5f,    0.0f,  0.0f,  1.0f,    0.0f,  0.0f,
+		 0.5f, -0.5f,  0.5f,    0.0f,  0.0f,  1.0f,    1.0f,  0.0f,
+		 0.5f,  0.5f,  0.5f,    0.0f,  0.0f,  1.0f,    1.0f,  1.0f,
+		 0.5f,  0.5f,  0.5f,    0.0f,  0.0f,  1.0f,    1.0f,  1.0f,
+		-0.5f,  0.5f,  0.5f,    0.0f,  0.0f,  1.0f,    0.0f,  1.0f,
+		-0.5f, -0.5f,  0.5f,    0.0f,  0.0f,  1.0f,    0.0f,  0.0f,
+
+		 0.5f, -0.5f, -0.5f,    0.0f,  0.0f, -1.0f,    0.0f,  0.0f,
+		-0.5f, -0.5f, -0.5f,    0.0f,  0.0f, -1.0f,    1.0f,  0.0f,
+		-0.5f,  0.5f, -0.5f,    0.0f,  0.0f, -1.0f,    1.0f,  1.0f,
+		-0.5f,  0.5f, -0.5f,    0.0f,  0.0f, -1.0f,    1.0f,  1.0f,
+		 0.5f,  0.5f, -0.5f,    0.0f,  0.0f, -1.0f,    0.0f,  1.0f,
+		 0.5f, -0.5f, -0.5f,    0.0f,  0.0f, -1.0f,    0.0f,  0.0f
+	};
+
+	//36 corners of the triangle list share 24 unique vertices
+	MeshData cubeData = BuildIndexedMesh(cubeVertices, 36, MESH_NORMALS | MESH_TEXCOORDS);
+	OptimizeMesh(cubeData);
+	cubeMesh.Create(cubeData);
+	cubeOccluder.positions = cubeData.positions;
+	cubeOccluder.indices = cubeData.indices;
+	cubeVisible.Attach(cubeMesh.vao);
+	cubeVisible.Attach(cubeMesh.shadowVao);
+
+	cubeGeometryVersion++;
+
+	cubeShader.Use();
+	SetUniform(cubeUniforms.diffuse, 0);
+	SetUniform(cubeUniforms.shadowMap, 1);
+}
 
-		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
-		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
-		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
+void SubmitCube(unsigned int instanceCount)
+{
+	DrawPacket packet;
+	packet.program = cubeShader.id;
+	packet.vao = cubeMesh.vao;
+	packet.textureTargets[0] = GL_TEXTURE_2D;
+	packet.textures[0] = cubeTexture;
+	//shadow maps generated from every single lamp in the scene
+	packet.textureTargets[1] = GL_TEXTURE_2D;
+	packet.textures[1] = shadowSampleMap;
+	//object programs are shared, the model sets its own shininess per material
+	packet.materialLocation = cubeUniforms.shininess.location;
+	packet.materialValue = 64.0f;
+	packet.indexCount = cubeMesh.indexCount;
+	packet.indexType = cubeMesh.indexType;
+	packet.instanceCount = instanceCount;
+	renderQueue.Submit(RENDER_PASS_OPAQUE, packet, ViewDepth(cubeInstances));
+}
 
-		glEnableVertexAttribArray(0);
-		glEnableVertexAttribArray(1);
-		glEnableVertexAttribArray(2);
+void CreateFloor()
+{
+	float floorVertices[] =
+	{
+		-10.0f,  0.0f,  10.0f,    0.0f,  1.0f,  0.0f,     0.0f,   0.0f,
+		 10.0f,  0.0f,  10.0f,    0.0f,  1.0f,  0.0f,    10.0f,   0.0f,
+		 10.0f,  0.0f, -10.0f,    0.0f,  1.0f,  0.0f,    10.0f,  10.0f,
+		 10.0f,  0.0f, -10.0f,    0.0f,  1.0f,  0.0f,    10.0f,  10.0f,
+		-10.0f,  0.0f, -10.0f,    0.0f,  1.0f,  0.0f,     0.0f,  10.0f,
+		-10.0f,  0.0f,  10.0f,    0.0f,  1.0f,  0.0f,     0.0f,   0.0f
+	};
+
+	MeshData floorData = BuildIndexedMesh(floorVertices, 6, MESH_NORMALS | MESH_TEXCOORDS);
+	OptimizeMesh(floorData);
+	floorMesh.Create(floorData);
+	floorOccluder.positions = floorData.positions;
+	floorOccluder.indices = floorData.indices;
+	floorVisible.Attach(floorMesh.vao);
+	floorVisible.Attach(floorMesh.shadowVao);
+
+	floorGeometryVersion++;
+
+	floorShader.Use();
+	SetUniform(floorUniforms.diffuse, 0);
+	SetUniform(floorUniforms.shadowMap, 1);
+}
 
-		cubeTexture = LoadTexture("Textures/cube.png");
+void SubmitFloor(unsigned int instanceCount)
+{
+	DrawPacket packet;
+	packet.program = floorShader.id;
+	packet.vao = floorMesh.vao;
+	packet.textureTargets[0] = GL_TEXTURE_2D;
+	packet.textures[0] = floorTexture;
+	//shadow maps generated from every single lamp in the scene
+	packet.textureTargets[1] = GL_TEXTURE_2D;
+	packet.textures[1] = shadowSampleMap;
+	packet.materialLocation = floorUniforms.shininess.location;
+	packet.materialValue = 64.0f;
+	packet.indexCount = floorMesh.indexCount;
+	packet.indexType = floorMesh.indexType;
+	packet.instanceCount = instanceCount;
+	renderQueue.Submit(RENDER_PASS_OPAQUE, packet, ViewDepth(floorInstances));
+}
 
-		glUseProgram(cubeShader);
-		glUniform1i(glGetUniformLocation(cubeShader, "material.diffuse"), 0);
-		//set sequence of depth map texture for shader program of cube
-		for (int i = 0; i < NUMBER_OF_LAMP; i++) { glUniform1i(glGetUniformLocation(cubeShader, std::string("shadowMap[" + std::to_string(i) + "]").c_str()), i + 1); }
-	}
-	
-	glBindVertexArray(cubeVAO);
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, cubeTexture);
-	//generate shadow map which generated from every single lamp in the scene
-	for (int i = 0; i < NUMBER_OF_LAMP; i++)
+//record depth draws of every caster instance inside the frusta of the lamps being drawn with program,
+//its uniforms must be set by an earlier command
+void SubmitShadowCasters(const Frustum *frusta, unsigned int frustumCount, unsigned int program, CommandList &commands)
+{
+	ProfileScope scope("Shadow culling", PROFILE_THREAD_SIMULATION);
+	for (const ShadowCaster &caster : shadowCasters)
 	{
-		glActiveTexture(GL_TEXTURE1 + i);
-		glBindTexture(GL_TEXTURE_2D, depthMap[i]);
+		unsigned int visible = CullInstances(*caster.instances, frusta, frustumCount, *caster.visibleInstances, commands);
+		if (visible == 0) { continue; }
+
+		//depth only needs positions, the shadow vertex array skips the packed attribute stream
+		DrawPacket packet;
+		packet.program = program;
+		packet.vao = caster.mesh->shadowVao;
+		packet.indexCount = caster.mesh->indexCount;
+		packet.indexType = caster.mesh->indexType;
+		packet.instanceCount = visible;
+		renderQueue.Submit(RENDER_PASS_SHADOW, packet, 0.0f);
 	}
-	glDrawArrays(GL_TRIANGLES, 0, 36);
-	glBindVertexArray(0);
+	RecordPackets(commands, "Shadow casters");
 }
 
-void RenderFloor()
+void SubmitModel(unsigned int instanceCount)
 {
-	if (floorVAO == 0)
-	{
-		float floorVertices[] =
-		{
-			-10.0f,  0.0f,  10.0f,    0.0f,  1.0f,  0.0f,     0.0f,   0.0f,
-			 10.0f,  0.0f,  10.0f,    0.0f,  1.0f,  0.0f,    10.0f,   0.0f,
-			 10.0f,  0.0f, -10.0f,    0.0f,  1.0f,  0.0f,    10.0f,  10.0f,
-			 10.0f,  0.0f, -10.0f,    0.0f,  1.0f,  0.0f,    10.0f,  10.0f,
-			-10.0f,  0.0f, -10.0f,    0.0f,  1.0f,  0.0f,     0.0f,  10.0f,
-			-10.0f,  0.0f,  10.0f,    0.0f,  1.0f,  0.0f,     0.0f,   0.0f
-		};
-
-		glGenVertexArrays(1, &floorVAO);
-		glGenBuffers(1, &floorVBO);
-		glBindVertexArray(floorVAO);
-		glBindBuffer(GL_ARRAY_BUFFER, floorVBO);
-		glBufferData(GL_ARRAY_BUFFER, sizeof(floorVertices), floorVertices, GL_STATIC_DRAW);
-
-		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
-		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
-		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
-
-		glEnableVertexAttribArray(0);
-		glEnableVertexAttribArray(1);
-		glEnableVertexAttribArray(2);
-
-		floorTexture = LoadTexture("Textures/floor.png");
+	if (modelEntity == NO_ENTITY) { return; }
 
-		glUseProgram(floorShader);
-		glUniform1i(glGetUniformLocation(floorShader, "material.diffuse"), 0);
-		//set sequence of depth map texture for shader program of floor
-		for (int i = 0; i < NUMBER_OF_LAMP; i++) { glUniform1i(glGetUniformLocation(floorShader, std::string("shadowMap[" + std::to_string(i) + "]").c_str()), i + 1); }
-	}
-	
-	glBindVertexArray(floorVAO);
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, floorTexture);
-	//generate shadow map which generated from every single lamp in the scene
-	for (int i = 0; i < NUMBER_OF_LAMP; i++)
+	//submeshes share the buffers and differ only in index range and material
+	unsigned int indexSize = IndexSize(model.mesh.indexType);
+	float depth = ViewDepth(modelInstances);
+	for (const CookedSubmesh &submesh : model.submeshes)
 	{
-		glActiveTexture(GL_TEXTURE1 + i);
-		glBindTexture(GL_TEXTURE_2D, depthMap[i]);
+		DrawPacket packet;
+		packet.program = modelShader.id;
+		packet.vao = model.mesh.vao;
+		packet.textureTargets[0] = GL_TEXTURE_2D;
+		packet.textures[0] = modelTextures[submesh.material];
+		packet.textureTargets[1] = GL_TEXTURE_2D;
+		packet.textures[1] = shadowSampleMap;
+		packet.materialLocation = modelUniforms.shininess.location;
+		packet.materialValue = model.materials[submesh.material].shininess;
+		packet.indexCount = submesh.indexCount;
+		packet.indexType = model.mesh.indexType;
+		packet.indexOffset = (size_t)submesh.firstIndex * indexSize;
+		packet.instanceCount = instanceCount;
+		renderQueue.Submit(RENDER_PASS_OPAQUE, packet, depth);
 	}
-	glDrawArrays(GL_TRIANGLES, 0, 6);
-	glBindVertexArray(0);
 }
 
-void RenderLamp()
+void CreateLamp()
 {
-	if (lampVAO == 0)
+	float lampVertices[] =
 	{
-		float lampVertices[] =
-		{
-			-0.5f,  0.5f,  0.5f,
-			 0.5f,  0.5f,  0.5f,
-			 0.5f,  0.5f, -0.5f,
-			 0.5f,  0.5f, -0.5f,
-			-0.5f,  0.5f, -0.5f,
-			-0.5f,  0.5f,  0.5f,
-
-			 0.5f, -0.5f, -0.5f,
-			-0.5f, -0.5f, -0.5f,
-			-0.5f, -0.5f,  0.5f,
-			-0.5f, -0.5f,  0.5f,
-			 0.5f, -0.5f,  0.5f,
-			 0.5f, -0.5f, -0.5f,
-
-			-0.5f, -0.5f, -0.5f,
-			-0.5f, -0.5f,  0.5f,
-			-0.5f,  0.5f,  0.5f,
-			-0.5f,  0.5f,  0.5f,
-			-0.5f,  0.5f, -0.5f,
-			-0.5f, -0.5f, -0.5f,
-
-			 0.5f, -0.5f,  0.5f,
-			 0.5f, -0.5f, -0.5f,
-			 0.5f,  0.5f, -0.5f,
-			 0.5f,  0.5f, -0.5f,
-			 0.5f,  0.5f,  0.5f,
-			 0.5f, -0.5f,  0.5f,
-
-			-0.5f, -0.5f,  0.5f,
-			 0.5f, -0.5f,  0.5f,
-			 0.5f,  0.5f,  0.5f,
-			 0.5f,  0.5f,  0.5f,
-			-0.5f,  0.5f,  0.5f,
-			-0.5f, -0.5f,  0.5f,
-
-			 0.5f, -0.5f, -0.5f,
-			-0.5f, -0.5f, -0.5f,
-			-0.5f,  0.5f, -0.5f,
-			-0.5f,  0.5f, -0.5f,
-			 0.5f,  0.5f, -0.5f,
-			 0.5f, -0.5f, -0.5f
-		};
-
-		glGenVertexArrays(1, &lampVAO);
-		glGenBuffers(1, &lampVBO);
+		-0.5f,  0.5f,  0.5f,
+		 0.5f,  0.5f,  0.5f,
+		 0.5f,  0.5f, -0.5f,
+		 0.5f,  0.5f, -0.5f,
+		-0.5f,  0.5f, -0.5f,
+		-0.5f,  0.5f,  0.5f,
+
+		 0.5f, -0.5f, -0.5f,
+		-0.5f, -0.5f, -0.5f,
+		-0.5f, -0.5f,  0.5f,
+		-0.5f, -0.5f,  0.5f,
+		 0.5f, -0.5f,  0.5f,
+		 0.5f, -0.5f, -0.5f,
+
+		-0.5f, -0.5f, -0.5f,
+		-0.5f, -0.5f,  0.5f,
+		-0.5f,  0.5f,  0.5f,
+		-0.5f,  0.5f,  0.5f,
+		-0.5f,  0.5f, -0.5f,
+		-0.5f, -0.5f, -0.5f,
+
+		 0.5f, -0.5f,  0.5f,
+		 0.5f, -0.5f, -0.5f,
+		 0.5f,  0.5f, -0.5f,
+		 0.5f,  0.5f, -0.5f,
+		 0.5f,  0.5f,  0.5f,
+		 0.5f, -0.5f,  0.5f,
+
+		-0.5f, -0.5f,  0.5f,
+		 0.5f, -0.5f,  0.5f,
+		 0.5f,  0.5f,  0.5f,
+		 0.5f,  0.5f,  0.5f,
+		-0.5f,  0.5f,  0.5f,
+		-0.5f, -0.5f,  0.5f,
+
+		 0.5f, -0.5f, -0.5f,
+		-0.5f, -0.5f, -0.5f,
+		-0.5f,  0.5f, -0.5f,
+		-0.5f,  0.5f, -0.5f,
+		 0.5f,  0.5f, -0.5f,
+		 0.5f, -0.5f, -0.5f
+	};
+
+	MeshData lampData = BuildIndexedMesh(lampVertices, 36, 0);
+	OptimizeMesh(lampData);
+	lampMesh.Create(lampData);
+	lampVisible.Attach(lampMesh.vao);
+}
 
-		glBindVertexArray(lampVAO);
-		glBindBuffer(GL_ARRAY_BUFFER, lampVBO);
-		glBufferData(GL_ARRAY_BUFFER, sizeof(lampVertices), lampVertices, GL_STATIC_DRAW);
+void SubmitLamp(unsigned int instanceCount)
+{
+	DrawPacket packet;
+	packet.program = lampShader.id;
+	packet.vao = lampMesh.vao;
+	packet.indexCount = lampMesh.indexCount;
+	packet.indexType = lampMesh.indexType;
+	packet.instanceCount = instanceCount;
+	renderQueue.Submit(RENDER_PASS_OPAQUE, packet, ViewDepth(lampInstances));
+}
 
-		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
-		glEnableVertexAttribArray(0);
-	}
-	
-	glBindVertexArray(lampVAO);
-	glDrawArrays(GL_TRIANGLES, 0, 36);
-	glBindVertexArray(0);
+//camera distance to the center of the instance bounds, normalized by the far plane for the sort key
+float ViewDepth(const InstanceSet &set)
+{
+	return glm::length((set.boundsMin + set.boundsMax) * 0.5f - cameraPos) / 100.0f;
 }
 
-// project and windows configuration:
-// copy freetype6.dll and zlib1.dll to system folder
-// add freetype.lib to Linkder/Input of project properties
-void RenderText(unsigned int shader, std::string text, float x, float y, float scale, std::string font, glm::vec3 color)
+//sort the queued packets here and record their draw, timed as scope, the render thread only issues them
+void RecordPackets(CommandList &commands, const char *scope)
 {
-	if (textVAO == 0)
+	std::vector<DrawPacket> packets;
 	{
-		//freetype initialization
-		if (FT_Init_FreeType(&ft))
-		{
-			std::cout << "ERROR:FREETYPE: COULD NOT INITIALIZE FREETYPE" << std::endl;
-		}
-		if (FT_New_Face(ft, std::string("Fonts/" + font + ".ttf").c_str(), 0, &face))
-		{
-			std::cout << "ERROR:FREETYPE: COULD NOT LOAD FACE" << std::endl;
-		}
-		FT_Set_Pixel_Sizes(face, 0, 48);
-		if (FT_Load_Char(face, 'X', FT_LOAD_RENDER))
-		{
-			std::cout << "ERROR:FREETYPE: FAILED TO LOAD GLYPH" << std::endl;
-		}
-
-		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-		for (GLubyte c = 0; c < 128; c++)
-		{
-			if (FT_Load_Char(face, c, FT_LOAD_RENDER))
-			{
-				std::cout << "ERROR:FREETYPE: FAILED TO LOAD GLYPH" << std::endl;
-				continue;
-			}
-			unsigned int texture;
-			glGenTextures(1, &texture);
-			glBindTexture(GL_TEXTURE_2D, texture);
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, face->glyph->bitmap.width, face->glyph->bitmap.rows, 0, GL_RED, GL_UNSIGNED_BYTE, face->glyph->bitmap.buffer);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-			Character character =
-			{
-				texture,
-				glm::ivec2(face->glyph->bitmap.width, face->glyph->bitmap.rows),
-				glm::ivec2(face->glyph->bitmap_left, face->glyph->bitmap_top),
-				face->glyph->advance.x
-			};
-			Characters.insert(std::pair<GLchar, Character>(c, character));
-		}
-
-		//allocate vao & vbo
-		glGenVertexArrays(1, &textVAO);
-		glGenBuffers(1, &textVBO);
-		glBindVertexArray(textVAO);
-		glBindBuffer(GL_ARRAY_BUFFER, textVBO);
-		glBufferData(GL_ARRAY_BUFFER, sizeof(float) * 6 * 4, NULL, GL_DYNAMIC_DRAW);
-		glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
-		glEnableVertexAttribArray(0);
+		ProfileScope sortScope("Sort packets", PROFILE_THREAD_SIMULATION);
+		renderQueue.Sort(packets);
 	}
-
-	glm::mat4 projection = glm::ortho(0.0f, (float)SCREEN_WIDTH, 0.0f, (float)SCREEN_HEIGHT);
-	glUseProgram(shader);
-	glUniformMatrix4fv(glGetUniformLocation(shader, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
-	glUniform3fv(glGetUniformLocation(shader, "textColor"), 1, glm::value_ptr(color));
-	glActiveTexture(GL_TEXTURE0);
-	glBindVertexArray(textVAO);
-
-	std::string::const_iterator c;
-	for (c = text.begin(); c != text.end(); c++)
+	commands.Record([packets, scope]()
 	{
-		Character ch = Characters[*c];
-
-		float xpos = x + ch.bearing.x * scale;
-		float ypos = y - (ch.size.y - ch.bearing.y) * scale;
-
-		float w = ch.size.x * scale;
-		float h = ch.size.y * scale;
-
-		float vertices[6][4] =
-		{
-			{ xpos,     ypos + h,   0.0f, 0.0f },
-			{ xpos,     ypos,       0.0f, 1.0f },
-			{ xpos + w, ypos,       1.0f, 1.0f },
-			{ xpos,     ypos + h,   0.0f, 0.0f },
-			{ xpos + w, ypos,       1.0f, 1.0f },
-			{ xpos + w, ypos + h,   1.0f, 0.0f }
-		};
-		glBindTexture(GL_TEXTURE_2D, ch.texture);
-		glBindBuffer(GL_ARRAY_BUFFER, textVBO);
-		glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(vertices), vertices);
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
-		glDrawArrays(GL_TRIANGLES, 0, 6);
-
-		x += (ch.advance >> 6) * scale;
-	}
-	glBindVertexArray(0);
-	glBindTexture(GL_TEXTURE_2D, 0);
+		ProfileScope drawScope(scope, PROFILE_THREAD_RENDER, true);
+		DrawPackets(packets);
+	});
 }
 
 void RenderSkybox()
 {
-	if (skyboxVAO == 0)
+	if (skyboxMesh.vao == 0)
 	{
-		//Cubemap(skybox) VAO and VBO
+		//Cubemap(skybox) vertices
 		float skyboxVertices[] =
 		{
 			-1.0f,  1.0f, -1.0f,   -1.0f, -1.0f, -1.0f,    1.0f, -1.0f, -1.0f,
@@ -761,219 +1378,224 @@ void RenderSkybox()
 			 1.0f, -1.0f, -1.0f,   -1.0f, -1.0f,  1.0f,    1.0f, -1.0f,  1.0f
 		};
 
-		glGenVertexArrays(1, &skyboxVAO);
-		glGenBuffers(1, &skyboxVBO);
+		MeshData skyboxData = BuildIndexedMesh(skyboxVertices, 36, 0);
+		OptimizeMesh(skyboxData);
+		skyboxMesh.Create(skyboxData);
 
-		glBindVertexArray(skyboxVAO);
-		glBindBuffer(GL_ARRAY_BUFFER, skyboxVBO);
-		glBufferData(GL_ARRAY_BUFFER, sizeof(skyboxVertices), skyboxVertices, GL_STATIC_DRAW);
+		skyboxTexture = textureLoader.LoadCubeMapTexture(faces, [](unsigned int texture) { TextureLoaded(skyboxTexture, texture); });
 
-		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
-		glEnableVertexAttribArray(0);
-
-		skyboxTexture = LoadCubeMapTexture(faces);
-
-		glUseProgram(skyboxShader);
-		glUniform1i(glGetUniformLocation(skyboxShader, "skybox"), 0);
+		skyboxShader.Use();
+		SetUniform(skyboxUniforms.skybox, 0);
 	}
 
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_CUBE_MAP, skyboxTexture);
-	glBindVertexArray(skyboxVAO);
-	glDrawArrays(GL_TRIANGLES, 0, 36);
-	glBindVertexArray(0);
+	glState.BindTexture(0, GL_TEXTURE_CUBE_MAP, skyboxTexture);
+	glState.BindVertexArray(skyboxMesh.vao);
+	glDrawElements(GL_TRIANGLES, skyboxMesh.indexCount, skyboxMesh.indexType, 0);
 	glDepthFunc(GL_LESS);
 }
 
-unsigned int CreateShaderProgram(const char *vertexFilePath, const char *fragmentFilePath, const char *geometryFilePath)
+void ResolveObjectUniforms(const ShaderProgram &shader, ObjectUniforms &uniforms)
 {
-	std::string vertexCode, fragmentCode, geometryCode;
-	std::ifstream vShaderFile, fShaderFile, gShaderFile;
-
-	vShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-	fShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-	gShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+	uniforms.shininess = shader.GetUniform<float>("material.shininess");
+	uniforms.diffuse = shader.GetUniform<int>("material.diffuse");
+	uniforms.shadowMap = shader.GetUniform<int>("shadowMap");
+	uniforms.pointLights = shader.GetUniform<int>("pointLights");
+	uniforms.clusterRanges = shader.GetUniform<int>("clusterRanges");
+	uniforms.clusterLightIndices = shader.GetUniform<int>("clusterLightIndices");
+	uniforms.clusterScale = shader.GetUniform<glm::vec4>("clusterScale");
+}
 
-	try
-	{
-		vShaderFile.open(vertexFilePath);
-		fShaderFile.open(fragmentFilePath);
+void SetClusterUniforms(const ShaderProgram &shader, const ObjectUniforms &uniforms, const glm::vec4 &clusterScale)
+{
+	shader.Use();
+	SetUniform(uniforms.pointLights, (int)CLUSTER_TEXTURE_UNIT);
+	SetUniform(uniforms.clusterRanges, (int)CLUSTER_TEXTURE_UNIT + 1);
+	SetUniform(uniforms.clusterLightIndices, (int)CLUSTER_TEXTURE_UNIT + 2);
+	SetUniform(uniforms.clusterScale, clusterScale);
+}
 
-		std::stringstream vShaderStream, fShaderStream;
+void ResolveUniforms()
+{
+	ResolveObjectUniforms(cubeShader, cubeUniforms);
+	ResolveObjectUniforms(floorShader, floorUniforms);
+	ResolveObjectUniforms(modelShader, modelUniforms);
 
-		vShaderStream << vShaderFile.rdbuf();
-		fShaderStream << fShaderFile.rdbuf();
+	shadowMapUniforms.layer = shadowMapShader.GetUniform<int>("layer");
+	shadowMapLayeredUniforms.layerMask = shadowMapLayeredShader.GetUniform<int>("layerMask");
+	if (shadowBlurShader.id != 0)
+	{
+		shadowBlurUniforms.moments = shadowBlurShader.GetUniform<int>("moments");
+		shadowBlurUniforms.direction = shadowBlurShader.GetUniform<glm::vec2>("direction");
+		shadowBlurUniforms.tileBounds = shadowBlurShader.GetUniform<glm::vec4>("tileBounds");
+	}
 
-		vShaderFile.close();
-		fShaderFile.close();
+	skyboxUniforms.skybox = skyboxShader.GetUniform<int>("skybox");
+}
 
-		vertexCode = vShaderStream.str();
-		fragmentCode = fShaderStream.str();
+//center cube, floor, lamps and props scattered over the floor, seeded so every run builds the same scene
+void CreateSceneEntities(unsigned int propCount)
+{
+	scene.Clear();
+	cubeEntity = scene.Create(glm::vec3(0.0f, 0.5f, 0.0f));
+	floorEntity = scene.Create(glm::vec3(0.0f));
+	for (int i = 0; i < NUMBER_OF_LAMP; i++) { lampEntities[i] = scene.Create(lampPositions[i], glm::quat(), glm::vec3(0.25f)); }
+
+	//model is scaled into a 2 unit box and stands on the floor left of the center cube
+	modelEntity = NO_ENTITY;
+	if (model.mesh.vao != 0)
+	{
+		glm::vec3 size = model.mesh.boundsMax - model.mesh.boundsMin;
+		float scale = 2.0f / glm::max(glm::max(size.x, size.y), glm::max(size.z, 1e-6f));
+		glm::vec3 anchor((model.mesh.boundsMin.x + model.mesh.boundsMax.x) * 0.5f, model.mesh.boundsMin.y, (model.mesh.boundsMin.z + model.mesh.boundsMax.z) * 0.5f);
+		modelEntity = scene.Create(glm::vec3(-2.5f, 0.0f, 0.0f) - anchor * scale, glm::quat(), glm::vec3(scale));
+	}
 
-		if (geometryFilePath != nullptr)
-		{
-			gShaderFile.open(geometryFilePath);
-			std::stringstream gShaderStream;
-			gShaderStream << gShaderFile.rdbuf();
-			gShaderFile.close();
-			geometryCode = gShaderStream.str();
-		}
+	propEntities.clear();
+	propTints.clear();
+	Random random(1234);
+	while (propEntities.size() < propCount)
+	{
+		glm::vec3 position(random.Unit() * 19.0f - 9.5f, 0.0f, random.Unit() * 19.0f - 9.5f);
+		float scale = 0.1f + random.Unit() * 0.15f;
+		float angle = random.Unit() * 360.0f;
+		glm::vec4 tint(0.5f + random.Unit() * 0.5f, 0.5f + random.Unit() * 0.5f, 0.5f + random.Unit() * 0.5f, 1.0f);
+		//keep the center cube clear
+		if (glm::max(glm::abs(position.x), glm::abs(position.z)) < 1.0f) { continue; }
+
+		position.y = scale * 0.5f;
+		propEntities.push_back(scene.Create(position, glm::angleAxis(glm::radians(angle), glm::vec3(0.0f, 1.0f, 0.0f)), glm::vec3(scale)));
+		propTints.push_back(tint);
 	}
-	catch (std::ifstream::failure e)
+}
+
+//cull set against frusta and occlusion when given and record the upload of the instances left into buffer, returns their count
+unsigned int CullInstances(const InstanceSet &set, const Frustum *frusta, unsigned int frustumCount, InstanceBuffer &buffer, CommandList &commands, const OcclusionCuller *occlusion)
+{
+	visibleInstances.clear();
+	unsigned int visible = CullSpheres(frusta, frustumCount, set.spheres, visibleInstances);
+	if (occlusion)
 	{
-		std::cout << "ERROR: shader file failed to read." << std::endl;
+		unsigned int occluded = occlusion->CullOccluded(set.spheres, visibleInstances);
+		visible -= occluded;
+		cullingStats.occluded += occluded;
 	}
+	//instances are copied, the set may change for the next frame before the render thread uploads them
+	std::vector<InstanceData> instances(visibleInstances.size());
+	for (size_t i = 0; i < visibleInstances.size(); i++) { instances[i] = set.instances[visibleInstances[i]]; }
+	InstanceBuffer *target = &buffer;
+	commands.Record([target, instances]() { target->Update(instances.data(), (unsigned int)instances.size()); });
+
+	cullingStats.tested += set.Count();
+	cullingStats.culled += set.Count() - visible;
+	cullingStats.drawn += visible;
+	return visible;
+}
 
-	const char *vShaderCode = vertexCode.c_str();
-	const char *fShaderCode = fragmentCode.c_str();
+//overlay line drawn by the render thread with the font and size of every other line
+void RecordText(CommandList &commands, const std::string &text, float x, float y)
+{
+	commands.Record([text, x, y]() { RenderText(text, x, y, 0.3f, "Roboto", glm::vec3(1.0f)); });
+}
 
-	//Create vertexShader and fragmentShader and link into shaderProgram value of shader program
-	int success;
-	char infoLog[512];
+std::string FormatMs(double ms)
+{
+	char text[32];
+	snprintf(text, sizeof(text), "%.2f ms", ms);
+	return text;
+}
 
-	unsigned int vertexShader = glCreateShader(GL_VERTEX_SHADER);
-	unsigned int fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-	unsigned int geometryShader = 0;
+//loader callbacks run on the render thread, the new texture is recorded into draws from the next frame on
+void TextureLoaded(unsigned int &slot, unsigned int texture)
+{
+	std::lock_guard<std::mutex> lock(loadedTexturesMutex);
+	loadedTextures.push_back(std::make_pair(&slot, texture));
+}
 
-	glShaderSource(vertexShader, 1, &vShaderCode, NULL);
-	glShaderSource(fragmentShader, 1, &fShaderCode, NULL);
+void SwapInLoadedTextures()
+{
+	std::lock_guard<std::mutex> lock(loadedTexturesMutex);
+	for (const std::pair<unsigned int *, unsigned int> &loaded : loadedTextures) { *loaded.first = loaded.second; }
+	loadedTextures.clear();
+}
 
-	glCompileShader(vertexShader);
-	glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &success);
-	if (!success)
+//copy world matrices into the instance sets, cube instances are the center cube followed by the props
+void AssignInstances()
+{
+	std::vector<InstanceData> cubes(propEntities.size() + 1);
+	cubes[0].model = scene.World(cubeEntity);
+	cubes[0].tint = glm::vec4(1.0f);
+	for (size_t i = 0; i < propEntities.size(); i++)
 	{
-		//if vertex shader failed to compile then pop up error message in console
-		glGetShaderInfoLog(vertexShader, 512, NULL, infoLog);
-		std::cout << "ERROR: VERTEX SHADER FAILED TO COMPILE: " << infoLog << std::endl;
+		cubes[i + 1].model = scene.World(propEntities[i]);
+		cubes[i + 1].tint = propTints[i];
 	}
+	cubeInstances.Assign(cubes);
 
-	glCompileShader(fragmentShader);
-	glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &success);
-	if (!success)
-	{
-		//if fragment shader failed to compile then pop up error message in console
-		glGetShaderInfoLog(fragmentShader, 512, NULL, infoLog);
-		std::cout << "ERROR: FRAGMENT SHADER FAILED TO COMPILE: " << infoLog << std::endl;
-	}
+	InstanceData floor = { scene.World(floorEntity), glm::vec4(1.0f) };
+	floorInstances.Assign(&floor, 1);
 
-	if (geometryFilePath != nullptr)
+	InstanceData lamps[NUMBER_OF_LAMP];
+	for (int i = 0; i < NUMBER_OF_LAMP; i++)
 	{
-		const char *geometryShaderSource = geometryCode.c_str();
-		geometryShader = glCreateShader(GL_GEOMETRY_SHADER);
-		glShaderSource(geometryShader, 1, &geometryShaderSource, NULL);
-		glCompileShader(geometryShader);
-		
-		glGetShaderiv(geometryShader, GL_COMPILE_STATUS, &success);
-		if (!success)
-		{
-			glGetShaderInfoLog(geometryShader, 512, NULL, infoLog);
-			std::cout << "ERROR: GEOMETRY SHADER FAILED TO COMPILE: " << infoLog << std::endl;
-		}
+		lamps[i].model = scene.World(lampEntities[i]);
+		lamps[i].tint = glm::vec4(1.0f);
 	}
+	lampInstances.Assign(lamps, NUMBER_OF_LAMP);
 
-	unsigned int shaderProgram = glCreateProgram();
-	glAttachShader(shaderProgram, vertexShader);
-	glAttachShader(shaderProgram, fragmentShader);
-	if (geometryFilePath != nullptr) { glAttachShader(shaderProgram, geometryShader); }
-	glLinkProgram(shaderProgram);
-
-	glGetProgramiv(shaderProgram, GL_LINK_STATUS, &success);
-	if (!success)
+	if (modelEntity != NO_ENTITY)
 	{
-		//if shader program failed to link two shaders then pop up error message in console
-		glGetProgramInfoLog(shaderProgram, 512, NULL, infoLog);
-		std::cout << "ERROR: SHADER PROGRAM FAILED TO LINK: " << infoLog << std::endl;
+		InstanceData instance = { scene.World(modelEntity), glm::vec4(1.0f) };
+		modelInstances.Assign(&instance, 1);
 	}
-
-	glDeleteShader(vertexShader);
-	glDeleteShader(fragmentShader);
-	if (geometryFilePath != nullptr) { glDeleteShader(geometryShader); }
-
-	return shaderProgram;
 }
 
-unsigned int LoadTexture(const char *filepath)
+//diffuse textures of model materials go through the texture loader, plain colors become one texel textures
+void LoadModelTextures()
 {
-	unsigned int texture;
-
-	glGenTextures(1, &texture);
-	glBindTexture(GL_TEXTURE_2D, texture);
-
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_R, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-	int width, height, nChannel;
-	unsigned char *data = stbi_load(filepath, &width, &height, &nChannel, NULL);
-	if (data)
+	modelTextures.assign(model.materials.size(), 0);
+	for (size_t i = 0; i < model.materials.size(); i++)
 	{
-		GLenum format;
-		switch (nChannel)
+		const ModelMaterial &material = model.materials[i];
+		if (!material.diffuseTexture.empty())
 		{
-		case 1:
-			format = GL_RED;
-			break;
-		case 3:
-			format = GL_RGB;
-			break;
-		case 4:
-			format = GL_RGBA;
-			break;
+			modelTextures[i] = textureLoader.LoadTexture(material.diffuseTexture, [i](unsigned int texture) { TextureLoaded(modelTextures[i], texture); });
+			continue;
 		}
 
-		glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-		glGenerateMipmap(GL_TEXTURE_2D);
+		unsigned char texel[4];
+		for (int c = 0; c < 4; c++) { texel[c] = (unsigned char)(glm::clamp(material.diffuseColor[c], 0.0f, 1.0f) * 255.0f + 0.5f); }
+		glGenTextures(1, &modelTextures[i]);
+		glState.BindTexture(0, GL_TEXTURE_2D, modelTextures[i]);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, texel);
 	}
-	else
+}
+
+//point lights orbiting over the floor, seeded so every run builds the same lights
+void CreatePointLights(unsigned int count)
+{
+	count = std::min(count, MAX_POINT_LIGHTS);
+	pointLights.resize(count);
+	pointLightOrbits.resize(count);
+	Random random(4321);
+	for (unsigned int i = 0; i < count; i++)
 	{
-		std::cout << "ERROR: TEXTURE FAILED TO LOAD." << std::endl;
+		pointLightOrbits[i] = glm::vec4(random.Unit() * 18.0f - 9.0f, 0.2f + random.Unit() * 0.8f, random.Unit() * 18.0f - 9.0f, random.Unit() * 6.2831853f);
+		pointLights[i].radius = 0.75f + random.Unit() * 1.25f;
+		glm::vec3 color(random.Unit(), random.Unit(), random.Unit());
+		pointLights[i].color = color / glm::max(color.x, glm::max(color.y, color.z)) * 0.8f;
+		pointLights[i].padding = 0.0f;
 	}
-
-	return texture;
+	AnimatePointLights(0.0f);
 }
 
-unsigned int LoadCubeMapTexture(std::vector<std::string> faces)
+void AnimatePointLights(float time)
 {
-	unsigned int texture;
-
-	glGenTextures(1, &texture);
-	glBindTexture(GL_TEXTURE_CUBE_MAP, texture);
-
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-	int width, height, nChannel;
-	for (int i = 0; i < faces.size(); i++)
+	for (size_t i = 0; i < pointLights.size(); i++)
 	{
-		unsigned char* data = stbi_load(faces[i].c_str(), &width, &height, &nChannel, 0);
-		if (data)
-		{
-			GLenum format;
-			switch (nChannel)
-			{
-			case 1:
-				format = GL_RED;
-				break;
-			case 3:
-				format = GL_RGB;
-				break;
-			case 4:
-				format = GL_RGBA;
-				break;
-			}
-
-			glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-		}
-		else
-		{
-			std::cout << "ERROR: CUBEMAP TEXTURE FAILED TO LOAD." << std::endl;
-		}
-		stbi_image_free(data);
+		const glm::vec4 &orbit = pointLightOrbits[i];
+		float angle = time * 0.5f + orbit.w;
+		pointLights[i].position = glm::vec3(orbit) + glm::vec3(cos(angle), 0.0f, sin(angle)) * 0.75f;
 	}
-
-	return texture;
-}
\ No newline at end of file
+}